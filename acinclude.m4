@@ -878,12 +878,12 @@ AC_DEFUN([LIBZMQ_CHECK_POLLER], [{
 
     # Allow user to disable doc build
     AC_ARG_WITH([poller], [AS_HELP_STRING([--with-poller],
-                [choose polling system manually. valid values are kqueue, epoll, devpoll, poll or select [default=autodetect]])])
+                [choose polling system manually. valid values are kqueue, epoll, io_uring, devpoll, poll or select [default=autodetect]])])
 
     AC_MSG_CHECKING([for suitable polling system])
 
     case "${with_poller}" in
-        kqueue|epoll|devpoll|poll|select)
+        kqueue|epoll|io_uring|devpoll|poll|select)
             # User has chosen polling system
             libzmq_cv_poller="${with_poller}"
         ;;
@@ -178,10 +178,28 @@ ZMQ_EXPORT void zmq_version (int *major, int *minor, int *patch);
 /*  Context options                                                           */
 #define ZMQ_IO_THREADS  1
 #define ZMQ_MAX_SOCKETS 2
+#define ZMQ_MSG_POOL    3
+#define ZMQ_CHUNK_CACHE 4
+#define ZMQ_CHUNK_CACHE_HITS 5
+#define ZMQ_CHUNK_CACHE_MISSES 6
+#define ZMQ_CHUNK_CACHE_DROPS 7
+#define ZMQ_CHUNK_CACHE_CHUNKS 8
+#define ZMQ_SPIN_TIME 9
+#define ZMQ_POLL_UPDATES_AVOIDED 10
+#define ZMQ_REBALANCE_IVL 11
+#define ZMQ_MIGRATIONS 12
+#define ZMQ_THREAD_SCHED_POLICY 13
+#define ZMQ_THREAD_PRIORITY 14
+#define ZMQ_THREAD_AFFINITY_CPU_ADD 15
+#define ZMQ_THREAD_AFFINITY_CPU_REMOVE 16
+#define ZMQ_THREAD_AFFINITY_SPREAD 17
+#define ZMQ_IO_BUSY_POLL 18
 
 /*  Default for new contexts                                                  */
 #define ZMQ_IO_THREADS_DFLT  1
 #define ZMQ_MAX_SOCKETS_DFLT 1023
+#define ZMQ_THREAD_SCHED_POLICY_DFLT -1
+#define ZMQ_THREAD_PRIORITY_DFLT -1
 
 ZMQ_EXPORT void *zmq_ctx_new (void);
 ZMQ_EXPORT int zmq_ctx_term (void *context);
@@ -189,6 +207,13 @@ ZMQ_EXPORT int zmq_ctx_shutdown (void *ctx_);
 ZMQ_EXPORT int zmq_ctx_set (void *context, int option, int optval);
 ZMQ_EXPORT int zmq_ctx_get (void *context, int option);
 
+/*  Custom allocator for message bodies, I/O buffers and message queues.     */
+typedef void *(zmq_alloc_fn) (size_t size, void *hint);
+typedef void (zmq_dealloc_fn) (void *ptr, void *hint);
+
+ZMQ_EXPORT int zmq_ctx_set_allocator (void *context, zmq_alloc_fn *alloc_fn,
+    zmq_dealloc_fn *free_fn, void *hint);
+
 /*  Old (legacy) API                                                          */
 ZMQ_EXPORT void *zmq_init (int io_threads);
 ZMQ_EXPORT int zmq_term (void *context);
@@ -199,7 +224,15 @@ ZMQ_EXPORT int zmq_ctx_destroy (void *context);
 /*  0MQ message definition.                                                   */
 /******************************************************************************/
 
+/*  Building with ZMQ_CACHELINE_MSG defined makes zmq_msg_t occupy a whole    */
+/*  cache line and lets messages up to 57 bytes be stored inline. This        */
+/*  changes the ABI, so applications have to be compiled with the same        */
+/*  definition as the library.                                                */
+#if defined ZMQ_CACHELINE_MSG
+typedef struct zmq_msg_t {unsigned char _ [64];} zmq_msg_t;
+#else
 typedef struct zmq_msg_t {unsigned char _ [40];} zmq_msg_t;
+#endif
 
 typedef void (zmq_free_fn) (void *data, void *hint);
 
@@ -294,6 +327,25 @@ ZMQ_EXPORT int zmq_msg_set (zmq_msg_t *msg, int option, int optval);
 #define ZMQ_IPC_FILTER_UID 59
 #define ZMQ_IPC_FILTER_GID 60
 #define ZMQ_CONNECT_RID 61 
+#define ZMQ_INBOUND_POLL_RATE 62
+#define ZMQ_MAX_COMMAND_DELAY 63
+#define ZMQ_ADAPTIVE_THROTTLE 64
+#define ZMQ_COMMAND_CHECKS 65
+#define ZMQ_COMMANDS_PROCESSED 66
+#define ZMQ_READ_BUDGET 67
+#define ZMQ_READ_BUDGET_MSGS 68
+#define ZMQ_GATHER_THRESHOLD 69
+#define ZMQ_ZEROCOPY_THRESHOLD 70
+#define ZMQ_IN_BATCH_SIZE 71
+#define ZMQ_OUT_BATCH_SIZE 72
+#define ZMQ_ADAPTIVE_BATCH 73
+#define ZMQ_COALESCE_DELAY 74
+#define ZMQ_COALESCE_BYTES 75
+#define ZMQ_WRITE_CALLS 76
+#define ZMQ_WRITE_MSGS 77
+#define ZMQ_LISTENER_SHARDS 78
+#define ZMQ_WRITE_COPIED 79
+#define ZMQ_READ_YIELDS 80
 
 /*  Message options                                                           */
 #define ZMQ_MORE 1
@@ -365,12 +417,18 @@ ZMQ_EXPORT int zmq_socket_monitor (void *s, const char *addr, int events);
 
 ZMQ_EXPORT int zmq_sendmsg (void *s, zmq_msg_t *msg, int flags);
 ZMQ_EXPORT int zmq_recvmsg (void *s, zmq_msg_t *msg, int flags);
+ZMQ_EXPORT int zmq_sendmmsg (void *s, zmq_msg_t *msgs, size_t count,
+    int flags);
+ZMQ_EXPORT int zmq_recvmmsg (void *s, zmq_msg_t *msgs, size_t count,
+    int flags);
 
 /*  Experimental                                                              */
 struct iovec;
 
 ZMQ_EXPORT int zmq_sendiov (void *s, struct iovec *iov, size_t count, int flags);
 ZMQ_EXPORT int zmq_recviov (void *s, struct iovec *iov, size_t *count, int flags);
+ZMQ_EXPORT int zmq_sendiov_data (void *s, struct iovec *iov, size_t count,
+    int flags, zmq_free_fn *ffn, void *hint);
 
 /******************************************************************************/
 /*  I/O multiplexing.                                                         */
@@ -396,6 +454,55 @@ typedef struct
 
 ZMQ_EXPORT int zmq_poll (zmq_pollitem_t *items, int nitems, long timeout);
 
+/*  Persistent poller. Items are registered once; the cost of a wait is       */
+/*  proportional to the number of items ready where epoll is available.       */
+
+#if defined _WIN32
+typedef SOCKET zmq_fd_t;
+#else
+typedef int zmq_fd_t;
+#endif
+
+typedef struct
+{
+    void *socket;
+    zmq_fd_t fd;
+    void *user_data;
+    short events;
+} zmq_poller_event_t;
+
+ZMQ_EXPORT void *zmq_poller_new (void);
+ZMQ_EXPORT int zmq_poller_destroy (void **poller_p);
+ZMQ_EXPORT int zmq_poller_add (void *poller, void *socket, void *user_data,
+    short events);
+ZMQ_EXPORT int zmq_poller_modify (void *poller, void *socket, short events);
+ZMQ_EXPORT int zmq_poller_remove (void *poller, void *socket);
+ZMQ_EXPORT int zmq_poller_add_fd (void *poller, zmq_fd_t fd, void *user_data,
+    short events);
+ZMQ_EXPORT int zmq_poller_modify_fd (void *poller, zmq_fd_t fd,
+    short events);
+ZMQ_EXPORT int zmq_poller_remove_fd (void *poller, zmq_fd_t fd);
+ZMQ_EXPORT int zmq_poller_wait (void *poller, zmq_poller_event_t *event,
+    long timeout);
+ZMQ_EXPORT int zmq_poller_wait_all (void *poller, zmq_poller_event_t *events,
+    int n_events, long timeout);
+
+/*  Reactor. Handlers return 0 to keep the loop running, -1 to stop it.       */
+
+typedef int (zmq_loop_fn) (void *loop, void *socket, zmq_msg_t *msg,
+    void *arg);
+typedef int (zmq_timer_fn) (void *loop, int timer_id, void *arg);
+
+ZMQ_EXPORT void *zmq_loop_new (void);
+ZMQ_EXPORT int zmq_loop_destroy (void **loop_p);
+ZMQ_EXPORT int zmq_loop_add (void *loop, void *socket, zmq_loop_fn *handler,
+    void *arg);
+ZMQ_EXPORT int zmq_loop_remove (void *loop, void *socket);
+ZMQ_EXPORT int zmq_loop_add_timer (void *loop, int interval, int times,
+    zmq_timer_fn *handler, void *arg);
+ZMQ_EXPORT int zmq_loop_cancel_timer (void *loop, int timer_id);
+ZMQ_EXPORT int zmq_loop_run (void *loop);
+
 /*  Built-in message proxy (3-way) */
 
 ZMQ_EXPORT int zmq_proxy (void *frontend, void *backend, void *capture);
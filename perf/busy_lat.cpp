@@ -0,0 +1,335 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Roundtrip times are sorted into buckets by the power of two of their
+//  length in microseconds; the last bucket takes everything longer.
+#define HISTOGRAM_BUCKETS 20
+
+static const char *endpoint = "tcp://127.0.0.1:5570";
+static size_t message_size;
+static int roundtrip_count;
+
+static int compare_samples (const void *a_, const void *b_)
+{
+    unsigned long a = *(const unsigned long*) a_;
+    unsigned long b = *(const unsigned long*) b_;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+//  Prints the latency below which the given fraction of the roundtrips
+//  completed. Latency is half of the roundtrip time, as for the average.
+static void print_percentile (unsigned long *samples_, const char *name_,
+    double fraction_)
+{
+    int i = (int) (fraction_ * (roundtrip_count - 1));
+    printf ("%s latency: %.3f [us]\n", name_, (double) samples_ [i] / 2);
+}
+
+//  Prints the histogram of the (sorted) roundtrip times.
+static void print_histogram (unsigned long *samples_)
+{
+    int counts [HISTOGRAM_BUCKETS];
+    memset (counts, 0, sizeof counts);
+    for (int i = 0; i != roundtrip_count; i++) {
+        int bucket = 0;
+        while (bucket != HISTOGRAM_BUCKETS - 1 &&
+              samples_ [i] >= (1ul << (bucket + 1)))
+            bucket++;
+        counts [bucket]++;
+    }
+
+    printf ("roundtrip time histogram:\n");
+    for (int bucket = 0; bucket != HISTOGRAM_BUCKETS; bucket++) {
+        if (!counts [bucket])
+            continue;
+        if (bucket == HISTOGRAM_BUCKETS - 1)
+            printf ("  %8lu+       [us]: ", 1ul << bucket);
+        else
+            printf ("  %8lu-%-8lu[us]: ", 1ul << bucket,
+                (1ul << (bucket + 1)) - 1);
+        printf ("%9d (%.3f%%)\n", counts [bucket],
+            100.0 * counts [bucket] / roundtrip_count);
+    }
+}
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *ctx_)
+#else
+static void *worker (void *ctx_)
+#endif
+{
+    void *s;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+
+    s = zmq_socket (ctx_, ZMQ_REP);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != roundtrip_count; i++) {
+        rc = zmq_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_sendmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//  Measures the roundtrips over TCP between two contexts whose I/O threads
+//  busy poll for busy_poll_ microseconds, and prints the results.
+static int run (int busy_poll_, unsigned long *samples_)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE remote_thread;
+#else
+    pthread_t remote_thread;
+#endif
+    void *ctx;
+    void *remote_ctx;
+    void *s;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+    void *watch;
+    void *sample_watch;
+    unsigned long elapsed;
+
+    //  Each side gets a context of its own, so that both ends of the
+    //  connection are handled by I/O threads in the given mode.
+    ctx = zmq_ctx_new ();
+    remote_ctx = zmq_ctx_new ();
+    if (!ctx || !remote_ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_set (ctx, ZMQ_IO_BUSY_POLL, busy_poll_);
+    if (rc == 0)
+        rc = zmq_ctx_set (remote_ctx, ZMQ_IO_BUSY_POLL, busy_poll_);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    s = zmq_socket (ctx, ZMQ_REQ);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    remote_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, remote_ctx, 0 , NULL);
+    if (remote_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&remote_thread, NULL, worker, remote_ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = zmq_msg_init_size (&msg, message_size);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    memset (zmq_msg_data (&msg), 0, message_size);
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != roundtrip_count; i++) {
+        sample_watch = zmq_stopwatch_start ();
+        rc = zmq_sendmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+        samples_ [i] = zmq_stopwatch_stop (sample_watch);
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (remote_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (remote_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (remote_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (remote_ctx);
+    if (rc == 0)
+        rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    if (busy_poll_)
+        printf ("\nbusy polling for %d [us]\n", busy_poll_);
+    else
+        printf ("\nblocking (default mode)\n");
+    printf ("average latency: %.3f [us]\n",
+        (double) elapsed / (roundtrip_count * 2));
+
+    qsort (samples_, roundtrip_count, sizeof (unsigned long),
+        compare_samples);
+    print_percentile (samples_, "50th percentile", 0.5);
+    print_percentile (samples_, "90th percentile", 0.9);
+    print_percentile (samples_, "99th percentile", 0.99);
+    print_percentile (samples_, "99.9th percentile", 0.999);
+    print_percentile (samples_, "maximum", 1);
+    print_histogram (samples_);
+
+    return 0;
+}
+
+int main (int argc, char *argv [])
+{
+    unsigned long *samples;
+    int busy_poll;
+
+    if (argc != 4) {
+        printf ("usage: busy_lat <message-size> <roundtrip-count> "
+            "<busy-poll-time>\n");
+        return 1;
+    }
+
+    message_size = atoi (argv [1]);
+    roundtrip_count = atoi (argv [2]);
+    busy_poll = atoi (argv [3]);
+    if (roundtrip_count < 1 || busy_poll < 1) {
+        printf ("roundtrip count and busy poll time must be positive\n");
+        return 1;
+    }
+
+    samples = (unsigned long*) malloc (roundtrip_count *
+        sizeof (unsigned long));
+    if (!samples) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("roundtrip count: %d\n", (int) roundtrip_count);
+
+    //  Same workload, first with I/O threads blocking as soon as they run
+    //  out of events, then with them busy polling.
+    if (run (0, samples) != 0 || run (busy_poll, samples) != 0)
+        return -1;
+
+    free (samples);
+    return 0;
+}
@@ -0,0 +1,186 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char *endpoint = "tcp://127.0.0.1:5570";
+static int connection_count;
+static int io_threads;
+
+//  Opens connection_count connections at once to a router bound with the
+//  given number of listener shards and prints how long it takes for all
+//  of them to be accepted, to complete the handshake and to deliver a
+//  first message.
+static int run (int listener_shards_)
+{
+    //  Clients get a context of their own, so that the server's I/O threads
+    //  do nothing but accept and handshake.
+    void *ctx = zmq_ctx_new ();
+    void *remote_ctx = zmq_ctx_new ();
+    if (!ctx || !remote_ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, io_threads);
+    if (rc == 0)
+        rc = zmq_ctx_set (remote_ctx, ZMQ_IO_THREADS, io_threads);
+    if (rc == 0)
+        rc = zmq_ctx_set (remote_ctx, ZMQ_MAX_SOCKETS, connection_count + 1);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_ROUTER);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Let the whole storm queue up in the listen backlog.
+    int backlog = connection_count;
+    rc = zmq_setsockopt (s, ZMQ_BACKLOG, &backlog, sizeof backlog);
+    if (rc == 0)
+        rc = zmq_setsockopt (s, ZMQ_LISTENER_SHARDS, &listener_shards_,
+            sizeof listener_shards_);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void **clients = (void**) malloc (connection_count * sizeof (void*));
+    if (!clients) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    void *watch = zmq_stopwatch_start ();
+
+    for (int i = 0; i != connection_count; i++) {
+        clients [i] = zmq_socket (remote_ctx, ZMQ_DEALER);
+        if (!clients [i]) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_connect (clients [i], endpoint);
+        if (rc != 0) {
+            printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_send (clients [i], "", 0, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  Each client's message comes with its identity.
+    for (int i = 0; i != 2 * connection_count; i++) {
+        rc = zmq_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int linger = 0;
+    for (int i = 0; i != connection_count; i++) {
+        rc = zmq_setsockopt (clients [i], ZMQ_LINGER, &linger, sizeof linger);
+        if (rc == 0)
+            rc = zmq_close (clients [i]);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    free (clients);
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (remote_ctx);
+    if (rc == 0)
+        rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    unsigned long rate = (unsigned long)
+        ((double) connection_count / (double) elapsed * 1000000);
+    printf ("listener shards %d: %.3f [ms], %d [conn/s]\n",
+        listener_shards_, (double) elapsed / 1000, (int) rate);
+    return 0;
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 4) {
+        printf ("usage: connection_storm <connection-count> <io-threads> "
+            "<listener-shards>\n");
+        return 1;
+    }
+    connection_count = atoi (argv [1]);
+    io_threads = atoi (argv [2]);
+    int listener_shards = atoi (argv [3]);
+    if (connection_count < 1 || io_threads < 1) {
+        printf ("connection count and I/O threads must be at least 1\n");
+        return 1;
+    }
+
+    printf ("connection count: %d\n", connection_count);
+    printf ("I/O threads: %d\n", io_threads);
+
+    //  Each connection takes three file descriptors in this process, so the
+    //  limit on open files may have to be raised for large storms.
+    if (run (1) != 0 || run (listener_shards) != 0)
+        return -1;
+
+    return 0;
+}
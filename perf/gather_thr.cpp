@@ -0,0 +1,247 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+static const char *endpoint = "tcp://127.0.0.1:5570";
+static size_t message_size;
+static int message_count;
+static int gather_threshold;
+
+//  Streams all the messages over the socket's single connection.
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall sender (void *s_)
+#else
+static void *sender (void *s_)
+#endif
+{
+    for (int i = 0; i != message_count; i++) {
+        zmq_msg_t msg;
+        int rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_sendmsg (s_, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//  Sends the messages from another context with the given gather
+//  threshold and prints the throughput.
+static int run ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE sender_thread;
+#else
+    pthread_t sender_thread;
+#endif
+
+    void *ctx = zmq_ctx_new ();
+    void *remote_ctx = zmq_ctx_new ();
+    if (!ctx || !remote_ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int rc = zmq_bind (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  The sending socket is created here rather than by the sender, so
+    //  that the bytes its connection copied can be read once everything
+    //  has been received.
+    void *out = zmq_socket (remote_ctx, ZMQ_PUSH);
+    if (!out) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_setsockopt (out, ZMQ_GATHER_THRESHOLD, &gather_threshold,
+        sizeof gather_threshold);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_connect (out, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    sender_thread = (HANDLE) _beginthreadex (NULL, 0,
+        sender, out, 0 , NULL);
+    if (sender_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&sender_thread, NULL, sender, out);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  The clock starts with the first message, so that connection
+    //  setup is not measured.
+    rc = zmq_recvmsg (s, &msg, 0);
+    if (rc < 0) {
+        printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *watch = zmq_stopwatch_start ();
+    for (int i = 1; i != message_count; i++) {
+        rc = zmq_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (sender_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (sender_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (sender_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    uint64_t copied;
+    size_t copied_size = sizeof copied;
+    rc = zmq_getsockopt (out, ZMQ_WRITE_COPIED, &copied, &copied_size);
+    if (rc != 0) {
+        printf ("error in zmq_getsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (out);
+    if (rc == 0)
+        rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc == 0)
+        rc = zmq_ctx_term (remote_ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    double count = message_count - 1;
+    unsigned long throughput = (unsigned long)
+        (count / (double) elapsed * 1000000);
+    double megabits = (double) (throughput * message_size * 8) / 1000000;
+    printf ("%6d [B] %-8s: %8d [msg/s] %10.3f [Mb/s] %6d [B/msg] copied\n",
+        (int) message_size, gather_threshold ? "gather" : "copy",
+        (int) throughput, megabits, (int) (copied / message_count));
+    return 0;
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 2) {
+        printf ("usage: gather_thr <message-count>\n");
+        return 1;
+    }
+    message_count = atoi (argv [1]);
+    if (message_count < 2) {
+        printf ("message count must be at least 2\n");
+        return 1;
+    }
+
+    printf ("message count: %d\n", message_count);
+
+    //  Each size is sent with everything copied to the output buffer and
+    //  then with all the message bodies written in place.
+    for (message_size = 1024; message_size <= 65536; message_size *= 2) {
+        gather_threshold = 0;
+        if (run () != 0)
+            return -1;
+        gather_threshold = 1;
+        if (run () != 0)
+            return -1;
+    }
+
+    return 0;
+}
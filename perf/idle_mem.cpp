@@ -0,0 +1,222 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_LINUX
+#include <unistd.h>
+#elif !defined ZMQ_HAVE_WINDOWS
+#include <sys/resource.h>
+#endif
+
+//  Measures the memory footprint of idle connections. A ROUTER socket is
+//  bound to the given address and the requested number of DEALER sockets
+//  connect to it. Every dealer then sends a burst of messages which the
+//  router drains, so that the pipes are back to idle. Memory usage is
+//  reported per connection after connecting and after the bursts.
+
+//  Returns the resident set size of the process in bytes. Outside of
+//  Linux the peak resident set size is the best approximation available.
+static long resident_size ()
+{
+#if defined ZMQ_HAVE_LINUX
+    FILE *f = fopen ("/proc/self/statm", "r");
+    if (!f)
+        return -1;
+    long size, resident;
+    int rc = fscanf (f, "%ld %ld", &size, &resident);
+    fclose (f);
+    if (rc != 2)
+        return -1;
+    return resident * sysconf (_SC_PAGESIZE);
+#elif !defined ZMQ_HAVE_WINDOWS
+    struct rusage usage;
+    if (getrusage (RUSAGE_SELF, &usage) != 0)
+        return -1;
+#if defined ZMQ_HAVE_OSX
+    return usage.ru_maxrss;
+#else
+    return usage.ru_maxrss * 1024;
+#endif
+#else
+    return -1;
+#endif
+}
+
+static void drain (void *router_, int count_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+    for (int i = 0; i != count_; i++) {
+        //  Routing id frame followed by the payload.
+        for (int part = 0; part != 2; part++) {
+            rc = zmq_msg_recv (&msg, router_, 0);
+            if (rc < 0) {
+                printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+                exit (1);
+            }
+        }
+    }
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+}
+
+int main (int argc, char *argv [])
+{
+    const char *bind_to;
+    int connection_count;
+    int burst_size;
+    void *ctx;
+    void *router;
+    void **dealers;
+    long base;
+    long connected;
+    long drained;
+    int rc;
+    int i;
+    int j;
+
+    if (argc != 3 && argc != 4) {
+        printf ("usage: idle_mem <bind-to> <connection-count> "
+            "[burst-size]\n");
+        return 1;
+    }
+    bind_to = argv [1];
+    connection_count = atoi (argv [2]);
+    burst_size = argc == 4 ? atoi (argv [3]) : 1000;
+    if (connection_count < 1 || burst_size < 1) {
+        printf ("connection count and burst size must be positive\n");
+        return 1;
+    }
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_set (ctx, ZMQ_MAX_SOCKETS, connection_count + 1);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    router = zmq_socket (ctx, ZMQ_ROUTER);
+    if (!router) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (router, bind_to);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    dealers = (void**) malloc (connection_count * sizeof (void*));
+    if (!dealers) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    base = resident_size ();
+
+    //  Every dealer sends a single message so that all the connections
+    //  are known to be established once the router got them all.
+    for (i = 0; i != connection_count; i++) {
+        dealers [i] = zmq_socket (ctx, ZMQ_DEALER);
+        if (!dealers [i]) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_connect (dealers [i], bind_to);
+        if (rc != 0) {
+            printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_send (dealers [i], "", 0, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    drain (router, connection_count);
+    connected = resident_size ();
+
+    //  Let every connection go through a burst and back to idle.
+    for (i = 0; i != connection_count; i++) {
+        for (j = 0; j != burst_size; j++) {
+            rc = zmq_send (dealers [i], "", 0, 0);
+            if (rc < 0) {
+                printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+                return -1;
+            }
+        }
+        drain (router, burst_size);
+    }
+    drained = resident_size ();
+
+    if (base < 0 || connected < 0 || drained < 0) {
+        printf ("memory usage cannot be measured on this platform\n");
+        return -1;
+    }
+
+    printf ("connection count: %d\n", connection_count);
+    printf ("burst size: %d [msgs]\n", burst_size);
+    printf ("memory when connected: %.0f [B/connection]\n",
+        (double) (connected - base) / connection_count);
+    printf ("memory after bursts: %.0f [B/connection]\n",
+        (double) (drained - base) / connection_count);
+
+    for (i = 0; i != connection_count; i++) {
+        rc = zmq_close (dealers [i]);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    free (dealers);
+
+    rc = zmq_close (router);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    return 0;
+}
@@ -36,6 +36,22 @@
 static size_t message_size;
 static int roundtrip_count;
 
+static int compare_samples (const void *a_, const void *b_)
+{
+    unsigned long a = *(const unsigned long*) a_;
+    unsigned long b = *(const unsigned long*) b_;
+    return a < b ? -1 : a > b ? 1 : 0;
+}
+
+//  Prints the latency below which the given fraction of the roundtrips
+//  completed. Latency is half of the roundtrip time, as for the average.
+static void print_percentile (unsigned long *samples_, const char *name_,
+    double fraction_)
+{
+    int i = (int) (fraction_ * (roundtrip_count - 1));
+    printf ("%s latency: %.3f [us]\n", name_, (double) samples_ [i] / 2);
+}
+
 #if defined ZMQ_HAVE_WINDOWS
 static unsigned int __stdcall worker (void *ctx_)
 #else
@@ -110,16 +126,23 @@ int main (int argc, char *argv [])
     int i;
     zmq_msg_t msg;
     void *watch;
+    void *sample_watch;
     unsigned long elapsed;
+    unsigned long *samples;
     double latency;
 
-    if (argc != 3) {
-        printf ("usage: inproc_lat <message-size> <roundtrip-count>\n");
+    if (argc != 3 && argc != 4) {
+        printf ("usage: inproc_lat <message-size> <roundtrip-count> "
+            "[spin-time]\n");
         return 1;
     }
 
     message_size = atoi (argv [1]);
     roundtrip_count = atoi (argv [2]);
+    if (roundtrip_count < 1) {
+        printf ("roundtrip count must be positive\n");
+        return 1;
+    }
 
     ctx = zmq_init (1);
     if (!ctx) {
@@ -127,6 +150,21 @@ int main (int argc, char *argv [])
         return -1;
     }
 
+    if (argc == 4) {
+        rc = zmq_ctx_set (ctx, ZMQ_SPIN_TIME, atoi (argv [3]));
+        if (rc != 0) {
+            printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    samples = (unsigned long*) malloc (roundtrip_count *
+        sizeof (unsigned long));
+    if (!samples) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
     s = zmq_socket (ctx, ZMQ_REQ);
     if (!s) {
         printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
@@ -163,10 +201,13 @@ int main (int argc, char *argv [])
 
     printf ("message size: %d [B]\n", (int) message_size);
     printf ("roundtrip count: %d\n", (int) roundtrip_count);
+    if (argc == 4)
+        printf ("spin time: %d [us]\n", zmq_ctx_get (ctx, ZMQ_SPIN_TIME));
 
     watch = zmq_stopwatch_start ();
 
     for (i = 0; i != roundtrip_count; i++) {
+        sample_watch = zmq_stopwatch_start ();
         rc = zmq_sendmsg (s, &msg, 0);
         if (rc < 0) {
             printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
@@ -181,6 +222,7 @@ int main (int argc, char *argv [])
             printf ("message of incorrect size received\n");
             return -1;
         }
+        samples [i] = zmq_stopwatch_stop (sample_watch);
     }
 
     elapsed = zmq_stopwatch_stop (watch);
@@ -214,6 +256,14 @@ int main (int argc, char *argv [])
 
     printf ("average latency: %.3f [us]\n", (double) latency);
 
+    qsort (samples, roundtrip_count, sizeof (unsigned long), compare_samples);
+    print_percentile (samples, "50th percentile", 0.5);
+    print_percentile (samples, "90th percentile", 0.9);
+    print_percentile (samples, "99th percentile", 0.99);
+    print_percentile (samples, "99.9th percentile", 0.999);
+    print_percentile (samples, "maximum", 1);
+    free (samples);
+
     rc = zmq_close (s);
     if (rc != 0) {
         printf ("error in zmq_close: %s\n", zmq_strerror (errno));
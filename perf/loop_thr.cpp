@@ -0,0 +1,324 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+static void *ctx;
+static int socket_count;
+static size_t message_size;
+static int message_count;
+
+//  Connects a socket to each of the receiving sockets and sends the
+//  messages to them in turn.
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall sender (void *arg_)
+#else
+static void *sender (void *arg_)
+#endif
+{
+    const char *prefix = (const char*) arg_;
+    void **sockets = (void**) malloc (socket_count * sizeof (void*));
+    if (!sockets) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+
+    for (int i = 0; i != socket_count; i++) {
+        char endpoint [64];
+        sprintf (endpoint, "inproc://%s-%d", prefix, i);
+        sockets [i] = zmq_socket (ctx, ZMQ_PUSH);
+        if (!sockets [i]) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        int rc = zmq_connect (sockets [i], endpoint);
+        if (rc != 0) {
+            printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    for (int i = 0; i != message_count; i++) {
+        zmq_msg_t msg;
+        int rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_sendmsg (sockets [i % socket_count], &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    for (int i = 0; i != socket_count; i++) {
+        int rc = zmq_close (sockets [i]);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+    free (sockets);
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//  Binds the receiving sockets, starts the sender and waits for it.
+static int run (const char *prefix_, void **sockets_,
+    int (*receive_) (void **))
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE sender_thread;
+#else
+    pthread_t sender_thread;
+#endif
+    int rc;
+
+    for (int i = 0; i != socket_count; i++) {
+        char endpoint [64];
+        sprintf (endpoint, "inproc://%s-%d", prefix_, i);
+        sockets_ [i] = zmq_socket (ctx, ZMQ_PULL);
+        if (!sockets_ [i]) {
+            printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        rc = zmq_bind (sockets_ [i], endpoint);
+        if (rc != 0) {
+            printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    sender_thread = (HANDLE) _beginthreadex (NULL, 0,
+        sender, (void*) prefix_, 0 , NULL);
+    if (sender_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&sender_thread, NULL, sender, (void*) prefix_);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    void *watch = zmq_stopwatch_start ();
+    if (receive_ (sockets_) != 0)
+        return -1;
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (sender_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (sender_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (sender_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    for (int i = 0; i != socket_count; i++) {
+        rc = zmq_close (sockets_ [i]);
+        if (rc != 0) {
+            printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    unsigned long throughput = (unsigned long)
+        ((double) message_count / (double) elapsed * 1000000);
+    printf ("%s: %d [msg/s] (%.3f [us] per message)\n", prefix_,
+        (int) throughput, (double) elapsed / message_count);
+    return 0;
+}
+
+//  The usual way: poll all the sockets and receive a message from each
+//  socket that's ready.
+static int receive_with_poll (void **sockets_)
+{
+    zmq_pollitem_t *items = (zmq_pollitem_t*) malloc (socket_count *
+        sizeof (zmq_pollitem_t));
+    if (!items) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+    for (int i = 0; i != socket_count; i++) {
+        items [i].socket = sockets_ [i];
+        items [i].fd = 0;
+        items [i].events = ZMQ_POLLIN;
+    }
+
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int received = 0;
+    while (received != message_count) {
+        rc = zmq_poll (items, socket_count, -1);
+        if (rc < 0) {
+            printf ("error in zmq_poll: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        for (int i = 0; i != socket_count; i++) {
+            if (!(items [i].revents & ZMQ_POLLIN))
+                continue;
+            rc = zmq_recvmsg (sockets_ [i], &msg, 0);
+            if (rc < 0) {
+                printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+                return -1;
+            }
+            received++;
+        }
+    }
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    free (items);
+    return 0;
+}
+
+static int count_message (void *loop_, void *socket_, zmq_msg_t *msg_,
+    void *arg_)
+{
+    (void) loop_;
+    (void) socket_;
+    (void) msg_;
+    return ++*(int*) arg_ == message_count ? -1 : 0;
+}
+
+//  The reactor, handing over all the messages a ready socket has.
+static int receive_with_loop (void **sockets_)
+{
+    void *loop = zmq_loop_new ();
+    if (!loop) {
+        printf ("error in zmq_loop_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int received = 0;
+    for (int i = 0; i != socket_count; i++) {
+        int rc = zmq_loop_add (loop, sockets_ [i], count_message, &received);
+        if (rc != 0) {
+            printf ("error in zmq_loop_add: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+
+    int rc = zmq_loop_run (loop);
+    if (rc != 0) {
+        printf ("error in zmq_loop_run: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_loop_destroy (&loop);
+    if (rc != 0) {
+        printf ("error in zmq_loop_destroy: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    return 0;
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 4) {
+        printf ("usage: loop_thr <socket-count> <message-size> "
+            "<message-count>\n");
+        return 1;
+    }
+    socket_count = atoi (argv [1]);
+    message_size = atoi (argv [2]);
+    message_count = atoi (argv [3]);
+    if (socket_count < 1 || message_count < 1) {
+        printf ("socket and message counts must be positive\n");
+        return 1;
+    }
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+    int rc = zmq_ctx_set (ctx, ZMQ_MAX_SOCKETS, 4 * socket_count + 16);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void **sockets = (void**) malloc (socket_count * sizeof (void*));
+    if (!sockets) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    printf ("socket count: %d\n", socket_count);
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+
+    if (run ("zmq_poll", sockets, receive_with_poll) != 0 ||
+          run ("zmq_loop", sockets, receive_with_loop) != 0)
+        return -1;
+
+    free (sockets);
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//  Measures throughput of many threads sending to a single socket over
+//  inproc. The high water marks are kept low so that the pipes keep
+//  switching between full and empty, and every sender thread keeps posting
+//  activation commands to the mailbox of the receiving socket.
+
+static void *ctx;
+static int message_count;
+static size_t message_size;
+
+static void sender (void *)
+{
+    int rc;
+    int i;
+    int hwm;
+    void *s;
+    char *buf;
+
+    buf = (char*) malloc (message_size + 1);
+    if (!buf) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+    memset (buf, 0, message_size + 1);
+
+    s = zmq_socket (ctx, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    hwm = 10;
+    rc = zmq_setsockopt (s, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, "inproc://mailbox_thr");
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != message_count; i++) {
+        rc = zmq_send (s, buf, message_size, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    free (buf);
+}
+
+int main (int argc, char *argv [])
+{
+    int thread_count;
+    void **threads;
+    void *s;
+    int rc;
+    int i;
+    int hwm;
+    int total;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+    double throughput;
+
+    if (argc != 4) {
+        printf ("usage: mailbox_thr <thread-count> <message-size> "
+            "<message-count>\n");
+        return 1;
+    }
+    thread_count = atoi (argv [1]);
+    message_size = atoi (argv [2]);
+    message_count = atoi (argv [3]);
+    if (thread_count < 1 || message_count < 1) {
+        printf ("thread count and message count must be positive\n");
+        return 1;
+    }
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    hwm = 10;
+    rc = zmq_setsockopt (s, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, "inproc://mailbox_thr");
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    threads = (void**) malloc (thread_count * sizeof (void*));
+    if (!threads) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != thread_count; i++)
+        threads [i] = zmq_threadstart (sender, NULL);
+
+    total = thread_count * message_count;
+    for (i = 0; i != total; i++) {
+        rc = zmq_msg_recv (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            return -1;
+        }
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    for (i = 0; i != thread_count; i++)
+        zmq_threadclose (threads [i]);
+    free (threads);
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    throughput = ((double) total / (double) elapsed * 1000000);
+
+    printf ("thread count: %d\n", thread_count);
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d [per thread]\n", message_count);
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures message throughput for payloads from 64B to 64kB, once with
+//  message bodies allocated by malloc and once with ZMQ_MSG_POOL enabled.
+//  Messages are sent by a separate thread, so with the pool enabled every
+//  message body is released on a different thread than the one that
+//  allocated it.
+
+static const char *address;
+static int message_count;
+static size_t message_size;
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *ctx_)
+#else
+static void *worker (void *ctx_)
+#endif
+{
+    void *s;
+    int rc;
+    int i;
+    char *buf;
+
+    buf = (char*) malloc (message_size);
+    if (!buf) {
+        printf ("error in malloc\n");
+        exit (1);
+    }
+    memset (buf, 0, message_size);
+
+    s = zmq_socket (ctx_, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, address);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != message_count; i++) {
+        rc = zmq_send (s, buf, message_size, 0);
+        if (rc < 0) {
+            printf ("error in zmq_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    free (buf);
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static unsigned long measure (int msg_pool_)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE local_thread;
+#else
+    pthread_t local_thread;
+#endif
+    void *ctx;
+    void *s;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_ctx_set (ctx, ZMQ_MSG_POOL, msg_pool_);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_set: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_bind (s, address);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    local_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, ctx, 0 , NULL);
+    if (local_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        exit (1);
+    }
+#else
+    rc = pthread_create (&local_thread, NULL, worker, ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        exit (1);
+    }
+#endif
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_msg_recv (&msg, s, 0);
+    if (rc < 0) {
+        printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != message_count - 1; i++) {
+        rc = zmq_msg_recv (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            exit (1);
+        }
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (local_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        exit (1);
+    }
+    BOOL rc3 = CloseHandle (local_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        exit (1);
+    }
+#else
+    rc = pthread_join (local_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        exit (1);
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    return (unsigned long)
+        ((double) (message_count - 1) / (double) elapsed * 1000000);
+}
+
+int main (int argc, char *argv [])
+{
+    unsigned long malloc_thr;
+    unsigned long pool_thr;
+
+    if (argc != 3) {
+        printf ("usage: pool_thr <bind-to> <message-count>\n");
+        return 1;
+    }
+
+    address = argv [1];
+    message_count = atoi (argv [2]);
+    if (message_count < 2) {
+        printf ("message count must be at least 2\n");
+        return 1;
+    }
+
+    printf ("message count: %d\n", (int) message_count);
+    printf ("%10s %16s %16s\n", "size [B]", "malloc [msg/s]", "pool [msg/s]");
+
+    for (message_size = 64; message_size <= 65536; message_size *= 4) {
+        malloc_thr = measure (0);
+        pool_thr = measure (1);
+        printf ("%10d %16lu %16lu\n", (int) message_size, malloc_thr,
+            pool_thr);
+    }
+
+    return 0;
+}
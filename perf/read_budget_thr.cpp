@@ -0,0 +1,241 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+static const char *endpoint = "tcp://127.0.0.1:5570";
+static size_t message_size;
+static int message_count;
+
+//  Streams all the messages over a single connection.
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall sender (void *ctx_)
+#else
+static void *sender (void *ctx_)
+#endif
+{
+    void *s = zmq_socket (ctx_, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    int rc = zmq_connect (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (int i = 0; i != message_count; i++) {
+        zmq_msg_t msg;
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_sendmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//  Receives the messages of one fat connection with the given read budgets
+//  and prints the throughput.
+static int run (int read_budget_, int read_budget_msgs_)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE sender_thread;
+#else
+    pthread_t sender_thread;
+#endif
+
+    //  Each side gets a context of its own, so that the receiving engine
+    //  doesn't share its I/O thread with the sending one.
+    void *ctx = zmq_ctx_new ();
+    void *remote_ctx = zmq_ctx_new ();
+    if (!ctx || !remote_ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int rc = zmq_setsockopt (s, ZMQ_READ_BUDGET, &read_budget_,
+        sizeof read_budget_);
+    if (rc == 0)
+        rc = zmq_setsockopt (s, ZMQ_READ_BUDGET_MSGS, &read_budget_msgs_,
+            sizeof read_budget_msgs_);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_bind (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    sender_thread = (HANDLE) _beginthreadex (NULL, 0,
+        sender, remote_ctx, 0 , NULL);
+    if (sender_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&sender_thread, NULL, sender, remote_ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  The clock starts with the first message, so that connection
+    //  setup is not measured.
+    rc = zmq_recvmsg (s, &msg, 0);
+    if (rc < 0) {
+        printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *watch = zmq_stopwatch_start ();
+    for (int i = 1; i != message_count; i++) {
+        rc = zmq_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (sender_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (sender_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (sender_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc == 0)
+        rc = zmq_ctx_term (remote_ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    double count = message_count - 1;
+    unsigned long throughput = (unsigned long)
+        (count / (double) elapsed * 1000000);
+    double megabits = (double) (throughput * message_size * 8) / 1000000;
+    printf ("read budget %d [B], %d [msg]: %d [msg/s], %.3f [Mb/s]\n",
+        read_budget_, read_budget_msgs_, (int) throughput, megabits);
+    return 0;
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 4 && argc != 5) {
+        printf ("usage: read_budget_thr <message-size> <message-count> "
+            "<read-budget> [<read-budget-msgs>]\n");
+        return 1;
+    }
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    int read_budget = atoi (argv [3]);
+    int read_budget_msgs = argc == 5 ? atoi (argv [4]) : 0;
+    if (message_count < 2) {
+        printf ("message count must be at least 2\n");
+        return 1;
+    }
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+
+    //  The default budget reads a single batch per input event.
+    if (run (8192, 0) != 0 || run (read_budget, read_budget_msgs) != 0)
+        return -1;
+
+    return 0;
+}
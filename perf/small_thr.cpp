@@ -0,0 +1,248 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+//  Measures message throughput for small payloads around the size of the
+//  largest message stored inline in zmq_msg_t. Run it against builds with
+//  and without ZMQ_CACHELINE_MSG to see the effect of the larger inline
+//  payloads on both inproc and tcp transports.
+
+static const size_t message_sizes [] = {8, 16, 29, 30, 40, 48, 57, 64};
+
+static const char *address;
+static int message_count;
+static size_t message_size;
+
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall worker (void *ctx_)
+#else
+static void *worker (void *ctx_)
+#endif
+{
+    void *s;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+
+    s = zmq_socket (ctx_, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, address);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (i = 0; i != message_count; i++) {
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        memset (zmq_msg_data (&msg), 0, message_size);
+        rc = zmq_msg_send (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_send: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+static unsigned long measure (const char *address_)
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE local_thread;
+#else
+    pthread_t local_thread;
+#endif
+    void *ctx;
+    void *s;
+    int rc;
+    int i;
+    zmq_msg_t msg;
+    void *watch;
+    unsigned long elapsed;
+
+    ctx = zmq_ctx_new ();
+    if (!ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    address = address_;
+
+    s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_bind (s, address);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    local_thread = (HANDLE) _beginthreadex (NULL, 0,
+        worker, ctx, 0 , NULL);
+    if (local_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        exit (1);
+    }
+#else
+    rc = pthread_create (&local_thread, NULL, worker, ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        exit (1);
+    }
+#endif
+
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_msg_recv (&msg, s, 0);
+    if (rc < 0) {
+        printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    watch = zmq_stopwatch_start ();
+
+    for (i = 0; i != message_count - 1; i++) {
+        rc = zmq_msg_recv (&msg, s, 0);
+        if (rc < 0) {
+            printf ("error in zmq_msg_recv: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        if (zmq_msg_size (&msg) != message_size) {
+            printf ("message of incorrect size received\n");
+            exit (1);
+        }
+    }
+
+    elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (local_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        exit (1);
+    }
+    BOOL rc3 = CloseHandle (local_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        exit (1);
+    }
+#else
+    rc = pthread_join (local_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        exit (1);
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    return (unsigned long)
+        ((double) (message_count - 1) / (double) elapsed * 1000000);
+}
+
+int main (int argc, char *argv [])
+{
+    unsigned long inproc_thr;
+    unsigned long tcp_thr;
+    size_t i;
+
+    if (argc != 3) {
+        printf ("usage: small_thr <tcp-bind-to> <message-count>\n");
+        return 1;
+    }
+
+    message_count = atoi (argv [2]);
+    if (message_count < 2) {
+        printf ("message count must be at least 2\n");
+        return 1;
+    }
+
+    printf ("zmq_msg_t size: %d [B]\n", (int) sizeof (zmq_msg_t));
+    printf ("message count: %d\n", (int) message_count);
+    printf ("%10s %16s %16s\n", "size [B]", "inproc [msg/s]", "tcp [msg/s]");
+
+    for (i = 0; i != sizeof message_sizes / sizeof message_sizes [0]; i++) {
+        message_size = message_sizes [i];
+        inproc_thr = measure ("inproc://small_thr");
+        tcp_thr = measure (argv [1]);
+        printf ("%10d %16lu %16lu\n", (int) message_size, inproc_thr,
+            tcp_thr);
+    }
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+#include "../src/timer_wheel.hpp"
+#include "../src/i_poll_events.hpp"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+//  Measures the cost of adding, cancelling and expiring timers in the timer
+//  wheel used by the I/O threads. The wheel is driven by a simulated clock,
+//  the way an I/O thread would drive it if it had nothing else to do, so
+//  only the bookkeeping gets measured.
+
+static uint64_t now;
+
+struct sink_t : public zmq::i_poll_events
+{
+    sink_t () : fired (0), late (false) {}
+    void in_event () {}
+    void out_event () {}
+    void timer_event (int)
+    {
+        fired++;
+        late = now != expiration;
+    }
+    uint64_t expiration;
+    int fired;
+    bool late;
+};
+
+static void report (const char *operation_, int count_,
+    unsigned long elapsed_)
+{
+    if (elapsed_ == 0)
+        elapsed_ = 1;
+    printf ("%s: %.1f [ns/timer], %d [timers/s]\n", operation_,
+        (double) elapsed_ * 1000 / count_,
+        (int) ((double) count_ / elapsed_ * 1000000));
+}
+
+int main (int argc, char *argv [])
+{
+    int timer_count;
+    int max_timeout;
+    int *timeouts;
+    sink_t *sinks;
+    zmq::timer_wheel_t *wheel;
+    void *watch;
+    unsigned long elapsed;
+    uint64_t wait;
+    int loops;
+    int i;
+
+    if (argc != 2 && argc != 3) {
+        printf ("usage: timer_thr <timer-count> [max-timeout]\n");
+        return 1;
+    }
+    timer_count = atoi (argv [1]);
+    max_timeout = argc == 3 ? atoi (argv [2]) : 30000;
+    if (timer_count < 2 || max_timeout < 1) {
+        printf ("timer count must be at least 2 and timeout positive\n");
+        return 1;
+    }
+
+    //  Every timer gets its own sink, as every session and connecter owns
+    //  its timers.
+    timeouts = (int*) malloc (timer_count * sizeof (int));
+    sinks = new (std::nothrow) sink_t [timer_count];
+    wheel = new (std::nothrow) zmq::timer_wheel_t;
+    if (!timeouts || !sinks || !wheel) {
+        printf ("error in malloc\n");
+        return -1;
+    }
+    srand (1);
+    now = 1000;
+    for (i = 0; i != timer_count; i++) {
+        timeouts [i] = 1 + rand () % max_timeout;
+        sinks [i].expiration = now + timeouts [i];
+    }
+
+    watch = zmq_stopwatch_start ();
+    for (i = 0; i != timer_count; i++)
+        wheel->add (now, timeouts [i], &sinks [i], 1);
+    elapsed = zmq_stopwatch_stop (watch);
+    report ("add", timer_count, elapsed);
+
+    //  Cancel every other timer, in a different order than they were
+    //  added, and add them back.
+    watch = zmq_stopwatch_start ();
+    for (i = timer_count - 1; i >= 0; i -= 2)
+        wheel->cancel (&sinks [i], 1);
+    elapsed = zmq_stopwatch_stop (watch);
+    report ("cancel", timer_count / 2, elapsed);
+
+    for (i = timer_count - 1; i >= 0; i -= 2)
+        wheel->add (now, timeouts [i], &sinks [i], 1);
+
+    //  Let all the timers expire.
+    loops = 0;
+    watch = zmq_stopwatch_start ();
+    while ((wait = wheel->execute (now)) != 0) {
+        now += wait;
+        loops++;
+    }
+    elapsed = zmq_stopwatch_stop (watch);
+    report ("expire", timer_count, elapsed);
+
+    for (i = 0; i != timer_count; i++)
+        if (sinks [i].fired != 1 || sinks [i].late) {
+            printf ("timer %d fired %d times, %s\n", i, sinks [i].fired,
+                sinks [i].late ? "late" : "on time");
+            return -1;
+        }
+
+    printf ("timer count: %d\n", timer_count);
+    printf ("max timeout: %d [ms]\n", max_timeout);
+    printf ("wakeups: %d\n", loops);
+
+    delete wheel;
+    delete [] sinks;
+    free (timeouts);
+
+    return 0;
+}
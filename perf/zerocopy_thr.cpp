@@ -0,0 +1,270 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../include/zmq.h"
+#include "../include/zmq_utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+static const char *endpoint = "tcp://127.0.0.1:5570";
+static size_t message_size;
+static int message_count;
+static int zerocopy_threshold;
+
+//  Returns the CPU time, user and system, used by the process so far,
+//  in microseconds.
+static double cpu_time ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    FILETIME creation, exit, kernel, user;
+    GetProcessTimes (GetCurrentProcess (), &creation, &exit, &kernel, &user);
+    ULARGE_INTEGER k, u;
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (double) (k.QuadPart + u.QuadPart) / 10;
+#else
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    return (double) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000 +
+        usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+#endif
+}
+
+//  Streams all the messages over a single connection.
+#if defined ZMQ_HAVE_WINDOWS
+static unsigned int __stdcall sender (void *ctx_)
+#else
+static void *sender (void *ctx_)
+#endif
+{
+    void *s = zmq_socket (ctx_, ZMQ_PUSH);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    int rc = zmq_setsockopt (s, ZMQ_ZEROCOPY_THRESHOLD, &zerocopy_threshold,
+        sizeof zerocopy_threshold);
+    if (rc != 0) {
+        printf ("error in zmq_setsockopt: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    rc = zmq_connect (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_connect: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+    for (int i = 0; i != message_count; i++) {
+        zmq_msg_t msg;
+        rc = zmq_msg_init_size (&msg, message_size);
+        if (rc != 0) {
+            printf ("error in zmq_msg_init_size: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+        rc = zmq_sendmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_sendmsg: %s\n", zmq_strerror (errno));
+            exit (1);
+        }
+    }
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        exit (1);
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+//  Streams the messages between two contexts of this process and prints
+//  the throughput and the CPU time used per gigabyte transferred.
+static int run ()
+{
+#if defined ZMQ_HAVE_WINDOWS
+    HANDLE sender_thread;
+#else
+    pthread_t sender_thread;
+#endif
+
+    //  Each side gets a context of its own, so that the receiving engine
+    //  doesn't share its I/O thread with the sending one.
+    void *ctx = zmq_ctx_new ();
+    void *remote_ctx = zmq_ctx_new ();
+    if (!ctx || !remote_ctx) {
+        printf ("error in zmq_ctx_new: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    void *s = zmq_socket (ctx, ZMQ_PULL);
+    if (!s) {
+        printf ("error in zmq_socket: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    int rc = zmq_bind (s, endpoint);
+    if (rc != 0) {
+        printf ("error in zmq_bind: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    sender_thread = (HANDLE) _beginthreadex (NULL, 0,
+        sender, remote_ctx, 0 , NULL);
+    if (sender_thread == 0) {
+        printf ("error in _beginthreadex\n");
+        return -1;
+    }
+#else
+    rc = pthread_create (&sender_thread, NULL, sender, remote_ctx);
+    if (rc != 0) {
+        printf ("error in pthread_create: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_init: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    //  The clock starts with the first message, so that connection
+    //  setup is not measured.
+    rc = zmq_recvmsg (s, &msg, 0);
+    if (rc < 0) {
+        printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    double cpu_start = cpu_time ();
+    void *watch = zmq_stopwatch_start ();
+    for (int i = 1; i != message_count; i++) {
+        rc = zmq_recvmsg (s, &msg, 0);
+        if (rc < 0) {
+            printf ("error in zmq_recvmsg: %s\n", zmq_strerror (errno));
+            return -1;
+        }
+    }
+    unsigned long elapsed = zmq_stopwatch_stop (watch);
+    if (elapsed == 0)
+        elapsed = 1;
+    double cpu = cpu_time () - cpu_start;
+
+    rc = zmq_msg_close (&msg);
+    if (rc != 0) {
+        printf ("error in zmq_msg_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+#if defined ZMQ_HAVE_WINDOWS
+    DWORD rc2 = WaitForSingleObject (sender_thread, INFINITE);
+    if (rc2 == WAIT_FAILED) {
+        printf ("error in WaitForSingleObject\n");
+        return -1;
+    }
+    BOOL rc3 = CloseHandle (sender_thread);
+    if (rc3 == 0) {
+        printf ("error in CloseHandle\n");
+        return -1;
+    }
+#else
+    rc = pthread_join (sender_thread, NULL);
+    if (rc != 0) {
+        printf ("error in pthread_join: %s\n", zmq_strerror (rc));
+        return -1;
+    }
+#endif
+
+    rc = zmq_close (s);
+    if (rc != 0) {
+        printf ("error in zmq_close: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    rc = zmq_ctx_term (ctx);
+    if (rc == 0)
+        rc = zmq_ctx_term (remote_ctx);
+    if (rc != 0) {
+        printf ("error in zmq_ctx_term: %s\n", zmq_strerror (errno));
+        return -1;
+    }
+
+    double count = message_count - 1;
+    unsigned long throughput = (unsigned long)
+        (count / (double) elapsed * 1000000);
+    double megabits = (double) (throughput * message_size * 8) / 1000000;
+    double gigabytes = count * message_size / 1000000000;
+    printf ("%-9s: %8d [msg/s] %10.3f [Mb/s] %8.3f [CPU s/GB]\n",
+        zerocopy_threshold ? "zerocopy" : "copy", (int) throughput, megabits,
+        cpu / 1000000 / gigabytes);
+    return 0;
+}
+
+int main (int argc, char *argv [])
+{
+    if (argc != 3) {
+        printf ("usage: zerocopy_thr <message-size> <message-count>\n");
+        return 1;
+    }
+    message_size = atoi (argv [1]);
+    message_count = atoi (argv [2]);
+    if (message_count < 2) {
+        printf ("message count must be at least 2\n");
+        return 1;
+    }
+
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+
+    //  The messages are sent copied first, then with every message body
+    //  sent with MSG_ZEROCOPY. Over loopback the kernel copies the data
+    //  on delivery anyway, so the gain shows with a real network device
+    //  only; the difference here is the cost of tracking the completions.
+    zerocopy_threshold = 0;
+    if (run () != 0)
+        return -1;
+    zerocopy_threshold = 1;
+    if (run () != 0)
+        return -1;
+
+    return 0;
+}
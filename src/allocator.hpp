@@ -0,0 +1,71 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_ALLOCATOR_HPP_INCLUDED__
+#define __ZMQ_ALLOCATOR_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <stdlib.h>
+
+//  Signatures of the functions used to allocate and deallocate memory
+//  blocks. The deallocation function has the same signature as msg_free_fn
+//  so that it can be stored in the message content directly.
+extern "C"
+{
+    typedef void *(msg_alloc_fn) (size_t size, void *hint);
+    typedef void (msg_dealloc_fn) (void *ptr, void *hint);
+}
+
+namespace zmq
+{
+
+    //  Allocator used for message bodies. If alloc_fn is NULL, plain
+    //  malloc/free is used. The structure is copied by value into socket
+    //  options so that it can be used without any synchronisation.
+
+    struct allocator_t
+    {
+        inline allocator_t () :
+            alloc_fn (NULL),
+            free_fn (NULL),
+            hint (NULL)
+        {
+        }
+
+        inline void *allocate (size_t size_) const
+        {
+            return alloc_fn ? alloc_fn (size_, hint) : malloc (size_);
+        }
+
+        inline void deallocate (void *ptr_) const
+        {
+            if (free_fn)
+                free_fn (ptr_, hint);
+            else
+                free (ptr_);
+        }
+
+        msg_alloc_fn *alloc_fn;
+        msg_dealloc_fn *free_fn;
+        void *hint;
+    };
+
+}
+
+#endif
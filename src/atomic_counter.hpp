@@ -39,11 +39,25 @@
 #define ZMQ_ATOMIC_COUNTER_MUTEX
 #endif
 
-#if defined ZMQ_ATOMIC_COUNTER_MUTEX
+//  The 64-bit counter relies on the compiler's builtins where 64-bit
+//  atomic operations are native.
+#if defined ZMQ_FORCE_MUTEXES
+#define ZMQ_ATOMIC_COUNTER64_MUTEX
+#elif (defined __x86_64__ || defined __aarch64__) && defined __GNUC__
+#define ZMQ_ATOMIC_COUNTER64_SYNC
+#elif defined ZMQ_HAVE_WINDOWS
+#define ZMQ_ATOMIC_COUNTER64_WINDOWS
+#else
+#define ZMQ_ATOMIC_COUNTER64_MUTEX
+#endif
+
+#if defined ZMQ_ATOMIC_COUNTER_MUTEX || defined ZMQ_ATOMIC_COUNTER64_MUTEX
 #include "mutex.hpp"
-#elif defined ZMQ_ATOMIC_COUNTER_WINDOWS
+#endif
+#if defined ZMQ_ATOMIC_COUNTER_WINDOWS || defined ZMQ_ATOMIC_COUNTER64_WINDOWS
 #include "windows.hpp"
-#elif defined ZMQ_ATOMIC_COUNTER_ATOMIC_H
+#endif
+#if defined ZMQ_ATOMIC_COUNTER_ATOMIC_H
 #include <atomic.h>
 #elif defined ZMQ_ATOMIC_COUNTER_TILE
 #include <arch/atomic.h>
@@ -182,6 +196,59 @@ namespace zmq
         const atomic_counter_t& operator = (const atomic_counter_t&);
     };
 
+    //  A 64-bit counter that can be incremented and read in atomic
+    //  fashion, for statistics that would wrap around too soon otherwise.
+
+    class atomic_counter64_t
+    {
+    public:
+
+        typedef uint64_t integer_t;
+
+        inline atomic_counter64_t () :
+            value (0)
+        {
+        }
+
+        //  Atomic addition.
+        inline void add (integer_t increment_)
+        {
+#if defined ZMQ_ATOMIC_COUNTER64_SYNC
+            __sync_fetch_and_add (&value, increment_);
+#elif defined ZMQ_ATOMIC_COUNTER64_WINDOWS
+            InterlockedExchangeAdd64 ((LONGLONG*) &value, increment_);
+#else
+            sync.lock ();
+            value += increment_;
+            sync.unlock ();
+#endif
+        }
+
+        inline integer_t get ()
+        {
+#if defined ZMQ_ATOMIC_COUNTER64_SYNC
+            return __sync_fetch_and_add (&value, 0);
+#elif defined ZMQ_ATOMIC_COUNTER64_WINDOWS
+            return InterlockedCompareExchange64 ((LONGLONG*) &value, 0, 0);
+#else
+            sync.lock ();
+            integer_t result = value;
+            sync.unlock ();
+            return result;
+#endif
+        }
+
+    private:
+
+        volatile integer_t value;
+#if defined ZMQ_ATOMIC_COUNTER64_MUTEX
+        mutex_t sync;
+#endif
+
+        atomic_counter64_t (const atomic_counter64_t&);
+        const atomic_counter64_t& operator = (const atomic_counter64_t&);
+    };
+
 }
 
 //  Remove macros local to this file.
@@ -200,6 +267,15 @@ namespace zmq
 #if defined ZMQ_ATOMIC_COUNTER_MUTEX
 #undef ZMQ_ATOMIC_COUNTER_MUTEX
 #endif
+#if defined ZMQ_ATOMIC_COUNTER64_SYNC
+#undef ZMQ_ATOMIC_COUNTER64_SYNC
+#endif
+#if defined ZMQ_ATOMIC_COUNTER64_WINDOWS
+#undef ZMQ_ATOMIC_COUNTER64_WINDOWS
+#endif
+#if defined ZMQ_ATOMIC_COUNTER64_MUTEX
+#undef ZMQ_ATOMIC_COUNTER64_MUTEX
+#endif
 
 #endif
 
@@ -168,6 +168,21 @@ namespace zmq
 #endif
         }
 
+        //  Read the value of the pointer. No memory access following the
+        //  read can be moved before it.
+        inline T *load ()
+        {
+#if defined ZMQ_ATOMIC_PTR_X86
+            //  Loads are not reordered with later loads and stores on x86,
+            //  so it's enough to keep the compiler from doing so.
+            T *val = (T*) ptr;
+            __asm__ volatile ("" : : : "memory");
+            return val;
+#else
+            return cas (NULL, NULL);
+#endif
+        }
+
     private:
 
         volatile T *ptr;
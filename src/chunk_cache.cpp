@@ -0,0 +1,181 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+
+#include "chunk_cache.hpp"
+#include "config.hpp"
+#include "likely.hpp"
+#include "err.hpp"
+
+zmq::chunk_cache_t::chunk_cache_t () :
+    max_chunks (chunk_cache_size)
+{
+    for (int i = 0; i != max_sizes; i++) {
+        classes [i].size = 0;
+        classes [i].count.set (0);
+    }
+    claimed.set (0);
+}
+
+zmq::chunk_cache_t::~chunk_cache_t ()
+{
+    set_max_chunks (0);
+}
+
+void zmq::chunk_cache_t::set_max_chunks (int max_chunks_)
+{
+    zmq_assert (max_chunks_ >= 0 && max_chunks_ <= max_chunks_limit);
+
+    //  Threads that have already read the old limit may still put chunks
+    //  into the slots above the new one. Those are released here next time
+    //  or when the cache is destroyed.
+    max_chunks = max_chunks_;
+    for (int i = 0; i != max_sizes; i++) {
+        for (int j = max_chunks_; j != max_chunks_limit; j++) {
+            header_t *header = classes [i].slots [j].xchg (NULL);
+            if (header) {
+                classes [i].count.sub (1);
+                free (header);
+            }
+        }
+    }
+}
+
+int zmq::chunk_cache_t::get_max_chunks ()
+{
+    return max_chunks;
+}
+
+zmq::allocator_t zmq::chunk_cache_t::get_allocator ()
+{
+    allocator_t allocator;
+    allocator.alloc_fn = alloc_fn;
+    allocator.free_fn = free_fn;
+    allocator.hint = this;
+    return allocator;
+}
+
+uint64_t zmq::chunk_cache_t::hits ()
+{
+    return hit_count.get ();
+}
+
+uint64_t zmq::chunk_cache_t::misses ()
+{
+    return miss_count.get ();
+}
+
+uint64_t zmq::chunk_cache_t::drops ()
+{
+    return drop_count.get ();
+}
+
+int zmq::chunk_cache_t::chunks ()
+{
+    int result = 0;
+    for (int i = 0; i != max_sizes; i++)
+        result += (int) classes [i].count.get ();
+    return result;
+}
+
+zmq::chunk_cache_t::size_class_t *zmq::chunk_cache_t::find_class (
+    size_t size_, bool claim_)
+{
+    int n = (int) claimed.get ();
+    if (n > max_sizes)
+        n = max_sizes;
+    for (int i = 0; i != n; i++)
+        if (classes [i].size == size_)
+            return &classes [i];
+    if (!claim_ || n == max_sizes)
+        return NULL;
+
+    //  Two threads may claim a class for the same size at the same time.
+    //  Only the first of the two classes gets used then.
+    int i = (int) claimed.add (1);
+    if (i >= max_sizes)
+        return NULL;
+    classes [i].size = size_;
+    return &classes [i];
+}
+
+void *zmq::chunk_cache_t::allocate (size_t size_)
+{
+    size_class_t *cls = find_class (size_, false);
+    if (cls && cls->count.get () != 0) {
+        const int limit = max_chunks;
+        for (int i = 0; i != limit; i++) {
+            if (!cls->slots [i].load ())
+                continue;
+            header_t *header = cls->slots [i].xchg (NULL);
+            if (header) {
+                cls->count.sub (1);
+                hit_count.add (1);
+                return header + 1;
+            }
+        }
+    }
+    miss_count.add (1);
+
+    const size_t total = size_ + sizeof (header_t);
+    if (unlikely (total < size_))
+        return NULL;
+    header_t *header = (header_t*) malloc (total);
+    if (unlikely (!header))
+        return NULL;
+    header->size = size_;
+    return header + 1;
+}
+
+void zmq::chunk_cache_t::deallocate (void *ptr_)
+{
+    if (!ptr_)
+        return;
+    header_t *header = ((header_t*) ptr_) - 1;
+
+    const int limit = max_chunks;
+    size_class_t *cls = limit ? find_class (header->size, true) : NULL;
+    if (cls) {
+
+        //  The count is raised before the chunk is put into a slot so that
+        //  it never drops below the number of chunks in the slots.
+        if (cls->count.add (1) < (atomic_counter_t::integer_t) limit)
+            for (int i = 0; i != limit; i++) {
+                if (cls->slots [i].load ())
+                    continue;
+                if (!cls->slots [i].cas (NULL, header))
+                    return;
+            }
+        cls->count.sub (1);
+    }
+    drop_count.add (1);
+
+    free (header);
+}
+
+void *zmq::chunk_cache_t::alloc_fn (size_t size_, void *hint_)
+{
+    return ((chunk_cache_t*) hint_)->allocate (size_);
+}
+
+void zmq::chunk_cache_t::free_fn (void *ptr_, void *hint_)
+{
+    ((chunk_cache_t*) hint_)->deallocate (ptr_);
+}
@@ -0,0 +1,131 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_CHUNK_CACHE_HPP_INCLUDED__
+#define __ZMQ_CHUNK_CACHE_HPP_INCLUDED__
+
+#include <stddef.h>
+
+#include "allocator.hpp"
+#include "atomic_counter.hpp"
+#include "atomic_ptr.hpp"
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    //  Bounded cache of the memory chunks used by the message queues
+    //  (see yqueue_t) of all the pipes in a context. Chunks released by
+    //  a pipe are kept for the next pipe that needs a chunk of the same
+    //  size rather than being returned to malloc, so that pipes growing,
+    //  shrinking, or being created and destroyed in bulk don't end up
+    //  hitting malloc for every chunk.
+    //
+    //  Chunks are allocated and released by different threads (a queue
+    //  is written by one thread and read by another), hence the cache is
+    //  shared. It is lock-free: every cached chunk sits in a slot of its
+    //  own that threads take chunks from and put chunks to with a single
+    //  atomic operation.
+
+    class chunk_cache_t
+    {
+    public:
+
+        //  Upper limit for the number of chunks kept for every chunk size.
+        enum {max_chunks_limit = 256};
+
+        chunk_cache_t ();
+        ~chunk_cache_t ();
+
+        //  Sets the maximum number of chunks kept for every chunk size,
+        //  up to max_chunks_limit. Zero disables the cache. Superfluous
+        //  chunks are released.
+        void set_max_chunks (int max_chunks_);
+        int get_max_chunks ();
+
+        //  Allocator drawing the chunks from this cache.
+        allocator_t get_allocator ();
+
+        //  Statistics. Number of allocations served from the cache,
+        //  number of allocations that had to go to malloc, number of chunks
+        //  returned to malloc because the cache was full, and number of
+        //  chunks currently held by the cache.
+        uint64_t hits ();
+        uint64_t misses ();
+        uint64_t drops ();
+        int chunks ();
+
+    private:
+
+        void *allocate (size_t size_);
+        void deallocate (void *ptr_);
+
+        static void *alloc_fn (size_t size_, void *hint_);
+        static void free_fn (void *ptr_, void *hint_);
+
+        //  Header preceding every chunk handed out by the cache.
+        union header_t
+        {
+            size_t size;
+
+            //  Keeps the chunk as aligned as malloc would.
+            double align;
+        };
+
+        //  Chunks are kept for a limited number of distinct sizes. The
+        //  message queues use a handful of them. Chunks of other sizes
+        //  always go to malloc.
+        enum {max_sizes = 8};
+
+        struct size_class_t
+        {
+            //  Zero until the thread that claimed the class sets it.
+            volatile size_t size;
+
+            //  Approximate number of chunks in the slots. It is only used
+            //  to skip scanning the slots when they are all empty or full.
+            atomic_counter_t count;
+
+            atomic_ptr_t <header_t> slots [max_chunks_limit];
+        };
+
+        //  Returns the class of chunks of the given size, claiming a new
+        //  one if 'claim_' is set and there's one left. Returns NULL if
+        //  there's no such class.
+        size_class_t *find_class (size_t size_, bool claim_);
+
+        size_class_t classes [max_sizes];
+
+        //  Number of classes claimed so far. It may exceed max_sizes.
+        atomic_counter_t claimed;
+
+        //  Only the first max_chunks slots of every class are used.
+        volatile int max_chunks;
+
+        atomic_counter64_t hit_count;
+        atomic_counter64_t miss_count;
+        atomic_counter64_t drop_count;
+
+        chunk_cache_t (const chunk_cache_t&);
+        const chunk_cache_t &operator = (const chunk_cache_t&);
+    };
+
+}
+
+#endif
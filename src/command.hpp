@@ -30,6 +30,7 @@ namespace zmq
     struct i_engine;
     class pipe_t;
     class socket_base_t;
+    class io_thread_t;
 
     //  This structure defines the commands that can be sent between threads.
 
@@ -56,6 +57,7 @@ namespace zmq
             reap,
             reaped,
             inproc_connected,
+            migrate,
             done
         } type;
 
@@ -140,6 +142,12 @@ namespace zmq
             struct {
             } reaped;
 
+            //  Sent by session to itself, to the I/O thread it is moving
+            //  to, to make it register with the new thread.
+            struct {
+                zmq::io_thread_t *io_thread;
+            } migrate;
+
             //  Sent by reaper thread to the term thread when all the sockets
             //  are successfully deallocated.
             struct {
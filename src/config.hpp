@@ -32,8 +32,21 @@ namespace zmq
         //  memory allocation by approximately 99.6%
         message_pipe_granularity = 256,
 
-        //  Commands in pipe per allocation event.
-        command_pipe_granularity = 16,
+        //  Number of messages the message pipe allocates memory for initially.
+        //  The allocation unit grows up to message_pipe_granularity as the
+        //  pipe fills up, and shrinks back once the reader has kept up for a
+        //  while, so that lightly used pipes take as little memory as
+        //  possible.
+        message_pipe_min_granularity = 8,
+
+        //  Maximal number of message pipe chunks of each size kept by
+        //  the context for reuse. The cache is disabled by default.
+        chunk_cache_size = 0,
+
+        //  Weight of a message, in bytes, when measuring the load of the
+        //  I/O threads for rebalancing. It stands for the cost of handling
+        //  a message on top of the cost of moving its data.
+        rebalance_message_weight = 64,
 
         //  Determines how often does socket poll for new commands when it
         //  still has unprocessed messages to handle. Thus, if it is set to 100,
@@ -55,12 +68,50 @@ namespace zmq
         //  unnecessary network stack traversals.
         out_batch_size = 8192,
 
+        //  With adaptive batching, an engine doubles its input or output
+        //  buffer after this many reads or writes in a row that fill it,
+        //  and halves it after this many in a row that use a quarter of it
+        //  at most, keeping it between the minimal and maximal sizes below.
+        batch_grow_count = 4,
+        batch_shrink_count = 64,
+        min_batch_size = 1024,
+        max_batch_size = 262144,
+
+        //  By default, message data chunks of at least this size are not
+        //  copied to the output buffer on platforms supporting vectored I/O.
+        //  Instead, they are written directly from the message by the
+        //  'writev' call.
+        out_iov_threshold = 2048,
+
+        //  Maximal number of chunks written by a single 'writev' call.
+        out_iov_max = 64,
+
+        //  Maximal number of bytes gathered for a single 'writev' call.
+        //  Only out_batch_size bytes of them are copied to the output
+        //  buffer; the rest are written from the messages in place.
+        out_gather_max = 262144,
+
+        //  Interval, in milliseconds, at which an engine that is done checks
+        //  whether the kernel has completed all of its zero-copy sends, so
+        //  that the messages they refer to can be released.
+        zerocopy_drain_interval = 10,
+
         //  Maximal delta between high and low watermark.
         max_wm_delta = 1024,
 
         //  Maximum number of events the I/O thread can process in one go.
         max_io_events = 256,
 
+        //  Maximum number of messages the reactor hands over from a socket
+        //  each time it's found ready, so that a busy socket doesn't starve
+        //  the others.
+        loop_drain_max = 256,
+
+        //  Number of submission queue entries of the io_uring poller.
+        //  The completion queue is eight times as large so that it doesn't
+        //  overflow when many requests complete at once.
+        io_uring_entries = 1024,
+
         //  Maximal delay to process command in API thread (in CPU ticks).
         //  3,000,000 ticks equals to 1 - 2 milliseconds on current CPUs.
         //  Note that delay is only applied when there is continuous stream of
@@ -0,0 +1,50 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_CPU_RELAX_HPP_INCLUDED__
+#define __ZMQ_CPU_RELAX_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+#if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#endif
+
+namespace zmq
+{
+
+    //  Hints the CPU that the caller is spinning on a memory location.
+    //  This saves power and lets the other hardware thread of the core
+    //  run while waiting.
+    inline void cpu_relax ()
+    {
+#if defined ZMQ_HAVE_WINDOWS
+        YieldProcessor ();
+#elif (defined __GNUC__ || defined __SUNPRO_CC) && \
+    (defined __i386__ || defined __x86_64__)
+        __asm__ volatile ("pause");
+#elif defined __GNUC__ && (defined __aarch64__ || \
+    (defined __ARM_ARCH && __ARM_ARCH >= 7))
+        __asm__ volatile ("yield");
+#endif
+    }
+
+}
+
+#endif
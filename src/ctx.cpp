@@ -22,10 +22,12 @@
 #include "windows.hpp"
 #else
 #include <unistd.h>
+#include <sched.h>
 #endif
 
 #include <new>
 #include <string.h>
+#include <limits.h>
 
 #include "ctx.hpp"
 #include "socket_base.hpp"
@@ -34,6 +36,7 @@
 #include "pipe.hpp"
 #include "err.hpp"
 #include "msg.hpp"
+#include "msg_pool.hpp"
 
 #define ZMQ_CTX_TAG_VALUE_GOOD 0xabadcafe
 #define ZMQ_CTX_TAG_VALUE_BAD  0xdeadbeef
@@ -46,6 +49,12 @@ int clipped_maxsocket(int max_requested)
     return max_requested;
 }
 
+//  Statistics are reported as ints, saturating rather than wrapping around.
+static int clipped_counter (uint64_t value_)
+{
+    return value_ > (uint64_t) INT_MAX ? INT_MAX : (int) value_;
+}
+
 zmq::ctx_t::ctx_t () :
     tag (ZMQ_CTX_TAG_VALUE_GOOD),
     starting (true),
@@ -55,7 +64,13 @@ zmq::ctx_t::ctx_t () :
     slots (NULL),
     max_sockets (clipped_maxsocket (ZMQ_MAX_SOCKETS_DFLT)),
     io_thread_count (ZMQ_IO_THREADS_DFLT),
-    ipv6 (false)
+    ipv6 (false),
+    spin_time (0),
+    rebalance_ivl (0),
+    thread_sched_policy (ZMQ_THREAD_SCHED_POLICY_DFLT),
+    thread_priority (ZMQ_THREAD_PRIORITY_DFLT),
+    thread_affinity_spread (false),
+    io_busy_poll (0)
 {
 #ifdef HAVE_FORK
     pid = getpid();
@@ -171,6 +186,39 @@ int zmq::ctx_t::shutdown ()
     return 0;
 }
 
+//  Returns true if the context's threads can be run with the scheduling
+//  policy policy_.
+static bool valid_sched_policy (int policy_)
+{
+#if defined ZMQ_HAVE_WINDOWS || defined ZMQ_HAVE_OPENVMS
+    return false;
+#else
+    if (policy_ == SCHED_OTHER || policy_ == SCHED_FIFO ||
+          policy_ == SCHED_RR)
+        return true;
+#if defined SCHED_BATCH
+    if (policy_ == SCHED_BATCH)
+        return true;
+#endif
+#if defined SCHED_IDLE
+    if (policy_ == SCHED_IDLE)
+        return true;
+#endif
+    return false;
+#endif
+}
+
+//  Returns true if the priority is in the range of the scheduling policy.
+static bool valid_sched_priority (int policy_, int priority_)
+{
+#if defined ZMQ_HAVE_WINDOWS || defined ZMQ_HAVE_OPENVMS
+    return false;
+#else
+    return priority_ >= sched_get_priority_min (policy_) &&
+        priority_ <= sched_get_priority_max (policy_);
+#endif
+}
+
 int zmq::ctx_t::set (int option_, int optval_)
 {
     int rc = 0;
@@ -191,6 +239,86 @@ int zmq::ctx_t::set (int option_, int optval_)
         ipv6 = (optval_ != 0);
         opt_sync.unlock ();
     }
+    else
+    if (option_ == ZMQ_MSG_POOL && optval_ >= 0) {
+        opt_sync.lock ();
+        if (optval_) {
+            allocator.alloc_fn = msg_pool_alloc;
+            allocator.free_fn = msg_pool_free;
+            allocator.hint = NULL;
+        }
+        else
+        if (allocator.alloc_fn == msg_pool_alloc)
+            allocator = allocator_t ();
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_CHUNK_CACHE && optval_ >= 0 &&
+          optval_ <= chunk_cache_t::max_chunks_limit)
+        chunk_cache.set_max_chunks (optval_);
+    else
+    if (option_ == ZMQ_SPIN_TIME && optval_ >= 0) {
+        opt_sync.lock ();
+        spin_time = optval_;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_REBALANCE_IVL && optval_ >= 0) {
+        opt_sync.lock ();
+        rebalance_ivl = optval_;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_SCHED_POLICY && valid_sched_policy (optval_)) {
+        opt_sync.lock ();
+        if (thread_priority != -1 &&
+              !valid_sched_priority (optval_, thread_priority)) {
+            errno = EINVAL;
+            rc = -1;
+        }
+        else
+            thread_sched_policy = optval_;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_PRIORITY && optval_ >= 0) {
+        opt_sync.lock ();
+        if (thread_sched_policy != -1 &&
+              !valid_sched_priority (thread_sched_policy, optval_)) {
+            errno = EINVAL;
+            rc = -1;
+        }
+        else
+            thread_priority = optval_;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_AFFINITY_CPU_ADD && optval_ >= 0) {
+        opt_sync.lock ();
+        thread_affinity_cpus.insert (optval_);
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_AFFINITY_CPU_REMOVE && optval_ >= 0) {
+        opt_sync.lock ();
+        if (thread_affinity_cpus.erase (optval_) == 0) {
+            errno = EINVAL;
+            rc = -1;
+        }
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_AFFINITY_SPREAD && optval_ >= 0) {
+        opt_sync.lock ();
+        thread_affinity_spread = (optval_ != 0);
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_IO_BUSY_POLL && optval_ >= 0) {
+        opt_sync.lock ();
+        io_busy_poll = optval_;
+        opt_sync.unlock ();
+    }
     else {
         errno = EINVAL;
         rc = -1;
@@ -209,6 +337,81 @@ int zmq::ctx_t::get (int option_)
     else
     if (option_ == ZMQ_IPV6)
         rc = ipv6;
+    else
+    if (option_ == ZMQ_MSG_POOL) {
+        opt_sync.lock ();
+        rc = allocator.alloc_fn == msg_pool_alloc;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_CHUNK_CACHE)
+        rc = chunk_cache.get_max_chunks ();
+    else
+    if (option_ == ZMQ_CHUNK_CACHE_HITS)
+        rc = clipped_counter (chunk_cache.hits ());
+    else
+    if (option_ == ZMQ_CHUNK_CACHE_MISSES)
+        rc = clipped_counter (chunk_cache.misses ());
+    else
+    if (option_ == ZMQ_CHUNK_CACHE_DROPS)
+        rc = clipped_counter (chunk_cache.drops ());
+    else
+    if (option_ == ZMQ_CHUNK_CACHE_CHUNKS)
+        rc = chunk_cache.chunks ();
+    else
+    if (option_ == ZMQ_SPIN_TIME) {
+        opt_sync.lock ();
+        rc = spin_time;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_POLL_UPDATES_AVOIDED) {
+        uint64_t avoided = 0;
+        slot_sync.lock ();
+        for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
+            avoided += io_threads [i]->get_poller ()->get_avoided_updates ();
+        slot_sync.unlock ();
+        rc = clipped_counter (avoided);
+    }
+    else
+    if (option_ == ZMQ_REBALANCE_IVL) {
+        opt_sync.lock ();
+        rc = rebalance_ivl;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_SCHED_POLICY) {
+        opt_sync.lock ();
+        rc = thread_sched_policy;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_PRIORITY) {
+        opt_sync.lock ();
+        rc = thread_priority;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_THREAD_AFFINITY_SPREAD) {
+        opt_sync.lock ();
+        rc = thread_affinity_spread;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_IO_BUSY_POLL) {
+        opt_sync.lock ();
+        rc = io_busy_poll;
+        opt_sync.unlock ();
+    }
+    else
+    if (option_ == ZMQ_MIGRATIONS) {
+        uint64_t migrations = 0;
+        slot_sync.lock ();
+        for (io_threads_t::size_type i = 0; i != io_threads.size (); i++)
+            migrations += io_threads [i]->get_migrations ();
+        slot_sync.unlock ();
+        rc = clipped_counter (migrations);
+    }
     else {
         errno = EINVAL;
         rc = -1;
@@ -216,6 +419,55 @@ int zmq::ctx_t::get (int option_)
     return rc;
 }
 
+int zmq::ctx_t::set_allocator (msg_alloc_fn *alloc_fn_,
+    msg_dealloc_fn *free_fn_, void *hint_)
+{
+    //  Either both functions are supplied or none of them.
+    if (!alloc_fn_ != !free_fn_) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    opt_sync.lock ();
+    allocator.alloc_fn = alloc_fn_;
+    allocator.free_fn = free_fn_;
+    allocator.hint = alloc_fn_ ? hint_ : NULL;
+    opt_sync.unlock ();
+    return 0;
+}
+
+zmq::allocator_t zmq::ctx_t::get_allocator ()
+{
+    opt_sync.lock ();
+    allocator_t result = allocator;
+    opt_sync.unlock ();
+    return result;
+}
+
+zmq::allocator_t zmq::ctx_t::get_pipe_allocator ()
+{
+    opt_sync.lock ();
+    allocator_t result = allocator;
+    opt_sync.unlock ();
+    if (!result.alloc_fn && chunk_cache.get_max_chunks ())
+        result = chunk_cache.get_allocator ();
+    return result;
+}
+
+//  Returns the set containing only the (n_ modulo size)-th CPU of cpus_,
+//  or an empty set if cpus_ is empty.
+static std::set <int> nth_cpu (const std::set <int> &cpus_, int n_)
+{
+    std::set <int> result;
+    if (cpus_.empty ())
+        return result;
+    std::set <int>::const_iterator it = cpus_.begin ();
+    for (int i = n_ % (int) cpus_.size (); i != 0; i--)
+        ++it;
+    result.insert (*it);
+    return result;
+}
+
 zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
 {
     slot_sync.lock ();
@@ -227,6 +479,12 @@ zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
         opt_sync.lock ();
         int mazmq = max_sockets;
         int ios = io_thread_count;
+        int rebalance = rebalance_ivl;
+        int policy = thread_sched_policy;
+        int priority = thread_priority;
+        std::set <int> cpus = thread_affinity_cpus;
+        bool spread = thread_affinity_spread;
+        int busy_poll = io_busy_poll;
         opt_sync.unlock ();
         slot_count = mazmq + ios + 2;
         slots = (mailbox_t**) malloc (sizeof (mailbox_t*) * slot_count);
@@ -239,14 +497,19 @@ zmq::socket_base_t *zmq::ctx_t::create_socket (int type_)
         reaper = new (std::nothrow) reaper_t (this, reaper_tid);
         alloc_assert (reaper);
         slots [reaper_tid] = reaper->get_mailbox ();
+        reaper->get_poller ()->set_thread_scheduling (policy, priority, cpus);
         reaper->start ();
 
         //  Create I/O thread objects and launch them.
         for (int i = 2; i != ios + 2; i++) {
-            io_thread_t *io_thread = new (std::nothrow) io_thread_t (this, i);
+            io_thread_t *io_thread = new (std::nothrow) io_thread_t (this, i,
+                rebalance);
             alloc_assert (io_thread);
             io_threads.push_back (io_thread);
             slots [i] = io_thread->get_mailbox ();
+            io_thread->get_poller ()->set_thread_scheduling (policy, priority,
+                spread ? nth_cpu (cpus, i - 2) : cpus);
+            io_thread->get_poller ()->set_busy_poll (busy_poll);
             io_thread->start ();
         }
 
@@ -328,13 +591,19 @@ zmq::io_thread_t *zmq::ctx_t::choose_io_thread (uint64_t affinity_)
     if (io_threads.empty ())
         return NULL;
 
-    //  Find the I/O thread with minimum load.
+    //  Find the I/O thread with minimum load. The traffic is measured only
+    //  if rebalancing is enabled. Otherwise the number of file descriptors
+    //  alone decides.
+    uint32_t min_traffic = 0;
     int min_load = -1;
     io_thread_t *selected_io_thread = NULL;
     for (io_threads_t::size_type i = 0; i != io_threads.size (); i++) {
         if (!affinity_ || (affinity_ & (uint64_t (1) << i))) {
+            uint32_t traffic = io_threads [i]->get_traffic ();
             int load = io_threads [i]->get_load ();
-            if (selected_io_thread == NULL || load < min_load) {
+            if (selected_io_thread == NULL || traffic < min_traffic ||
+                  (traffic == min_traffic && load < min_load)) {
+                min_traffic = traffic;
                 min_load = load;
                 selected_io_thread = io_threads [i];
             }
@@ -343,6 +612,25 @@ zmq::io_thread_t *zmq::ctx_t::choose_io_thread (uint64_t affinity_)
     return selected_io_thread;
 }
 
+void zmq::ctx_t::choose_io_threads (uint64_t affinity_, int count_,
+    std::vector <io_thread_t*> &threads_)
+{
+    io_thread_t *first = choose_io_thread (affinity_);
+    if (!first)
+        return;
+
+    io_threads_t::size_type start = 0;
+    while (io_threads [start] != first)
+        start++;
+    for (io_threads_t::size_type n = 0; n != io_threads.size (); n++) {
+        if (count_ && threads_.size () == (size_t) count_)
+            break;
+        io_threads_t::size_type i = (start + n) % io_threads.size ();
+        if (!affinity_ || (affinity_ & (uint64_t (1) << i)))
+            threads_.push_back (io_threads [i]);
+    }
+}
+
 int zmq::ctx_t::register_endpoint (const char *addr_, endpoint_t &endpoint_)
 {
     endpoints_sync.lock ();
@@ -376,6 +664,40 @@ void zmq::ctx_t::unregister_endpoints (socket_base_t *socket_)
     endpoints_sync.unlock ();
 }
 
+int zmq::ctx_t::register_shared_port (int port_, bool first_)
+{
+    shared_ports_sync.lock ();
+
+    shared_ports_t::iterator it = shared_ports.find (port_);
+    bool taken = first_ && it != shared_ports.end ();
+    if (!taken) {
+        if (it == shared_ports.end ())
+            shared_ports.insert (shared_ports_t::value_type (port_, 1));
+        else
+            it->second++;
+    }
+
+    shared_ports_sync.unlock ();
+
+    if (taken) {
+        errno = EADDRINUSE;
+        return -1;
+    }
+    return 0;
+}
+
+void zmq::ctx_t::unregister_shared_port (int port_)
+{
+    shared_ports_sync.lock ();
+
+    shared_ports_t::iterator it = shared_ports.find (port_);
+    zmq_assert (it != shared_ports.end ());
+    if (--it->second == 0)
+        shared_ports.erase (it);
+
+    shared_ports_sync.unlock ();
+}
+
 zmq::endpoint_t zmq::ctx_t::find_endpoint (const char *addr_)
 {
      endpoints_sync.lock ();
@@ -21,6 +21,7 @@
 #define __ZMQ_CTX_HPP_INCLUDED__
 
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <stdarg.h>
@@ -31,6 +32,8 @@
 #include "mutex.hpp"
 #include "stdint.hpp"
 #include "options.hpp"
+#include "allocator.hpp"
+#include "chunk_cache.hpp"
 #include "atomic_counter.hpp"
 
 namespace zmq
@@ -90,6 +93,18 @@ namespace zmq
         int set (int option_, int optval_);
         int get (int option_);
 
+        //  Set and get the allocator to be used by the sockets of this
+        //  context. Passing NULL functions restores the default allocator.
+        int set_allocator (msg_alloc_fn *alloc_fn_, msg_dealloc_fn *free_fn_,
+            void *hint_);
+        allocator_t get_allocator ();
+
+        //  Returns the allocator for the message queues of the pipes.
+        //  The queues use the allocator set for the context, if any,
+        //  otherwise they draw from the context's chunk cache if it's
+        //  enabled.
+        allocator_t get_pipe_allocator ();
+
         //  Create and destroy a socket.
         zmq::socket_base_t *create_socket (int type_);
         void destroy_socket (zmq::socket_base_t *socket_);
@@ -102,6 +117,12 @@ namespace zmq
         //  Returns NULL if no I/O thread is available.
         zmq::io_thread_t *choose_io_thread (uint64_t affinity_);
 
+        //  Fills threads_ with up to count_ distinct I/O threads the
+        //  affinity allows (count_ = 0 means all of them), starting with
+        //  the least busy one and going on in order from there.
+        void choose_io_threads (uint64_t affinity_, int count_,
+            std::vector <zmq::io_thread_t*> &threads_);
+
         //  Returns reaper thread object.
         zmq::object_t *get_reaper ();
 
@@ -112,6 +133,13 @@ namespace zmq
         void pend_connection (const char *addr_, pending_connection_t &pending_connection_);
         void connect_pending (const char *addr_, zmq::socket_base_t *bind_socket_);
 
+        //  Management of the TCP ports listeners are sharded on. Each shard
+        //  registers the port it is bound to. The first shard of an
+        //  endpoint fails with EADDRINUSE if another endpoint holds the
+        //  port already.
+        int register_shared_port (int port_, bool first_);
+        void unregister_shared_port (int port_);
+
         enum {
             term_tid = 0,
             reaper_tid = 1
@@ -173,6 +201,11 @@ namespace zmq
         //  Synchronisation of access to the list of inproc endpoints.
         mutex_t endpoints_sync;
 
+        //  Number of listeners bound to each sharded TCP port.
+        typedef std::map <int, int> shared_ports_t;
+        shared_ports_t shared_ports;
+        mutex_t shared_ports_sync;
+
         //  Maximum socket ID.
         static atomic_counter_t max_socket_id;
 
@@ -185,6 +218,37 @@ namespace zmq
         //  Is IPv6 enabled on this context?
         bool ipv6;
 
+        //  Time the sockets spin waiting for commands before blocking,
+        //  in microseconds.
+        int spin_time;
+
+        //  Interval at which the I/O threads rebalance their sessions, in
+        //  milliseconds. Zero if sessions stay where they are.
+        int rebalance_ivl;
+
+        //  Scheduling policy and priority of the context's threads. -1 if
+        //  the OS defaults are used.
+        int thread_sched_policy;
+        int thread_priority;
+
+        //  CPUs the context's threads are allowed to run on. Empty if they
+        //  may run anywhere.
+        std::set <int> thread_affinity_cpus;
+
+        //  If true, each I/O thread is pinned to a single CPU of the set
+        //  above, round robin, rather than to the whole set.
+        bool thread_affinity_spread;
+
+        //  Time the I/O threads poll for events without blocking before
+        //  they go to sleep, in microseconds.
+        int io_busy_poll;
+
+        //  Allocator for message bodies.
+        allocator_t allocator;
+
+        //  Cache of message queue chunks shared by all the pipes.
+        chunk_cache_t chunk_cache;
+
         //  Synchronisation of access to context options.
         mutex_t opt_sync;
 
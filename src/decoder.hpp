@@ -47,13 +47,15 @@ namespace zmq
     {
     public:
 
-        inline decoder_base_t (size_t bufsize_) :
+        inline decoder_base_t (size_t bufsize_,
+              const allocator_t &allocator_) :
+            allocator (allocator_),
             next (NULL),
             read_pos (NULL),
             to_read (0),
             bufsize (bufsize_)
         {
-            buf = (unsigned char*) malloc (bufsize_);
+            buf = (unsigned char*) allocator.allocate (bufsize_);
             alloc_assert (buf);
         }
 
@@ -61,7 +63,7 @@ namespace zmq
         //  just to keep ICC and code checking tools from complaining.
         inline virtual ~decoder_base_t ()
         {
-            free (buf);
+            allocator.deallocate (buf);
         }
 
         //  Returns a buffer to be filled with binary data.
@@ -85,6 +87,16 @@ namespace zmq
             *size_ = bufsize;
         }
 
+        inline void resize_buffer (size_t size_)
+        {
+            unsigned char *new_buf =
+                (unsigned char*) allocator.allocate (size_);
+            alloc_assert (new_buf);
+            allocator.deallocate (buf);
+            buf = new_buf;
+            bufsize = size_;
+        }
+
         //  Processes the data in the buffer previously allocated using
         //  get_buffer function. size_ argument specifies nemuber of bytes
         //  actually filled into the buffer. Function returns 1 when the
@@ -147,6 +159,10 @@ namespace zmq
             next = next_;
         }
 
+        //  Allocator for the buffer and for the bodies of the decoded
+        //  messages.
+        const allocator_t allocator;
+
     private:
 
         //  Next step. If set to NULL, it means that associated data stream
@@ -125,7 +125,7 @@ void zmq::devpoll_t::reset_pollout (handle_t handle_)
 
 void zmq::devpoll_t::start ()
 {
-    worker.start (worker_routine, this);
+    start_thread (worker, worker_routine, this);
 }
 
 void zmq::devpoll_t::stop ()
@@ -46,11 +46,14 @@ namespace zmq
     {
     public:
 
-        inline encoder_base_t (size_t bufsize_) :
+        inline encoder_base_t (size_t bufsize_,
+              const allocator_t &allocator_) :
             bufsize (bufsize_),
+            allocator (allocator_),
+            copied (0),
             in_progress (NULL)
         {
-            buf = (unsigned char*) malloc (bufsize_);
+            buf = (unsigned char*) allocator.allocate (bufsize_);
             alloc_assert (buf);
         }
 
@@ -58,7 +61,7 @@ namespace zmq
         //  just to keep ICC and code checking tools from complaining.
         inline virtual ~encoder_base_t ()
         {
-            free (buf);
+            allocator.deallocate (buf);
         }
 
         //  The function returns a batch of binary data. The data
@@ -66,6 +69,17 @@ namespace zmq
         //  points to NULL) decoder object will provide buffer of its own.
         inline size_t encode (unsigned char **data_, size_t size_)
         {
+            bool in_place;
+            return encode (data_, size_, 0, in_place);
+        }
+
+        //  Same as above, except that data chunks of at least threshold_
+        //  bytes are returned in place rather than copied to the buffer.
+        //  Zero threshold means that everything is copied.
+        inline size_t encode (unsigned char **data_, size_t size_,
+            size_t threshold_, bool &in_place_)
+        {
+            in_place_ = false;
             unsigned char *buffer = !*data_ ? buf : *data_;
             size_t buffersize = !*data_ ? bufsize : size_;
 
@@ -90,6 +104,23 @@ namespace zmq
                     (static_cast <T*> (this)->*next) ();
                 }
 
+                //  Large chunks are handed to the caller in place so that
+                //  they can be written by a vectored write. If something
+                //  was copied to the buffer already, return it first.
+                //  Only message bodies stored outside of the message itself
+                //  qualify; frame headers and very small messages are kept
+                //  in storage that is reused once the chunk is returned.
+                if (threshold_ && to_write >= threshold_ && in_body ()) {
+                    if (pos)
+                        break;
+                    *data_ = write_pos;
+                    pos = to_write;
+                    write_pos = NULL;
+                    to_write = 0;
+                    in_place_ = true;
+                    return pos;
+                }
+
                 //  If there are no data in the buffer yet and we are able to
                 //  fill whole buffer in a single go, let's use zero-copy.
                 //  There's no disadvantage to it as we cannot stuck multiple
@@ -111,6 +142,7 @@ namespace zmq
                 //  Copy data to the buffer. If the buffer is full, return.
                 size_t to_copy = std::min (to_write, buffersize - pos);
                 memcpy (buffer + pos, write_pos, to_copy);
+                copied += to_copy;
                 pos += to_copy;
                 write_pos += to_copy;
                 to_write -= to_copy;
@@ -127,6 +159,23 @@ namespace zmq
             (static_cast <T*> (this)->*next) ();
         }
 
+        void resize_buffer (size_t size_)
+        {
+            unsigned char *new_buf =
+                (unsigned char*) allocator.allocate (size_);
+            alloc_assert (new_buf);
+            allocator.deallocate (buf);
+            buf = new_buf;
+            bufsize = size_;
+        }
+
+        inline size_t take_copied ()
+        {
+            size_t n = copied;
+            copied = 0;
+            return n;
+        }
+
     protected:
 
         //  Prototype of state machine action.
@@ -145,6 +194,16 @@ namespace zmq
 
     private:
 
+        //  Returns true if the data to write are part of the body of the
+        //  message in progress, held outside of the message itself.
+        inline bool in_body ()
+        {
+            if (in_progress->is_vsm ())
+                return false;
+            unsigned char *body = (unsigned char*) in_progress->data ();
+            return write_pos >= body && write_pos < body + in_progress->size ();
+        }
+
         //  Where to get the data to write from.
         unsigned char *write_pos;
 
@@ -161,6 +220,12 @@ namespace zmq
         size_t bufsize;
         unsigned char *buf;
 
+        //  Allocator for the buffer.
+        const allocator_t allocator;
+
+        //  Bytes copied to the buffer since take_copied was last called.
+        size_t copied;
+
         encoder_base_t (const encoder_base_t&);
         void operator = (const encoder_base_t&);
 
@@ -31,6 +31,8 @@
 #include "err.hpp"
 #include "config.hpp"
 #include "i_poll_events.hpp"
+#include "clock.hpp"
+#include "cpu_relax.hpp"
 
 zmq::epoll_t::epoll_t () :
     stopping (false)
@@ -45,7 +47,7 @@ zmq::epoll_t::~epoll_t ()
     worker.stop ();
 
     close (epoll_fd);
-    for (retired_t::iterator it = retired.begin (); it != retired.end (); ++it)
+    for (entries_t::iterator it = retired.begin (); it != retired.end (); ++it)
         delete *it;
 }
 
@@ -61,6 +63,8 @@ zmq::epoll_t::handle_t zmq::epoll_t::add_fd (fd_t fd_, i_poll_events *events_)
     pe->fd = fd_;
     pe->ev.events = 0;
     pe->ev.data.ptr = pe;
+    pe->wanted = 0;
+    pe->pending = false;
     pe->events = events_;
 
     int rc = epoll_ctl (epoll_fd, EPOLL_CTL_ADD, fd_, &pe->ev);
@@ -87,38 +91,63 @@ void zmq::epoll_t::rm_fd (handle_t handle_)
 void zmq::epoll_t::set_pollin (handle_t handle_)
 {
     poll_entry_t *pe = (poll_entry_t*) handle_;
-    pe->ev.events |= EPOLLIN;
-    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, pe->fd, &pe->ev);
-    errno_assert (rc != -1);
+    pe->wanted |= EPOLLIN;
+    update (pe);
 }
 
 void zmq::epoll_t::reset_pollin (handle_t handle_)
 {
     poll_entry_t *pe = (poll_entry_t*) handle_;
-    pe->ev.events &= ~((short) EPOLLIN);
-    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, pe->fd, &pe->ev);
-    errno_assert (rc != -1);
+    pe->wanted &= ~((uint32_t) EPOLLIN);
+    update (pe);
 }
 
 void zmq::epoll_t::set_pollout (handle_t handle_)
 {
     poll_entry_t *pe = (poll_entry_t*) handle_;
-    pe->ev.events |= EPOLLOUT;
-    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, pe->fd, &pe->ev);
-    errno_assert (rc != -1);
+    pe->wanted |= EPOLLOUT;
+    update (pe);
 }
 
 void zmq::epoll_t::reset_pollout (handle_t handle_)
 {
     poll_entry_t *pe = (poll_entry_t*) handle_;
-    pe->ev.events &= ~((short) EPOLLOUT);
-    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, pe->fd, &pe->ev);
-    errno_assert (rc != -1);
+    pe->wanted &= ~((uint32_t) EPOLLOUT);
+    update (pe);
+}
+
+void zmq::epoll_t::update (poll_entry_t *pe_)
+{
+    if (pe_->pending) {
+        count_avoided_updates (1);
+        return;
+    }
+    pe_->pending = true;
+    pending.push_back (pe_);
+}
+
+void zmq::epoll_t::apply_updates ()
+{
+    for (entries_t::iterator it = pending.begin (); it != pending.end ();
+          ++it) {
+        poll_entry_t *pe = *it;
+        pe->pending = false;
+
+        //  Changes that cancelled each other out don't cost anything.
+        if (pe->fd == retired_fd || pe->ev.events == pe->wanted) {
+            count_avoided_updates (1);
+            continue;
+        }
+        pe->ev.events = pe->wanted;
+        int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, pe->fd, &pe->ev);
+        errno_assert (rc != -1);
+    }
+    pending.clear ();
 }
 
 void zmq::epoll_t::start ()
 {
-    worker.start (worker_routine, this);
+    start_thread (worker, worker_routine, this);
 }
 
 void zmq::epoll_t::stop ()
@@ -140,9 +169,42 @@ void zmq::epoll_t::loop ()
         //  Execute any due timers.
         int timeout = (int) execute_timers ();
 
+        //  Register the events changed since the last iteration.
+        apply_updates ();
+
+        //  Destroy retired event sources. Being removed from epoll and
+        //  from the list of pending updates, they can't be referred to
+        //  any more.
+        for (entries_t::iterator it = retired.begin (); it != retired.end ();
+              ++it)
+            delete *it;
+        retired.clear ();
+
+        //  In busy polling mode, check for events without blocking for a
+        //  while first. Events arriving meanwhile, including commands in
+        //  the mailbox, are handled without waiting for a wake up.
+        int n = 0;
+        int spin_time = busy_poll_time (timeout);
+        if (spin_time) {
+            uint64_t start = clock_t::now_us ();
+            uint64_t end = start + spin_time;
+            while ((n = epoll_wait (epoll_fd, &ev_buf [0], max_io_events,
+                  0)) == 0 && clock_t::now_us () < end)
+                cpu_relax ();
+
+            //  The time spent spinning counts towards the next timer.
+            if (n == 0 && timeout) {
+                int spun = (int) ((clock_t::now_us () - start + 999) / 1000);
+                if (spun >= timeout)
+                    continue;
+                timeout -= spun;
+            }
+        }
+
         //  Wait for events.
-        int n = epoll_wait (epoll_fd, &ev_buf [0], max_io_events,
-            timeout ? timeout : -1);
+        if (n == 0)
+            n = epoll_wait (epoll_fd, &ev_buf [0], max_io_events,
+                timeout ? timeout : -1);
         if (n == -1) {
             errno_assert (errno == EINTR);
             continue;
@@ -157,19 +219,13 @@ void zmq::epoll_t::loop ()
                 pe->events->in_event ();
             if (pe->fd == retired_fd)
                continue;
-            if (ev_buf [i].events & EPOLLOUT)
+            if (ev_buf [i].events & EPOLLOUT && pe->wanted & EPOLLOUT)
                 pe->events->out_event ();
             if (pe->fd == retired_fd)
                 continue;
-            if (ev_buf [i].events & EPOLLIN)
+            if (ev_buf [i].events & EPOLLIN && pe->wanted & EPOLLIN)
                 pe->events->in_event ();
         }
-
-        //  Destroy retired event sources.
-        for (retired_t::iterator it = retired.begin (); it != retired.end ();
-              ++it)
-            delete *it;
-        retired.clear ();
     }
 }
 
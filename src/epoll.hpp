@@ -74,13 +74,35 @@ namespace zmq
         struct poll_entry_t
         {
             fd_t fd;
+
+            //  Events registered with epoll.
             epoll_event ev;
+
+            //  Events to poll for as of now. They get registered with epoll
+            //  just before waiting for events.
+            uint32_t wanted;
+
+            //  True if the entry is in the list of entries to update.
+            bool pending;
+
             zmq::i_poll_events *events;
         };
 
+        typedef std::vector <poll_entry_t*> entries_t;
+
+        //  Schedules the registered events of the entry to be updated.
+        void update (poll_entry_t *pe_);
+
+        //  Registers the events changed since the last call with epoll.
+        //  Each file descriptor costs at most one system call, whatever
+        //  the number of changes.
+        void apply_updates ();
+
+        //  Entries whose events changed since the last wait.
+        entries_t pending;
+
         //  List of retired event sources.
-        typedef std::vector <poll_entry_t*> retired_t;
-        retired_t retired;
+        entries_t retired;
 
         //  If true, thread is in the process of shutting down.
         bool stopping;
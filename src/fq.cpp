@@ -120,6 +120,61 @@ int zmq::fq_t::recvpipe (msg_t *msg_, pipe_t **pipe_)
     return -1;
 }
 
+int zmq::fq_t::recvmmsg (msg_t *msgs_, int count_)
+{
+    //  Deallocate old content of the messages.
+    for (int i = 0; i != count_; i++) {
+        const int rc = msgs_ [i].close ();
+        errno_assert (rc == 0);
+    }
+
+    int nread = 0;
+    while (nread < count_ && active > 0) {
+
+        //  Each active pipe gets its share of the batch, rounded down to
+        //  the nearest message boundary. A multipart message which was
+        //  already started is read to its end from the same pipe.
+        const int left = count_ - nread;
+        int quota = more ? left : left / (int) active;
+        if (quota == 0)
+            quota = 1;
+
+        pipe_t *pipe = pipes [current];
+        const int n = pipe->read (msgs_ + nread, quota);
+        nread += n;
+        if (n > 0)
+            more = msgs_ [nread - 1].flags () & msg_t::more? true: false;
+
+        //  The pipe ran dry. Deactivate it the same way recvpipe does.
+        if (n < quota) {
+
+            //  Check the atomicity of the message.
+            zmq_assert (!more);
+
+            if (n > 0)
+                last_in = pipe;
+            active--;
+            pipes.swap (current, active);
+            if (current == active)
+                current = 0;
+            continue;
+        }
+
+        if (!more) {
+            last_in = pipe;
+            current = (current + 1) % active;
+        }
+    }
+
+    //  Initialise the unused messages to be 0-byte messages.
+    for (int i = nread; i != count_; i++) {
+        const int rc = msgs_ [i].init ();
+        errno_assert (rc == 0);
+    }
+
+    return nread;
+}
+
 bool zmq::fq_t::has_in ()
 {
     //  There are subsequent parts of the partly-read message available.
@@ -45,6 +45,12 @@ namespace zmq
 
         int recv (msg_t *msg_);
         int recvpipe (msg_t *msg_, pipe_t **pipe_);
+
+        //  Receives up to count_ messages at once and returns the number
+        //  of messages received. The batch is shared fairly among the
+        //  active pipes; parts of a multipart message are never split
+        //  between the pipes.
+        int recvmmsg (msg_t *msgs_, int count_);
         bool has_in ();
         blob_t get_credential () const;
 
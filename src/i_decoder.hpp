@@ -36,6 +36,11 @@ namespace zmq
 
         virtual void get_buffer (unsigned char **data_, size_t *size_) = 0;
 
+        //  Replaces the buffer returned by get_buffer with one of size_
+        //  bytes. Must not be called while the buffer holds data that
+        //  haven't been decoded yet.
+        virtual void resize_buffer (size_t size_) = 0;
+
         //  Decodes data pointed to by data_.
         //  When a message is decoded, 1 is returned.
         //  When the decoder needs more data, 0 is returnd.
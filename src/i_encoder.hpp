@@ -40,9 +40,27 @@ namespace zmq
         //  Function returns 0 when a new message is required.
         virtual size_t encode (unsigned char **data_, size_t size) = 0;
 
+        //  Same as encode, except that data chunks of at least threshold_
+        //  bytes are never copied to the buffer. Copying stops in front of
+        //  such a chunk and the chunk itself is returned by the following
+        //  call, with data_ pointing into the message being encoded and
+        //  in_place_ set to true. The chunk is valid only as long as the
+        //  message it belongs to.
+        virtual size_t encode (unsigned char **data_, size_t size_,
+            size_t threshold_, bool &in_place_) = 0;
+
         //  Load a new message into encoder.
         virtual void load_msg (msg_t *msg_) = 0;
 
+        //  Replaces the encoder's own buffer with one of size_ bytes. Must
+        //  not be called while data returned in the buffer are still to be
+        //  written.
+        virtual void resize_buffer (size_t size_) = 0;
+
+        //  Returns the number of bytes copied to the buffer since the
+        //  previous call.
+        virtual size_t take_copied () = 0;
+
     };
 
 }
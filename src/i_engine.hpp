@@ -48,6 +48,15 @@ namespace zmq
         virtual void restart_output () = 0;
 
         virtual void zap_msg_available () = 0;
+
+        //  Removes the engine from the poller of its I/O thread, so that it
+        //  can be moved to another I/O thread along with its session.
+        //  Returns false if the engine can't be moved at the moment.
+        virtual bool unplug_poller () = 0;
+
+        //  Registers the engine with the poller of the I/O thread it has
+        //  been moved to.
+        virtual void plug_poller (zmq::io_thread_t *io_thread_) = 0;
     };
 
 }
@@ -18,14 +18,20 @@
 */
 
 #include <new>
+#include <algorithm>
 
 #include "io_thread.hpp"
 #include "platform.hpp"
 #include "err.hpp"
+#include "likely.hpp"
 #include "ctx.hpp"
+#include "session_base.hpp"
+#include "stream_engine.hpp"
 
-zmq::io_thread_t::io_thread_t (ctx_t *ctx_, uint32_t tid_) :
-    object_t (ctx_, tid_)
+zmq::io_thread_t::io_thread_t (ctx_t *ctx_, uint32_t tid_,
+      int rebalance_ivl_) :
+    object_t (ctx_, tid_),
+    rebalance_ivl (rebalance_ivl_)
 {
     poller = new (std::nothrow) poller_t;
     alloc_assert (poller);
@@ -41,6 +47,9 @@ zmq::io_thread_t::~io_thread_t ()
 
 void zmq::io_thread_t::start ()
 {
+    if (rebalance_ivl > 0)
+        poller->add_timer (rebalance_ivl, this, rebalance_timer_id);
+
     //  Start the underlying I/O thread.
     poller->start ();
 }
@@ -69,8 +78,16 @@ void zmq::io_thread_t::in_event ()
     int rc = mailbox.recv (&cmd, 0);
 
     while (rc == 0 || errno == EINTR) {
-        if (rc == 0)
-            cmd.destination->process_command (cmd);
+        if (rc == 0) {
+
+            //  Objects moved over to other I/O threads still get their
+            //  commands through this one.
+            if (unlikely (cmd.destination->get_current_tid () !=
+                  get_tid ()))
+                forward_command (cmd);
+            else
+                cmd.destination->process_command (cmd);
+        }
         rc = mailbox.recv (&cmd, 0);
     }
 
@@ -83,10 +100,11 @@ void zmq::io_thread_t::out_event ()
     zmq_assert (false);
 }
 
-void zmq::io_thread_t::timer_event (int)
+void zmq::io_thread_t::timer_event (int id_)
 {
-    //  No timers here. This function is never called.
-    zmq_assert (false);
+    zmq_assert (id_ == rebalance_timer_id);
+    rebalance ();
+    poller->add_timer (rebalance_ivl, this, rebalance_timer_id);
 }
 
 zmq::poller_t *zmq::io_thread_t::get_poller ()
@@ -95,8 +113,102 @@ zmq::poller_t *zmq::io_thread_t::get_poller ()
     return poller;
 }
 
+uint32_t zmq::io_thread_t::get_traffic ()
+{
+    return traffic.get ();
+}
+
+uint32_t zmq::io_thread_t::get_migrations ()
+{
+    return migrations.get ();
+}
+
+void zmq::io_thread_t::add_session (session_base_t *session_)
+{
+    if (rebalance_ivl > 0)
+        sessions.insert (session_);
+}
+
+void zmq::io_thread_t::rm_session (session_base_t *session_)
+{
+    if (rebalance_ivl > 0)
+        sessions.erase (session_);
+}
+
+void zmq::io_thread_t::rebalance ()
+{
+    //  Measure the traffic over the last interval.
+    uint64_t total = 0;
+    candidates.clear ();
+    for (sessions_t::iterator it = sessions.begin (); it != sessions.end ();
+          ++it) {
+        candidate_t candidate;
+        candidate.traffic = (*it)->fetch_traffic ();
+        if (!candidate.traffic)
+            continue;
+        candidate.session = *it;
+        candidates.push_back (candidate);
+        total += candidate.traffic;
+    }
+    traffic.set (total < 0xffffffff ? (uint32_t) total : 0xffffffff);
+
+    //  Moving a session carrying half of the difference between this thread
+    //  and the least loaded thread available to the session evens out the
+    //  load best. Small differences are not worth moving anything for.
+    size_t count = 0;
+    for (candidates_t::size_type i = 0; i != candidates.size (); i++) {
+        candidate_t candidate = candidates [i];
+        candidate.target =
+            choose_io_thread (candidate.session->get_affinity ());
+        if (!candidate.target || candidate.target == this)
+            continue;
+        uint64_t target_traffic = candidate.target->get_traffic ();
+        if (target_traffic >= total || total - target_traffic < total / 4)
+            continue;
+        //  The move has to halve the difference at least.
+        uint64_t half_gap = (total - target_traffic) / 2;
+        if (candidate.traffic < half_gap / 2 ||
+              candidate.traffic > half_gap + half_gap / 2)
+            continue;
+        candidate.distance = candidate.traffic > half_gap ?
+            candidate.traffic - half_gap : half_gap - candidate.traffic;
+        candidates [count++] = candidate;
+    }
+    candidates.resize (count);
+    std::sort (candidates.begin (), candidates.end ());
+
+    //  Move a single session per round. Its traffic is accounted to the
+    //  new thread right away, so that other threads don't pick the same
+    //  target before it gets to measure its traffic itself.
+    for (candidates_t::iterator it = candidates.begin ();
+          it != candidates.end (); ++it)
+        if (it->session->migrate (it->target)) {
+            uint32_t moved = (uint32_t) std::min (it->traffic,
+                (uint64_t) traffic.get ());
+            traffic.sub (moved);
+            it->target->traffic.add (moved);
+            migrations.add (1);
+            break;
+        }
+}
+
+void zmq::io_thread_t::add_lingering (stream_engine_t *engine_)
+{
+    lingering.insert (engine_);
+}
+
+void zmq::io_thread_t::rm_lingering (stream_engine_t *engine_)
+{
+    lingering.erase (engine_);
+}
+
 void zmq::io_thread_t::process_stop ()
 {
+    //  Nothing else is going to run in the thread, so engines still
+    //  lingering have to be abandoned now.
+    while (!lingering.empty ())
+        (*lingering.begin ())->abandon ();
+
     poller->rm_fd (mailbox_handle);
     poller->stop ();
 }
@@ -21,17 +21,21 @@
 #define __ZMQ_IO_THREAD_HPP_INCLUDED__
 
 #include <vector>
+#include <set>
 
 #include "stdint.hpp"
 #include "object.hpp"
 #include "poller.hpp"
 #include "i_poll_events.hpp"
 #include "mailbox.hpp"
+#include "atomic_counter.hpp"
 
 namespace zmq
 {
 
     class ctx_t;
+    class session_base_t;
+    class stream_engine_t;
 
     //  Generic part of the I/O thread. Polling-mechanism-specific features
     //  are implemented in separate "polling objects".
@@ -40,7 +44,10 @@ namespace zmq
     {
     public:
 
-        io_thread_t (zmq::ctx_t *ctx_, uint32_t tid_);
+        //  If rebalance_ivl_ is positive, the I/O thread measures its load
+        //  at that interval (in milliseconds), and moves sessions over to
+        //  less loaded I/O threads.
+        io_thread_t (zmq::ctx_t *ctx_, uint32_t tid_, int rebalance_ivl_);
 
         //  Clean-up. If the thread was started, it's neccessary to call 'stop'
         //  before invoking destructor. Otherwise the destructor would hang up.
@@ -69,8 +76,34 @@ namespace zmq
         //  Returns load experienced by the I/O thread.
         int get_load ();
 
+        //  Returns the amount of data, in bytes, the sessions of the I/O
+        //  thread have processed over the last rebalance interval. It is
+        //  zero unless rebalancing is enabled. Note that this function can
+        //  be invoked from a different thread!
+        uint32_t get_traffic ();
+
+        //  Returns the number of sessions the I/O thread has moved over to
+        //  other I/O threads. Note that this function can be invoked from
+        //  a different thread!
+        uint32_t get_migrations ();
+
+        //  Called by the sessions when they start and stop running in
+        //  the I/O thread.
+        void add_session (zmq::session_base_t *session_);
+        void rm_session (zmq::session_base_t *session_);
+
+        //  Called by engines that linger in the I/O thread after being
+        //  closed until the kernel is done with the data they sent. Those
+        //  left when the I/O thread stops are abandoned.
+        void add_lingering (zmq::stream_engine_t *engine_);
+        void rm_lingering (zmq::stream_engine_t *engine_);
+
     private:
 
+        //  Measures the traffic of the sessions and moves one of them over
+        //  to a less loaded I/O thread if that evens out the load.
+        void rebalance ();
+
         //  I/O thread accesses incoming commands via this mailbox.
         mailbox_t mailbox;
 
@@ -80,6 +113,45 @@ namespace zmq
         //  I/O multiplexing is performed using a poller object.
         poller_t *poller;
 
+        //  Interval between two rebalancing rounds. Zero if disabled.
+        int rebalance_ivl;
+        enum {rebalance_timer_id = 0x40};
+
+        //  Sessions running in the I/O thread. Tracked only if rebalancing
+        //  is enabled.
+        typedef std::set <zmq::session_base_t*> sessions_t;
+        sessions_t sessions;
+
+        //  Session that could be moved in the current rebalancing round.
+        struct candidate_t
+        {
+            zmq::session_base_t *session;
+            uint64_t traffic;
+            io_thread_t *target;
+
+            //  How far the move is from evening out the load exactly.
+            uint64_t distance;
+
+            bool operator < (const candidate_t &other_) const
+            {
+                return distance < other_.distance;
+            }
+        };
+
+        //  Kept here to avoid allocating memory each round.
+        typedef std::vector <candidate_t> candidates_t;
+        candidates_t candidates;
+
+        //  Traffic over the last rebalance interval, in bytes.
+        atomic_counter_t traffic;
+
+        //  Number of sessions moved over to other I/O threads.
+        atomic_counter_t migrations;
+
+        //  Engines lingering in the I/O thread.
+        typedef std::set <zmq::stream_engine_t*> lingering_t;
+        lingering_t lingering;
+
         io_thread_t (const io_thread_t&);
         const io_thread_t &operator = (const io_thread_t&);
     };
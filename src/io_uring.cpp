@@ -0,0 +1,459 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "io_uring.hpp"
+#if defined ZMQ_USE_IO_URING
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <new>
+
+#include "err.hpp"
+#include "config.hpp"
+#include "i_poll_events.hpp"
+#include "clock.hpp"
+#include "cpu_relax.hpp"
+
+//  Completions of poll removals are tagged by setting the lowest bit
+//  of the address of the request being removed.
+#define ZMQ_IO_URING_REMOVAL 1
+
+static inline unsigned int load_acquire (unsigned int *ptr_)
+{
+    return __atomic_load_n (ptr_, __ATOMIC_ACQUIRE);
+}
+
+static inline void store_release (unsigned int *ptr_, unsigned int value_)
+{
+    __atomic_store_n (ptr_, value_, __ATOMIC_RELEASE);
+}
+
+zmq::io_uring_t::io_uring_t () :
+    cq_ring (NULL),
+    sqe_tail (0),
+    polls (0),
+    stopping (false)
+{
+    io_uring_params params;
+    memset (&params, 0, sizeof params);
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = io_uring_entries * 8;
+    ring_fd = syscall (__NR_io_uring_setup, io_uring_entries, &params);
+    errno_assert (ring_fd != -1);
+
+    //  Checked by is_supported when the context was created.
+    zmq_assert (params.features & IORING_FEAT_EXT_ARG);
+
+    sq_ring_size = params.sq_off.array +
+        params.sq_entries * sizeof (unsigned int);
+    cq_ring_size = params.cq_off.cqes +
+        params.cq_entries * sizeof (io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_ring_size > sq_ring_size)
+            sq_ring_size = cq_ring_size;
+        cq_ring_size = 0;
+    }
+
+    sq_ring = mmap (NULL, sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    errno_assert (sq_ring != MAP_FAILED);
+    void *cq = sq_ring;
+    if (cq_ring_size) {
+        cq_ring = mmap (NULL, cq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        errno_assert (cq_ring != MAP_FAILED);
+        cq = cq_ring;
+    }
+    sqes_size = params.sq_entries * sizeof (io_uring_sqe);
+    sqes = (io_uring_sqe*) mmap (NULL, sqes_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    errno_assert (sqes != MAP_FAILED);
+
+    unsigned char *sq = (unsigned char*) sq_ring;
+    sq_head = (unsigned int*) (sq + params.sq_off.head);
+    sq_tail = (unsigned int*) (sq + params.sq_off.tail);
+    sq_mask = *(unsigned int*) (sq + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+    sqe_tail = *sq_tail;
+
+    //  Submission queue entries are always used in order.
+    unsigned int *sq_array = (unsigned int*) (sq + params.sq_off.array);
+    for (unsigned int i = 0; i != sq_entries; i++)
+        sq_array [i] = i;
+
+    cq_head = (unsigned int*) ((unsigned char*) cq + params.cq_off.head);
+    cq_tail = (unsigned int*) ((unsigned char*) cq + params.cq_off.tail);
+    cq_mask = *(unsigned int*) ((unsigned char*) cq + params.cq_off.ring_mask);
+    cqes = (io_uring_cqe*) ((unsigned char*) cq + params.cq_off.cqes);
+}
+
+zmq::io_uring_t::~io_uring_t ()
+{
+    //  Wait till the worker thread exits.
+    worker.stop ();
+
+    //  Let the kernel finish with the requests removed last.
+    submit_updates ();
+    while (polls) {
+        int rc = enter (1, 100);
+        if (rc == -1 && errno == ETIME)
+            break;
+        reap (false);
+    }
+
+    munmap (sqes, sqes_size);
+    if (cq_ring)
+        munmap (cq_ring, cq_ring_size);
+    munmap (sq_ring, sq_ring_size);
+    close (ring_fd);
+    for (entries_t::iterator it = retired.begin (); it != retired.end (); ++it)
+        delete *it;
+}
+
+zmq::io_uring_t::handle_t zmq::io_uring_t::add_fd (fd_t fd_,
+    i_poll_events *events_)
+{
+    poll_entry_t *pe = new (std::nothrow) poll_entry_t;
+    alloc_assert (pe);
+
+    pe->fd = fd_;
+    pe->pollin = false;
+    pe->pollout = false;
+    pe->pending = false;
+    pe->poll = NULL;
+    pe->events = events_;
+
+    //  Errors are polled for right away.
+    update (pe);
+
+    //  Increase the load metric of the thread.
+    adjust_load (1);
+
+    return pe;
+}
+
+void zmq::io_uring_t::rm_fd (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+
+    //  The poll request holds a reference to the file. The removal has to be
+    //  submitted straight away, otherwise the file would stay open after the
+    //  caller closes the file descriptor, e.g. a listening socket would keep
+    //  the port bound.
+    if (pe->poll) {
+        cancel (pe->poll);
+        pe->poll = NULL;
+        int rc = enter (0, 0);
+        errno_assert (rc != -1 || errno == EINTR || errno == EAGAIN ||
+            errno == EBUSY);
+    }
+    pe->fd = retired_fd;
+    retired.push_back (pe);
+
+    //  Decrease the load metric of the thread.
+    adjust_load (-1);
+}
+
+void zmq::io_uring_t::set_pollin (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->pollin = true;
+    update (pe);
+}
+
+void zmq::io_uring_t::reset_pollin (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->pollin = false;
+    update (pe);
+}
+
+void zmq::io_uring_t::set_pollout (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->pollout = true;
+    update (pe);
+}
+
+void zmq::io_uring_t::reset_pollout (handle_t handle_)
+{
+    poll_entry_t *pe = (poll_entry_t*) handle_;
+    pe->pollout = false;
+    update (pe);
+}
+
+void zmq::io_uring_t::start ()
+{
+    start_thread (worker, worker_routine, this);
+}
+
+void zmq::io_uring_t::stop ()
+{
+    stopping = true;
+}
+
+int zmq::io_uring_t::max_fds ()
+{
+    return -1;
+}
+
+static void probe_routine (void *arg_)
+{
+    io_uring_params params;
+    memset (&params, 0, sizeof params);
+    int fd = syscall (__NR_io_uring_setup, 1, &params);
+    if (fd == -1)
+        return;
+    int rc = close (fd);
+    errno_assert (rc == 0);
+
+    //  Waiting with a timeout requires Linux 5.11.
+    *(bool*) arg_ = (params.features & IORING_FEAT_EXT_ARG) != 0;
+}
+
+bool zmq::io_uring_t::is_supported ()
+{
+    //  Tearing a ring down makes the next blocking call of the thread that
+    //  set it up fail with EINTR. Probe from a thread of our own so that the
+    //  application's threads are left alone.
+    bool supported = false;
+    thread_t probe_thread;
+    probe_thread.start (probe_routine, &supported);
+    probe_thread.stop ();
+    return supported;
+}
+
+void zmq::io_uring_t::update (poll_entry_t *pe_)
+{
+    if (pe_->pending) {
+        count_avoided_updates (1);
+        return;
+    }
+    pe_->pending = true;
+    pending.push_back (pe_);
+}
+
+void zmq::io_uring_t::submit_updates ()
+{
+    for (entries_t::iterator it = pending.begin (); it != pending.end ();
+          ++it) {
+        poll_entry_t *pe = *it;
+        pe->pending = false;
+        if (pe->fd == retired_fd)
+            continue;
+
+        //  Like epoll, report errors even when neither input nor output
+        //  is polled for. Among others, completions of zero-copy sends are
+        //  signalled that way.
+        unsigned int events = (pe->pollin ? POLLIN : 0) |
+            (pe->pollout ? POLLOUT : 0);
+        if (!events)
+            events = POLLERR;
+        if (pe->poll && pe->poll->events == events) {
+            count_avoided_updates (1);
+            continue;
+        }
+        if (pe->poll) {
+            cancel (pe->poll);
+            pe->poll = NULL;
+        }
+
+        poll_t *poll = new (std::nothrow) poll_t;
+        alloc_assert (poll);
+        poll->entry = pe;
+        poll->events = events;
+        poll->refs = 1;
+        polls++;
+
+        io_uring_sqe *sqe = get_sqe ();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = pe->fd;
+        sqe->poll32_events = events;
+        sqe->user_data = (uint64_t) poll;
+        pe->poll = poll;
+    }
+    pending.clear ();
+}
+
+void zmq::io_uring_t::cancel (poll_t *poll_)
+{
+    poll_->entry = NULL;
+    poll_->refs++;
+
+    io_uring_sqe *sqe = get_sqe ();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t) poll_;
+    sqe->user_data = (uint64_t) poll_ | ZMQ_IO_URING_REMOVAL;
+}
+
+void zmq::io_uring_t::release (poll_t *poll_)
+{
+    if (--poll_->refs == 0) {
+        delete poll_;
+        polls--;
+    }
+}
+
+io_uring_sqe *zmq::io_uring_t::get_sqe ()
+{
+    while (sqe_tail - load_acquire (sq_head) == sq_entries) {
+        int rc = enter (0, 0);
+        errno_assert (rc != -1 || errno == EINTR || errno == EAGAIN);
+    }
+    io_uring_sqe *sqe = &sqes [sqe_tail & sq_mask];
+    memset (sqe, 0, sizeof (io_uring_sqe));
+    sqe_tail++;
+    return sqe;
+}
+
+int zmq::io_uring_t::enter (unsigned int min_complete_, int timeout_)
+{
+    //  Make the queued entries visible to the kernel.
+    store_release (sq_tail, sqe_tail);
+    unsigned int to_submit = sqe_tail - load_acquire (sq_head);
+
+    unsigned int flags = min_complete_ ? IORING_ENTER_GETEVENTS : 0;
+    if (!timeout_)
+        return syscall (__NR_io_uring_enter, ring_fd, to_submit,
+            min_complete_, flags, NULL, 0);
+
+    __kernel_timespec ts;
+    ts.tv_sec = timeout_ / 1000;
+    ts.tv_nsec = (timeout_ % 1000) * 1000000;
+    io_uring_getevents_arg arg;
+    memset (&arg, 0, sizeof arg);
+    arg.ts = (uint64_t) &ts;
+    return syscall (__NR_io_uring_enter, ring_fd, to_submit, min_complete_,
+        flags | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+}
+
+void zmq::io_uring_t::reap (bool dispatch_)
+{
+    unsigned int head = *cq_head;
+    while (head != load_acquire (cq_tail)) {
+        io_uring_cqe *cqe = &cqes [head & cq_mask];
+        uint64_t user_data = cqe->user_data;
+        int res = cqe->res;
+
+        //  Hand the slot back to the kernel before invoking the event
+        //  sinks, which may take a while.
+        store_release (cq_head, ++head);
+
+        if (user_data & ZMQ_IO_URING_REMOVAL) {
+            release ((poll_t*) (user_data & ~(uint64_t) ZMQ_IO_URING_REMOVAL));
+            continue;
+        }
+
+        //  Requests are one-shot. Unless it was superseded, the entry has
+        //  to be polled again, for whatever events it's interested in by
+        //  the time we get back to submitting.
+        poll_t *poll = (poll_t*) user_data;
+        poll_entry_t *pe = poll->entry;
+        release (poll);
+        if (!pe)
+            continue;
+        pe->poll = NULL;
+        update (pe);
+        if (!dispatch_)
+            continue;
+
+        unsigned int events = res < 0 ? POLLERR : (unsigned int) res;
+        if (events & (POLLERR | POLLHUP))
+            pe->events->in_event ();
+        if (pe->fd == retired_fd)
+            continue;
+        if (events & POLLOUT && pe->pollout)
+            pe->events->out_event ();
+        if (pe->fd == retired_fd)
+            continue;
+        if (events & POLLIN && pe->pollin)
+            pe->events->in_event ();
+    }
+}
+
+void zmq::io_uring_t::loop ()
+{
+    while (!stopping) {
+
+        //  Execute any due timers.
+        int timeout = (int) execute_timers ();
+
+        //  Submit the changes made since the last iteration along with
+        //  the wait for events.
+        submit_updates ();
+
+        //  Destroy retired event sources. No poll request refers to them
+        //  any more.
+        for (entries_t::iterator it = retired.begin (); it != retired.end ();
+              ++it)
+            delete *it;
+        retired.clear ();
+
+        //  In busy polling mode, submit the requests and watch the
+        //  completion queue for a while first. The queue is shared with the
+        //  kernel, so this takes no system calls at all.
+        int spin_time = busy_poll_time (timeout);
+        if (spin_time) {
+            int rc = enter (0, 0);
+            errno_assert (rc != -1 || errno == EINTR || errno == EBUSY ||
+                errno == EAGAIN);
+            uint64_t start = clock_t::now_us ();
+            uint64_t end = start + spin_time;
+            for (int i = 1; *cq_head == load_acquire (cq_tail); i++) {
+                cpu_relax ();
+                if (i % 64 == 0 && clock_t::now_us () >= end)
+                    break;
+            }
+            if (*cq_head != load_acquire (cq_tail)) {
+                reap (true);
+                continue;
+            }
+
+            //  The time spent spinning counts towards the next timer.
+            if (timeout) {
+                int spun = (int) ((clock_t::now_us () - start + 999) / 1000);
+                if (spun >= timeout)
+                    continue;
+                timeout -= spun;
+            }
+        }
+
+        //  Wait for events.
+        int rc = enter (1, timeout);
+        if (rc == -1) {
+            errno_assert (errno == EINTR || errno == ETIME ||
+                errno == EBUSY || errno == EAGAIN);
+            if (errno == EINTR)
+                continue;
+        }
+
+        reap (true);
+    }
+}
+
+void zmq::io_uring_t::worker_routine (void *arg_)
+{
+    ((io_uring_t*) arg_)->loop ();
+}
+
+#endif
@@ -0,0 +1,189 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_IO_URING_HPP_INCLUDED__
+#define __ZMQ_IO_URING_HPP_INCLUDED__
+
+//  poller.hpp decides which polling mechanism to use.
+#include "poller.hpp"
+#if defined ZMQ_USE_IO_URING
+
+#include <stddef.h>
+#include <vector>
+#include <linux/io_uring.h>
+
+#include "fd.hpp"
+#include "thread.hpp"
+#include "poller_base.hpp"
+
+namespace zmq
+{
+
+    struct i_poll_events;
+
+    //  This class implements socket polling mechanism using the Linux-specific
+    //  io_uring interface. File descriptors are polled using one-shot poll
+    //  requests. Changes to the set of polled events are collected and
+    //  submitted to the kernel along with the wait for completions, so that
+    //  the whole I/O thread loop iteration costs a single system call.
+
+    class io_uring_t : public poller_base_t
+    {
+    public:
+
+        typedef void* handle_t;
+
+        io_uring_t ();
+        ~io_uring_t ();
+
+        //  "poller" concept.
+        handle_t add_fd (fd_t fd_, zmq::i_poll_events *events_);
+        void rm_fd (handle_t handle_);
+        void set_pollin (handle_t handle_);
+        void reset_pollin (handle_t handle_);
+        void set_pollout (handle_t handle_);
+        void reset_pollout (handle_t handle_);
+        void start ();
+        void stop ();
+
+        static int max_fds ();
+
+        //  Returns false if the running kernel lacks io_uring or features
+        //  the poller relies on, which require Linux 5.11.
+        static bool is_supported ();
+
+    private:
+
+        //  Main worker thread routine.
+        static void worker_routine (void *arg_);
+
+        //  Main event loop.
+        void loop ();
+
+        struct poll_t;
+
+        struct poll_entry_t
+        {
+            fd_t fd;
+            bool pollin;
+            bool pollout;
+
+            //  True if the entry is in the list of entries to update.
+            bool pending;
+
+            //  Poll request currently submitted for the file descriptor,
+            //  NULL if there's none.
+            poll_t *poll;
+
+            zmq::i_poll_events *events;
+        };
+
+        //  Poll request submitted to the kernel. It is released once the
+        //  kernel is done with it, that is once the completion of the
+        //  request, as well as the completion of its removal if it was
+        //  removed, have been reaped.
+        struct poll_t
+        {
+            //  Entry the request was submitted for. NULL if the request
+            //  was superseded or the entry was removed.
+            poll_entry_t *entry;
+
+            //  Events polled for.
+            unsigned int events;
+
+            //  Number of completions still to be reaped.
+            int refs;
+        };
+
+        //  Schedules the poll request of the entry to be updated.
+        void update (poll_entry_t *pe_);
+
+        //  Submits the pending updates.
+        void submit_updates ();
+
+        //  Detaches the request from its entry and cancels it.
+        void cancel (poll_t *poll_);
+
+        //  Drops a reference to the request.
+        void release (poll_t *poll_);
+
+        //  Returns a free submission queue entry. If the queue is full the
+        //  entries queued so far are submitted first.
+        io_uring_sqe *get_sqe ();
+
+        //  Submits the queued entries and waits for at least 'min_complete_'
+        //  completions, for at most 'timeout_' milliseconds if non-zero.
+        int enter (unsigned int min_complete_, int timeout_);
+
+        //  Processes the completions posted by the kernel. If 'dispatch_'
+        //  is false, the events are not passed to the event sinks.
+        void reap (bool dispatch_);
+
+        //  io_uring file descriptor.
+        fd_t ring_fd;
+
+        //  Rings shared with the kernel.
+        void *sq_ring;
+        size_t sq_ring_size;
+        void *cq_ring;
+        size_t cq_ring_size;
+        io_uring_sqe *sqes;
+        size_t sqes_size;
+
+        //  Submission queue. Tail of the entries filled in so far, but
+        //  not necessarily made visible to the kernel yet.
+        unsigned int *sq_head;
+        unsigned int *sq_tail;
+        unsigned int sq_mask;
+        unsigned int sq_entries;
+        unsigned int sqe_tail;
+
+        //  Completion queue.
+        unsigned int *cq_head;
+        unsigned int *cq_tail;
+        unsigned int cq_mask;
+        io_uring_cqe *cqes;
+
+        //  Entries whose poll requests have to be updated.
+        typedef std::vector <poll_entry_t*> entries_t;
+        entries_t pending;
+
+        //  List of retired event sources.
+        entries_t retired;
+
+        //  Number of poll requests not released yet.
+        int polls;
+
+        //  If true, thread is in the process of shutting down.
+        bool stopping;
+
+        //  Handle of the physical thread doing the I/O work.
+        thread_t worker;
+
+        io_uring_t (const io_uring_t&);
+        const io_uring_t &operator = (const io_uring_t&);
+    };
+
+    typedef io_uring_t poller_t;
+
+}
+
+#endif
+
+#endif
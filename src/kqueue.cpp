@@ -144,7 +144,7 @@ void zmq::kqueue_t::reset_pollout (handle_t handle_)
 
 void zmq::kqueue_t::start ()
 {
-    worker.start (worker_routine, this);
+    start_thread (worker, worker_routine, this);
 }
 
 void zmq::kqueue_t::stop ()
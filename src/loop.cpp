@@ -0,0 +1,230 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "loop.hpp"
+
+#include <new>
+
+#include "socket_base.hpp"
+#include "err.hpp"
+
+zmq::loop_t::loop_t () :
+    tag (0xCAFED00D),
+    next_timer_id (1),
+    stopping (false)
+{
+    int rc = msg.init ();
+    errno_assert (rc == 0);
+    poller.set_close_events (this);
+}
+
+zmq::loop_t::~loop_t ()
+{
+    //  Mark the loop as dead.
+    tag = 0xdeadbeef;
+
+    for (handlers_t::iterator it = handlers.begin (); it != handlers.end ();
+          ++it)
+        delete it->second;
+    destroy_retired ();
+
+    int rc = msg.close ();
+    errno_assert (rc == 0);
+}
+
+bool zmq::loop_t::check_tag ()
+{
+    return tag == 0xCAFED00D;
+}
+
+int zmq::loop_t::add (socket_base_t *socket_, zmq_loop_fn *handler_,
+    void *arg_)
+{
+    if (!handler_ || handlers.find (socket_) != handlers.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    handler_t *handler = new (std::nothrow) handler_t;
+    alloc_assert (handler);
+    handler->socket = socket_;
+    handler->fn = handler_;
+    handler->arg = arg_;
+    handler->removed = false;
+
+    int rc = poller.add (socket_, handler, ZMQ_POLLIN);
+    if (rc != 0) {
+        delete handler;
+        return -1;
+    }
+
+    handlers.insert (handlers_t::value_type (socket_, handler));
+    return 0;
+}
+
+int zmq::loop_t::remove (socket_base_t *socket_)
+{
+    handlers_t::iterator it = handlers.find (socket_);
+    if (it == handlers.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int rc = poller.remove (socket_);
+    errno_assert (rc == 0);
+    retire (it);
+    return 0;
+}
+
+void zmq::loop_t::socket_closed (socket_base_t *socket_)
+{
+    handlers_t::iterator it = handlers.find (socket_);
+    zmq_assert (it != handlers.end ());
+    retire (it);
+}
+
+void zmq::loop_t::retire (handlers_t::iterator it_)
+{
+    it_->second->removed = true;
+    retired.push_back (it_->second);
+    handlers.erase (it_);
+}
+
+int zmq::loop_t::start_timer (int interval_, int times_,
+    zmq_timer_fn *handler_, void *arg_)
+{
+    if (interval_ <= 0 || times_ < 0 || !handler_) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    loop_timer_t timer = {interval_, times_, handler_, arg_};
+    int id = next_timer_id++;
+    loop_timers.insert (loop_timers_t::value_type (id, timer));
+    add_timer (interval_, this, id);
+    return id;
+}
+
+int zmq::loop_t::stop_timer (int timer_id_)
+{
+    loop_timers_t::iterator it = loop_timers.find (timer_id_);
+    if (it == loop_timers.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    cancel_timer (this, timer_id_);
+    loop_timers.erase (it);
+    return 0;
+}
+
+int zmq::loop_t::run ()
+{
+    stopping = false;
+
+    while (true) {
+
+        //  Execute any due timers.
+        int timeout = (int) execute_timers ();
+        if (stopping)
+            break;
+
+        //  With nothing to wait for, the loop would never end.
+        if (handlers.empty () && loop_timers.empty ())
+            break;
+
+        int n = poller.wait (events, max_io_events, timeout ? timeout : -1);
+        if (n == -1) {
+            if (errno == EAGAIN)
+                continue;
+            return -1;
+        }
+
+        for (int i = 0; i != n && !stopping; i++) {
+            handler_t *handler = (handler_t*) events [i].user_data;
+            if (handler->removed)
+                continue;
+            if (dispatch (handler) != 0) {
+                destroy_retired ();
+                return -1;
+            }
+        }
+        destroy_retired ();
+        if (stopping)
+            break;
+    }
+
+    return 0;
+}
+
+int zmq::loop_t::dispatch (handler_t *handler_)
+{
+    for (int i = 0; i != loop_drain_max; i++) {
+        int rc = handler_->socket->recv (&msg, ZMQ_DONTWAIT);
+        if (rc != 0)
+            return errno == EAGAIN ? 0 : -1;
+        if (handler_->fn (this, handler_->socket, (zmq_msg_t*) &msg,
+              handler_->arg) != 0)
+            stopping = true;
+        if (stopping || handler_->removed)
+            break;
+    }
+
+    //  If there are more messages, the poller reports the socket again.
+    return 0;
+}
+
+void zmq::loop_t::destroy_retired ()
+{
+    for (retired_t::iterator it = retired.begin (); it != retired.end ();
+          ++it)
+        delete *it;
+    retired.clear ();
+}
+
+void zmq::loop_t::in_event ()
+{
+    //  The loop doesn't register file descriptors with poller_base_t.
+    zmq_assert (false);
+}
+
+void zmq::loop_t::out_event ()
+{
+    zmq_assert (false);
+}
+
+void zmq::loop_t::timer_event (int id_)
+{
+    loop_timers_t::iterator it = loop_timers.find (id_);
+    zmq_assert (it != loop_timers.end ());
+    loop_timer_t timer = it->second;
+
+    //  Re-arm or forget the timer before invoking the handler, which may
+    //  cancel it.
+    if (timer.times != 1) {
+        if (timer.times)
+            it->second.times--;
+        add_timer (timer.interval, this, id_);
+    }
+    else
+        loop_timers.erase (it);
+
+    if (timer.fn (this, id_, timer.arg) != 0)
+        stopping = true;
+}
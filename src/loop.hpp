@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_LOOP_HPP_INCLUDED__
+#define __ZMQ_LOOP_HPP_INCLUDED__
+
+#include <map>
+#include <vector>
+
+#include "../include/zmq.h"
+
+#include "poller_base.hpp"
+#include "i_poll_events.hpp"
+#include "socket_poller.hpp"
+#include "config.hpp"
+#include "stdint.hpp"
+#include "msg.hpp"
+
+namespace zmq
+{
+
+    class socket_base_t;
+
+    //  Reactor run by an application thread. It receives the messages
+    //  arriving on the registered sockets and hands them over to the
+    //  handlers, and it runs the timers. The sockets are watched by a
+    //  socket_poller_t while the timers are those of poller_base_t, as
+    //  in the I/O threads. Like the sockets, the loop is not thread safe.
+
+    class loop_t :
+        public poller_base_t,
+        public i_poll_events,
+        public i_socket_close_events
+    {
+    public:
+
+        loop_t ();
+        ~loop_t ();
+
+        //  Returns false if object is not a loop.
+        bool check_tag ();
+
+        //  Interface for the API layer.
+        int add (socket_base_t *socket_, zmq_loop_fn *handler_, void *arg_);
+        int remove (socket_base_t *socket_);
+        int start_timer (int interval_, int times_, zmq_timer_fn *handler_,
+            void *arg_);
+        int stop_timer (int timer_id_);
+
+        //  Runs until a handler asks to stop. Returns -1 if a socket fails
+        //  (typically with ETERM) or the wait is interrupted.
+        int run ();
+
+        //  i_poll_events implementation.
+        void in_event ();
+        void out_event ();
+        void timer_event (int id_);
+
+        //  i_socket_close_events implementation. The handlers of sockets
+        //  closed while registered are dropped.
+        void socket_closed (socket_base_t *socket_);
+
+    private:
+
+        struct handler_t
+        {
+            socket_base_t *socket;
+            zmq_loop_fn *fn;
+            void *arg;
+
+            //  Set once the handler is removed. It's deallocated later as
+            //  the events being dispatched may still refer to it.
+            bool removed;
+        };
+
+        struct loop_timer_t
+        {
+            int interval;
+
+            //  Number of times the timer is still to fire, 0 if forever.
+            int times;
+
+            zmq_timer_fn *fn;
+            void *arg;
+        };
+
+        //  Hands over the messages waiting in the socket to the handler.
+        int dispatch (handler_t *handler_);
+
+        //  Unregisters the handler. It's deallocated by destroy_retired.
+        typedef std::map <socket_base_t*, handler_t*> handlers_t;
+        void retire (handlers_t::iterator it_);
+
+        //  Deallocates the handlers removed.
+        void destroy_retired ();
+
+        //  Used to check whether the object is a loop.
+        uint32_t tag;
+
+        //  Watches the sockets with a handler.
+        socket_poller_t poller;
+        zmq_poller_event_t events [max_io_events];
+
+        handlers_t handlers;
+        typedef std::vector <handler_t*> retired_t;
+        retired_t retired;
+
+        typedef std::map <int, loop_timer_t> loop_timers_t;
+        loop_timers_t loop_timers;
+        int next_timer_id;
+
+        //  Message the handlers are passed.
+        msg_t msg;
+
+        //  If true, a handler asked the loop to stop.
+        bool stopping;
+
+        loop_t (const loop_t&);
+        const loop_t &operator = (const loop_t&);
+    };
+
+}
+
+#endif
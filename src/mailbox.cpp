@@ -18,26 +18,37 @@
 */
 
 #include "mailbox.hpp"
+#include "clock.hpp"
+#include "cpu_relax.hpp"
 #include "err.hpp"
 
-zmq::mailbox_t::mailbox_t ()
+#if defined ZMQ_HAVE_WINDOWS
+#include "windows.hpp"
+#else
+#include <sched.h>
+#endif
+
+//  Lets other threads ready to run on this CPU run.
+static void thread_yield ()
 {
-    //  Get the pipe into passive state. That way, if the users starts by
-    //  polling on the associated file descriptor it will get woken up when
-    //  new command is posted.
-    bool ok = cpipe.read (NULL);
-    zmq_assert (!ok);
-    active = false;
+#if defined ZMQ_HAVE_WINDOWS
+    Sleep (0);
+#else
+    sched_yield ();
+#endif
 }
 
-zmq::mailbox_t::~mailbox_t ()
+zmq::mailbox_t::mailbox_t () :
+    active (false),
+    spin_time (0),
+    spin_budget (0)
 {
-    //  TODO: Retrieve and deallocate commands inside the cpipe.
+}
 
-    // Work around problem that other threads might still be in our
-    // send() method, by waiting on the mutex before disappearing.
-    sync.lock ();
-    sync.unlock ();
+zmq::mailbox_t::~mailbox_t ()
+{
+    //  Other threads might still be in our send() method. Destroying the
+    //  command queue waits for them to finish pushing their commands.
 }
 
 zmq::fd_t zmq::mailbox_t::get_fd ()
@@ -47,38 +58,92 @@ zmq::fd_t zmq::mailbox_t::get_fd ()
 
 void zmq::mailbox_t::send (const command_t &cmd_)
 {
-    sync.lock ();
-    cpipe.write (cmd_, false);
-    bool ok = cpipe.flush ();
-    sync.unlock ();
-    if (!ok)
+    commands.push (cmd_);
+    if (pending.add (1) == 0)
         signaler.send ();
 }
 
 int zmq::mailbox_t::recv (command_t *cmd_, int timeout_)
 {
-    //  Try to get the command straight away.
-    if (active) {
-        bool ok = cpipe.read (cmd_);
-        if (ok)
-            return 0;
+    //  If there are no commands pending, wait for signal from the command
+    //  sender. That way, if the user starts by polling on the associated
+    //  file descriptor it will get woken up when new command is posted.
+    if (!active) {
 
-        //  If there are no more commands available, switch into passive state.
-        active = false;
+        //  Nothing was posted since the mailbox went passive, so there's no
+        //  signal either. Checking that is much cheaper than polling the
+        //  signaler, which makes frequent checks for commands affordable.
+        if (timeout_ == 0 && pending.get () == 0) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        //  Blocking costs a system call and a context switch to wake up,
+        //  so if a command is likely to arrive shortly spin for it first.
+        if (spin_time && timeout_ != 0) {
+            uint64_t spin_start = clock_t::now_us ();
+            if (spin (timeout_ < 0 || timeout_ >= spin_budget / 1000 ?
+                  spin_budget : timeout_ * 1000))
+                spin_budget = spin_budget < spin_time / 2 ?
+                    spin_budget * 2 : spin_time;
+            else {
+                if (spin_budget > 1)
+                    spin_budget /= 2;
+
+                //  The time spent spinning counts towards the timeout.
+                if (timeout_ > 0) {
+                    int spun = (int) ((clock_t::now_us () - spin_start) / 1000);
+                    timeout_ = spun < timeout_ ? timeout_ - spun : 0;
+                }
+            }
+        }
+
+        int rc = signaler.wait (timeout_);
+        if (rc != 0 && (errno == EAGAIN || errno == EINTR))
+            return -1;
+        errno_assert (rc == 0);
+
+        //  We've got the signal. Now we can switch into active state.
+        //  Senders count the command before raising the signal, so
+        //  a signal with nothing pending did not come from a sender.
         signaler.recv ();
+        zmq_assert (pending.get () != 0);
+        active = true;
     }
 
-    //  Wait for signal from the command sender.
-    int rc = signaler.wait (timeout_);
-    if (rc != 0 && (errno == EAGAIN || errno == EINTR))
-        return -1;
-
-    //  We've got the signal. Now we can switch into active state.
-    active = true;
+    //  The command is known to be sent, but the sender may still be
+    //  linking it to the queue. If the sender got preempted in between,
+    //  give it a chance to run instead of spinning until we are preempted
+    //  ourselves.
+    for (int i = 1; !commands.pop (cmd_); i++) {
+        if (i % 64 == 0)
+            thread_yield ();
+        else
+            cpu_relax ();
+    }
 
-    //  Get a command.
-    errno_assert (rc == 0);
-    bool ok = cpipe.read (cmd_);
-    zmq_assert (ok);
+    //  If there are no more commands pending, switch into passive state.
+    //  Next sender will raise the signal again.
+    if (!pending.sub (1))
+        active = false;
     return 0;
 }
+
+void zmq::mailbox_t::set_spin_time (int spin_time_)
+{
+    spin_time = spin_time_;
+    spin_budget = spin_time_;
+}
+
+bool zmq::mailbox_t::spin (int spin_time_)
+{
+    //  Reading the clock is comparatively expensive, so check it only
+    //  every so often.
+    uint64_t end = clock_t::now_us () + spin_time_;
+    for (int i = 1; pending.get () == 0; i++) {
+        cpu_relax ();
+        if (i % 64 == 0 && clock_t::now_us () >= end)
+            return false;
+    }
+    return true;
+}
@@ -27,8 +27,8 @@
 #include "fd.hpp"
 #include "config.hpp"
 #include "command.hpp"
-#include "ypipe.hpp"
-#include "mutex.hpp"
+#include "mpsc_queue.hpp"
+#include "atomic_counter.hpp"
 
 namespace zmq
 {
@@ -43,6 +43,10 @@ namespace zmq
         fd_t get_fd ();
         void send (const command_t &cmd_);
         int recv (command_t *cmd_, int timeout_);
+
+        //  Sets for how long (in microseconds) recv spins waiting for
+        //  a command before blocking. Zero means no spinning.
+        void set_spin_time (int spin_time_);
         
 #ifdef HAVE_FORK
         // close the file descriptors in the signaller. This is used in a forked
@@ -53,23 +57,36 @@ namespace zmq
 
     private:
 
-        //  The pipe to store actual commands.
-        typedef ypipe_t <command_t, command_pipe_granularity> cpipe_t;
-        cpipe_t cpipe;
+        //  The queue to store actual commands. Any number of threads can
+        //  send commands to the mailbox without synchronising with
+        //  each other.
+        mpsc_queue_t <command_t> commands;
 
-        //  Signaler to pass signals from writer thread to reader thread.
-        signaler_t signaler;
+        //  Number of commands sent and not yet received. The sender that
+        //  raises it from zero wakes the receiver up using the signaler.
+        atomic_counter_t pending;
 
-        //  There's only one thread receiving from the mailbox, but there
-        //  is arbitrary number of threads sending. Given that ypipe requires
-        //  synchronised access on both of its endpoints, we have to synchronise
-        //  the sending side.
-        mutex_t sync;
+        //  Signaler to pass signals from writer threads to reader thread.
+        signaler_t signaler;
 
-        //  True if the underlying pipe is active, ie. when we are allowed to
-        //  read commands from it.
+        //  True if the mailbox is active, ie. when there's at least one
+        //  command pending and the signal for it has been received.
         bool active;
 
+        //  Maximal time to spin before blocking, in microseconds.
+        int spin_time;
+
+        //  Time to spin next time. It is halved each time spinning fails
+        //  to catch a command and doubled, up to spin_time, each time it
+        //  succeeds, so that we stop burning CPU if commands are not
+        //  coming in shortly after the receiver runs out of them.
+        int spin_budget;
+
+        //  Waits for a command to be sent for at most 'spin_time_'
+        //  microseconds without blocking. Returns false if no command
+        //  arrived in time.
+        bool spin (int spin_time_);
+
         //  Disable copying of mailbox_t object.
         mailbox_t (const mailbox_t&);
         const mailbox_t &operator = (const mailbox_t&);
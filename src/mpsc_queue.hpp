@@ -0,0 +1,132 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_MPSC_QUEUE_HPP_INCLUDED__
+#define __ZMQ_MPSC_QUEUE_HPP_INCLUDED__
+
+#include <new>
+
+#include "atomic_ptr.hpp"
+#include "msg_pool.hpp"
+#include "err.hpp"
+
+namespace zmq
+{
+
+    //  Lock-free queue that any number of threads can push to while
+    //  a single thread pops from it.
+    //
+    //  Pushing an item swaps the tail of the queue for the new node and
+    //  then links the previous tail to it. Between the two steps the queue
+    //  is cut short: pop reports the queue empty although items pushed by
+    //  other threads may be queued after the node being linked. Callers
+    //  that know an item is available have to retry until it shows up.
+    //
+    //  Nodes are allocated from the message pool, which keeps them cached
+    //  per thread and hands nodes released by the reader back to the thread
+    //  that allocated them.
+
+    template <typename T> class mpsc_queue_t
+    {
+    public:
+
+        inline mpsc_queue_t ()
+        {
+            node_t *stub = allocate_node ();
+            head = stub;
+            tail.set (stub);
+        }
+
+        //  Releases the remaining items. Pushes that are in progress are
+        //  waited for.
+        inline ~mpsc_queue_t ()
+        {
+            T value;
+            while (true) {
+                while (pop (&value))
+                    ;
+                if (tail.load () == head)
+                    break;
+            }
+            deallocate_node (head);
+        }
+
+        //  Adds an item to the back of the queue. Can be called from any
+        //  thread.
+        inline void push (const T &value_)
+        {
+            node_t *node = allocate_node ();
+            node->value = value_;
+
+            //  The exchange is a full barrier, so the item is visible to
+            //  the reader before it gets linked.
+            node_t *prev = tail.xchg (node);
+            prev->next.set (node);
+        }
+
+        //  Removes an item from the front of the queue. Returns false if
+        //  there is no item available. Only the reader thread can call it.
+        inline bool pop (T *value_)
+        {
+            node_t *next = head->next.load ();
+            if (!next)
+                return false;
+            *value_ = next->value;
+            deallocate_node (head);
+            head = next;
+            return true;
+        }
+
+    private:
+
+        struct node_t
+        {
+            atomic_ptr_t <node_t> next;
+            T value;
+        };
+
+        static inline node_t *allocate_node ()
+        {
+            void *ptr = msg_pool_alloc (sizeof (node_t), NULL);
+            alloc_assert (ptr);
+            return new (ptr) node_t;
+        }
+
+        static inline void deallocate_node (node_t *node_)
+        {
+            node_->~node_t ();
+            msg_pool_free (node_, NULL);
+        }
+
+        //  The node the reader has popped last. Its value is no longer
+        //  valid, the next item in the queue is the one linked to it.
+        //  Accessed exclusively by the reader.
+        node_t *head;
+
+        //  The node pushed last. Contended by the writers.
+        atomic_ptr_t <node_t> tail;
+
+        //  Disable copying of mpsc_queue_t object.
+        mpsc_queue_t (const mpsc_queue_t&);
+        const mpsc_queue_t &operator = (const mpsc_queue_t&);
+    };
+
+}
+
+#endif
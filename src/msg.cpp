@@ -44,13 +44,18 @@ int zmq::msg_t::init ()
     u.vsm.type = type_vsm;
     u.vsm.flags = 0;
     u.vsm.size = 0;
-    file_desc = -1;
+    set_fd (-1);
     return 0;
 }
 
 int zmq::msg_t::init_size (size_t size_)
 {
-    file_desc = -1;
+    return init_size (size_, allocator_t ());
+}
+
+int zmq::msg_t::init_size (size_t size_, const allocator_t &allocator_)
+{
+    set_fd (-1);
     if (size_ <= max_vsm_size) {
         u.vsm.type = type_vsm;
         u.vsm.flags = 0;
@@ -60,7 +65,7 @@ int zmq::msg_t::init_size (size_t size_)
         u.lmsg.type = type_lmsg;
         u.lmsg.flags = 0;
         u.lmsg.content =
-            (content_t*) malloc (sizeof (content_t) + size_);
+            (content_t*) allocator_.allocate (sizeof (content_t) + size_);
         if (unlikely (!u.lmsg.content)) {
             errno = ENOMEM;
             return -1;
@@ -70,6 +75,8 @@ int zmq::msg_t::init_size (size_t size_)
         u.lmsg.content->size = size_;
         u.lmsg.content->ffn = NULL;
         u.lmsg.content->hint = NULL;
+        u.lmsg.content->cfn = allocator_.free_fn;
+        u.lmsg.content->chint = allocator_.hint;
         new (&u.lmsg.content->refcnt) zmq::atomic_counter_t ();
     }
     return 0;
@@ -82,7 +89,7 @@ int zmq::msg_t::init_data (void *data_, size_t size_, msg_free_fn *ffn_,
     //  would occur once the data is accessed
     zmq_assert (data_ != NULL || size_ == 0);
     
-    file_desc = -1;
+    set_fd (-1);
 
     //  Initialize constant message if there's no need to deallocate
     if(ffn_ == NULL) {
@@ -104,6 +111,8 @@ int zmq::msg_t::init_data (void *data_, size_t size_, msg_free_fn *ffn_,
         u.lmsg.content->size = size_;
         u.lmsg.content->ffn = ffn_;
         u.lmsg.content->hint = hint_;
+        u.lmsg.content->cfn = NULL;
+        u.lmsg.content->chint = NULL;
         new (&u.lmsg.content->refcnt) zmq::atomic_counter_t ();
     }
     return 0;
@@ -132,14 +141,7 @@ int zmq::msg_t::close ()
         if (!(u.lmsg.flags & msg_t::shared) ||
               !u.lmsg.content->refcnt.sub (1)) {
 
-            //  We used "placement new" operator to initialize the reference
-            //  counter so we call the destructor explicitly now.
-            u.lmsg.content->refcnt.~atomic_counter_t ();
-
-            if (u.lmsg.content->ffn)
-                u.lmsg.content->ffn (u.lmsg.content->data,
-                    u.lmsg.content->hint);
-            free (u.lmsg.content);
+            free_content (u.lmsg.content);
         }
     }
 
@@ -254,12 +256,20 @@ void zmq::msg_t::reset_flags (unsigned char flags_)
 
 int64_t zmq::msg_t::fd ()
 {
+#if defined ZMQ_CACHELINE_MSG
+    return u.base.file_desc;
+#else
     return file_desc;
+#endif
 }
 
 void zmq::msg_t::set_fd (int64_t fd_)
 {
+#if defined ZMQ_CACHELINE_MSG
+    u.base.file_desc = (int32_t) fd_;
+#else
     file_desc = fd_;
+#endif
 }
 
 bool zmq::msg_t::is_identity () const
@@ -323,17 +333,23 @@ bool zmq::msg_t::rm_refs (int refs_)
 
     //  The only message type that needs special care are long messages.
     if (!u.lmsg.content->refcnt.sub (refs_)) {
-        //  We used "placement new" operator to initialize the reference
-        //  counter so we call the destructor explicitly now.
-        u.lmsg.content->refcnt.~atomic_counter_t ();
-
-        if (u.lmsg.content->ffn)
-            u.lmsg.content->ffn (u.lmsg.content->data, u.lmsg.content->hint);
-        free (u.lmsg.content);
-
+        free_content (u.lmsg.content);
         return false;
     }
 
     return true;
 }
 
+void zmq::msg_t::free_content (content_t *content_)
+{
+    //  We used "placement new" operator to initialize the reference
+    //  counter so we call the destructor explicitly now.
+    content_->refcnt.~atomic_counter_t ();
+
+    if (content_->ffn)
+        content_->ffn (content_->data, content_->hint);
+    if (content_->cfn)
+        content_->cfn (content_, content_->chint);
+    else
+        free (content_);
+}
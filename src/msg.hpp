@@ -24,6 +24,8 @@
 #include <stdio.h>
 
 #include "config.hpp"
+#include "stdint.hpp"
+#include "allocator.hpp"
 #include "atomic_counter.hpp"
 
 //  Signature for free function to deallocate the message content.
@@ -57,6 +59,7 @@ namespace zmq
         bool check ();
         int init ();
         int init_size (size_t size_);
+        int init_size (size_t size_, const allocator_t &allocator_);
         int init_data (void *data_, size_t size_, msg_free_fn *ffn_,
             void *hint_);
         int init_delimiter ();
@@ -87,8 +90,15 @@ namespace zmq
     private:
 
         //  Size in bytes of the largest message that is still copied around
-        //  rather than being reference-counted.
+        //  rather than being reference-counted. With ZMQ_CACHELINE_MSG the
+        //  whole message occupies 64 bytes and the file descriptor is
+        //  stored in the union, after the type and flags shared by all the
+        //  message types.
+#if defined ZMQ_CACHELINE_MSG
+        enum {max_vsm_size = 64 - 3 - sizeof (int32_t)};
+#else
         enum {max_vsm_size = 29};
+#endif
 
         //  Shared message buffer. Message data are either allocated in one
         //  continuous block along with this structure - thus avoiding one
@@ -96,16 +106,22 @@ namespace zmq
         //  In the latter case, ffn member stores pointer to the function to be
         //  used to deallocate the data. If the buffer is actually shared (there
         //  are at least 2 references to it) refcount member contains number of
-        //  references.
+        //  references. The structure itself is released using cfn and chint
+        //  or using free() if cfn is NULL.
         struct content_t
         {
             void *data;
             size_t size;
             msg_free_fn *ffn;
             void *hint;
+            msg_dealloc_fn *cfn;
+            void *chint;
             zmq::atomic_counter_t refcnt;
         };
 
+        //  Releases the content of a long message.
+        static void free_content (content_t *content_);
+
         //  Different message types.
         enum type_t
         {
@@ -120,9 +136,11 @@ namespace zmq
             type_cmsg = 104,
             type_max = 104
         };
-  
+
+#if !defined ZMQ_CACHELINE_MSG
         // the file descriptor where this message originated, needs to be 64bit due to alignment
         int64_t file_desc;
+#endif
 
         //  Note that fields shared between different message types are not
         //  moved to tha parent class (msg_t). This way we ger tighter packing
@@ -133,6 +151,10 @@ namespace zmq
                 unsigned char unused [max_vsm_size + 1];
                 unsigned char type;
                 unsigned char flags;
+#if defined ZMQ_CACHELINE_MSG
+                //  The file descriptor where this message originated.
+                int32_t file_desc;
+#endif
             } base;
             struct {
                 unsigned char data [max_vsm_size];
@@ -0,0 +1,357 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <new>
+
+#include "platform.hpp"
+#include "msg_pool.hpp"
+#include "atomic_ptr.hpp"
+#include "atomic_counter.hpp"
+#include "likely.hpp"
+#include "err.hpp"
+
+#if !defined ZMQ_HAVE_WINDOWS
+#include <pthread.h>
+#endif
+
+namespace
+{
+    //  Blocks are pooled in size classes ranging from 64 bytes to 128kB
+    //  (header included) so that 64kB message bodies still fit into the
+    //  pool. There are two classes per power of two, e.g. 64, 96, 128, 192,
+    //  256 and so on, so that at most one third of a block is wasted.
+    enum
+    {
+        min_class_shift = 6,
+        max_class_shift = 17,
+        class_count = (max_class_shift - min_class_shift) * 2 + 1
+    };
+
+    //  Maximal number of bytes kept in the local free list of a single
+    //  size class. Anything above the limit is returned to malloc.
+    enum {max_cached_bytes = 4 * 1024 * 1024};
+
+    //  Minimal number of blocks kept per size class, whatever their size.
+    enum {min_cached_blocks = 4};
+
+    //  Number of blocks released on behalf of another thread that are
+    //  batched before being handed back to the owner in a single operation.
+    enum {max_batch_size = 32};
+
+    struct cache_t;
+
+    //  Header preceding every block handed out by the pool.
+    struct block_t
+    {
+        //  Cache the block belongs to. NULL if the block was allocated
+        //  directly by malloc and should be freed the same way.
+        cache_t *owner;
+
+        //  Next block in a free list.
+        block_t *next;
+
+        int size_class;
+    };
+
+    //  Per-thread cache of free blocks.
+    struct cache_t
+    {
+        //  Free blocks that can be reused by the owning thread without
+        //  any synchronisation.
+        block_t *local [class_count];
+        int count [class_count];
+
+        //  Blocks released by other threads. Once the owning thread exits
+        //  the list is replaced by the 'dead' sentinel and blocks released
+        //  afterwards are returned to malloc directly.
+        zmq::atomic_ptr_t <block_t> remote;
+
+        //  Blocks released by this thread that belong to batch_owner and
+        //  were not handed back to it yet.
+        cache_t *batch_owner;
+        block_t *batch_head;
+        block_t *batch_tail;
+        int batch_count;
+
+        //  Number of blocks allocated on behalf of this cache that were not
+        //  returned to malloc yet, plus one for the owning thread itself.
+        //  The cache is deallocated once it drops to zero.
+        zmq::atomic_counter_t refs;
+    };
+
+    block_t dead_block;
+    block_t *const dead = &dead_block;
+
+    inline size_t class_size (int cls_)
+    {
+        const int shift = min_class_shift + cls_ / 2;
+        return cls_ % 2 ? (size_t) 3 << (shift - 1) : (size_t) 1 << shift;
+    }
+
+    inline int size_class (size_t size_)
+    {
+        int cls = 0;
+        while (cls != class_count && class_size (cls) < size_)
+            cls++;
+        return cls == class_count ? -1 : cls;
+    }
+
+    inline int max_cached (int cls_)
+    {
+        const int n = (int) (max_cached_bytes / class_size (cls_));
+        return n < min_cached_blocks ? min_cached_blocks : n;
+    }
+
+    //  Returns the block to malloc and drops the owner's reference to it.
+    void release (block_t *block_)
+    {
+        cache_t *owner = block_->owner;
+        free (block_);
+        if (!owner->refs.sub (1))
+            delete owner;
+    }
+
+    //  Puts the block into the local free list of the calling thread.
+    void put_local (cache_t *cache_, block_t *block_)
+    {
+        const int cls = block_->size_class;
+        if (cache_->count [cls] >= max_cached (cls)) {
+            release (block_);
+            return;
+        }
+        block_->next = cache_->local [cls];
+        cache_->local [cls] = block_;
+        cache_->count [cls]++;
+    }
+
+    //  Hands the list of blocks back to their owning thread.
+    void put_remote (cache_t *owner_, block_t *head_, block_t *tail_)
+    {
+        block_t *head = owner_->remote.cas (NULL, NULL);
+        while (true) {
+            if (head == dead) {
+                while (head_) {
+                    block_t *next = head_->next;
+                    release (head_);
+                    head_ = next;
+                }
+                return;
+            }
+            tail_->next = head;
+            block_t *prev = owner_->remote.cas (head, head_);
+            if (prev == head)
+                return;
+            head = prev;
+        }
+    }
+
+    void flush_batch (cache_t *cache_)
+    {
+        if (!cache_->batch_head)
+            return;
+        put_remote (cache_->batch_owner, cache_->batch_head,
+            cache_->batch_tail);
+        cache_->batch_owner = NULL;
+        cache_->batch_head = NULL;
+        cache_->batch_tail = NULL;
+        cache_->batch_count = 0;
+    }
+
+    //  Adds the block to the batch of blocks to be handed back to another
+    //  thread. The batch is flushed once it is full or once a block owned
+    //  by a different thread is released.
+    void put_batch (cache_t *cache_, block_t *block_)
+    {
+        if (cache_->batch_owner != block_->owner)
+            flush_batch (cache_);
+        block_->next = cache_->batch_head;
+        cache_->batch_head = block_;
+        if (!cache_->batch_tail)
+            cache_->batch_tail = block_;
+        cache_->batch_owner = block_->owner;
+        if (++cache_->batch_count == max_batch_size)
+            flush_batch (cache_);
+    }
+
+    //  Moves the blocks released by other threads to the local free lists.
+    void reclaim (cache_t *cache_)
+    {
+        block_t *block = cache_->remote.xchg (NULL);
+        while (block) {
+            block_t *next = block->next;
+            put_local (cache_, block);
+            block = next;
+        }
+    }
+
+#if !defined ZMQ_HAVE_WINDOWS
+
+    pthread_key_t cache_key;
+    pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+
+    //  Invoked when the owning thread exits.
+    void destroy_cache (void *arg_)
+    {
+        cache_t *cache = (cache_t*) arg_;
+
+        flush_batch (cache);
+
+        block_t *block = cache->remote.xchg (dead);
+        while (block) {
+            block_t *next = block->next;
+            release (block);
+            block = next;
+        }
+        for (int cls = 0; cls != class_count; cls++) {
+            block = cache->local [cls];
+            while (block) {
+                block_t *next = block->next;
+                release (block);
+                block = next;
+            }
+        }
+
+        if (!cache->refs.sub (1))
+            delete cache;
+    }
+
+    extern "C"
+    {
+        static void destroy_cache_routine (void *arg_)
+        {
+            destroy_cache (arg_);
+        }
+
+        static void create_cache_key ()
+        {
+            int rc = pthread_key_create (&cache_key, destroy_cache_routine);
+            posix_assert (rc);
+        }
+    }
+
+    inline cache_t *find_cache ()
+    {
+        return (cache_t*) pthread_getspecific (cache_key);
+    }
+
+    cache_t *get_cache ()
+    {
+        int rc = pthread_once (&cache_key_once, create_cache_key);
+        posix_assert (rc);
+
+        cache_t *cache = find_cache ();
+        if (likely (cache != NULL))
+            return cache;
+
+        cache = new (std::nothrow) cache_t;
+        if (unlikely (!cache))
+            return NULL;
+        for (int cls = 0; cls != class_count; cls++) {
+            cache->local [cls] = NULL;
+            cache->count [cls] = 0;
+        }
+        cache->batch_owner = NULL;
+        cache->batch_head = NULL;
+        cache->batch_tail = NULL;
+        cache->batch_count = 0;
+        cache->refs.set (1);
+
+        rc = pthread_setspecific (cache_key, cache);
+        if (unlikely (rc != 0)) {
+            delete cache;
+            return NULL;
+        }
+        return cache;
+    }
+
+#else
+
+    //  There's no portable way to get notified about thread termination
+    //  on Windows so the pool falls back to plain malloc there.
+
+    inline cache_t *get_cache ()
+    {
+        return NULL;
+    }
+
+#endif
+
+}
+
+void *zmq::msg_pool_alloc (size_t size_, void *)
+{
+    const size_t total = size_ + sizeof (block_t);
+    const int cls = total < size_ ? -1 : size_class (total);
+    cache_t *cache = cls < 0 ? NULL : get_cache ();
+
+    //  Oversized requests and threads without a cache are served
+    //  by malloc directly.
+    if (unlikely (!cache)) {
+        if (total < size_)
+            return NULL;
+        block_t *block = (block_t*) malloc (total);
+        if (unlikely (!block))
+            return NULL;
+        block->owner = NULL;
+        block->size_class = -1;
+        return block + 1;
+    }
+
+    if (!cache->local [cls])
+        reclaim (cache);
+
+    block_t *block = cache->local [cls];
+    if (likely (block != NULL)) {
+        cache->local [cls] = block->next;
+        cache->count [cls]--;
+        return block + 1;
+    }
+
+    block = (block_t*) malloc (class_size (cls));
+    if (unlikely (!block))
+        return NULL;
+    block->owner = cache;
+    block->size_class = cls;
+    cache->refs.add (1);
+    return block + 1;
+}
+
+void zmq::msg_pool_free (void *ptr_, void *)
+{
+    if (!ptr_)
+        return;
+
+    block_t *block = ((block_t*) ptr_) - 1;
+    if (!block->owner) {
+        free (block);
+        return;
+    }
+
+    cache_t *cache = get_cache ();
+    if (block->owner == cache)
+        put_local (cache, block);
+    else
+    if (cache)
+        put_batch (cache, block);
+    else {
+        block->next = NULL;
+        put_remote (block->owner, block, block);
+    }
+}
@@ -0,0 +1,42 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_MSG_POOL_HPP_INCLUDED__
+#define __ZMQ_MSG_POOL_HPP_INCLUDED__
+
+#include <stddef.h>
+
+namespace zmq
+{
+
+    //  Size-class pool allocator for message bodies. Every thread owns
+    //  a cache of free blocks, one list per size class.
+    //  Blocks released by the owning thread go straight back to its cache;
+    //  blocks released by any other thread are collected in small batches
+    //  and pushed to a lock-free list that the owner reclaims the next time
+    //  it runs out of blocks.
+    //  Requests larger than the biggest size class go to malloc directly.
+    //  Both functions match the allocator_t signatures, the hint is ignored.
+
+    void *msg_pool_alloc (size_t size_, void *hint_);
+    void msg_pool_free (void *ptr_, void *hint_);
+
+}
+
+#endif
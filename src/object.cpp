@@ -30,13 +30,15 @@
 
 zmq::object_t::object_t (ctx_t *ctx_, uint32_t tid_) :
     ctx (ctx_),
-    tid (tid_)
+    tid (tid_),
+    current_tid (tid_)
 {
 }
 
 zmq::object_t::object_t (object_t *parent_) :
     ctx (parent_->ctx),
-    tid (parent_->tid)
+    tid (parent_->tid),
+    current_tid (parent_->current_tid)
 {
 }
 
@@ -52,6 +54,17 @@ uint32_t zmq::object_t::get_tid ()
 void zmq::object_t::set_tid(uint32_t id)
 {
     tid = id;
+    current_tid = id;
+}
+
+uint32_t zmq::object_t::get_current_tid ()
+{
+    return current_tid;
+}
+
+void zmq::object_t::set_current_tid (uint32_t tid_)
+{
+    current_tid = tid_;
 }
 
 zmq::ctx_t *zmq::object_t::get_ctx ()
@@ -131,6 +144,10 @@ void zmq::object_t::process_command (command_t &cmd_)
         process_seqnum ();
         break;
 
+    case command_t::migrate:
+        process_migrate (cmd_.args.migrate.io_thread);
+        break;
+
     case command_t::done:
     default:
         zmq_assert (false);
@@ -172,6 +189,12 @@ zmq::io_thread_t *zmq::object_t::choose_io_thread (uint64_t affinity_)
     return ctx->choose_io_thread (affinity_);
 }
 
+void zmq::object_t::choose_io_threads (uint64_t affinity_, int count_,
+    std::vector <io_thread_t*> &threads_)
+{
+    ctx->choose_io_threads (affinity_, count_, threads_);
+}
+
 void zmq::object_t::send_stop ()
 {
     //  'stop' command goes always from administrative thread to
@@ -332,6 +355,18 @@ void zmq::object_t::send_done ()
     ctx->send_command (ctx_t::term_tid, cmd);
 }
 
+void zmq::object_t::send_migrate (session_base_t *destination_,
+    io_thread_t *io_thread_)
+{
+    //  The command goes straight to the new thread, ahead of any command
+    //  the old thread forwards there afterwards.
+    command_t cmd;
+    cmd.destination = destination_;
+    cmd.type = command_t::migrate;
+    cmd.args.migrate.io_thread = io_thread_;
+    ctx->send_command (io_thread_->get_tid (), cmd);
+}
+
 void zmq::object_t::process_stop ()
 {
     zmq_assert (false);
@@ -407,11 +442,21 @@ void zmq::object_t::process_reaped ()
     zmq_assert (false);
 }
 
+void zmq::object_t::process_migrate (io_thread_t *)
+{
+    zmq_assert (false);
+}
+
 void zmq::object_t::process_seqnum ()
 {
     zmq_assert (false);
 }
 
+void zmq::object_t::forward_command (command_t &cmd_)
+{
+    ctx->send_command (cmd_.destination->current_tid, cmd_);
+}
+
 void zmq::object_t::send_command (command_t &cmd_)
 {
     ctx->send_command (cmd_.destination->get_tid (), cmd_);
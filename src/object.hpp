@@ -20,6 +20,8 @@
 #ifndef __ZMQ_OBJECT_HPP_INCLUDED__
 #define __ZMQ_OBJECT_HPP_INCLUDED__
 
+#include <vector>
+
 #include "stdint.hpp"
 
 namespace zmq
@@ -49,11 +51,22 @@ namespace zmq
 
         uint32_t get_tid ();
         void set_tid(uint32_t id);
+
+        //  Returns ID of the thread the object is running in. It differs
+        //  from the thread the object belongs to once the object has been
+        //  moved to another I/O thread.
+        uint32_t get_current_tid ();
+        void set_current_tid (uint32_t tid_);
+
         ctx_t *get_ctx ();
         void process_command (zmq::command_t &cmd_);
         void send_inproc_connected (zmq::socket_base_t *socket_);
         void send_bind (zmq::own_t *destination_, zmq::pipe_t *pipe_, bool inc_seqnum_ = true);
 
+        //  Passes the command on to the thread its destination has been
+        //  moved to.
+        void forward_command (zmq::command_t &cmd_);
+
     protected:
 
         //  Using following function, socket is able to access global
@@ -72,6 +85,10 @@ namespace zmq
         //  Chooses least loaded I/O thread.
         zmq::io_thread_t *choose_io_thread (uint64_t affinity_);
 
+        //  Chooses several I/O threads to spread objects across.
+        void choose_io_threads (uint64_t affinity_, int count_,
+            std::vector <zmq::io_thread_t*> &threads_);
+
         //  Derived object can use these functions to send commands
         //  to other objects.
         void send_stop ();
@@ -94,6 +111,8 @@ namespace zmq
         void send_reap (zmq::socket_base_t *socket_);
         void send_reaped ();
         void send_done ();
+        void send_migrate (zmq::session_base_t *destination_,
+            zmq::io_thread_t *io_thread_);
 
         //  These handlers can be overrided by the derived objects. They are
         //  called when command arrives from another thread.
@@ -112,6 +131,7 @@ namespace zmq
         virtual void process_term_ack ();
         virtual void process_reap (zmq::socket_base_t *socket_);
         virtual void process_reaped ();
+        virtual void process_migrate (zmq::io_thread_t *io_thread_);
 
         //  Special handler called after a command that requires a seqnum
         //  was processed. The implementation should catch up with its counter
@@ -126,6 +146,11 @@ namespace zmq
         //  Thread ID of the thread the object belongs to.
         uint32_t tid;
 
+        //  Thread ID of the thread the object is running in. Commands are
+        //  still sent to the thread the object belongs to, which forwards
+        //  them, so that they keep their order.
+        uint32_t current_tid;
+
         void send_command (command_t &cmd_);
 
         object_t (const object_t&);
@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include "options.hpp"
+#include "config.hpp"
 #include "err.hpp"
 #include "../include/zmq_utils.h"
 
@@ -54,7 +55,21 @@ zmq::options_t::options_t () :
     mechanism (ZMQ_NULL),
     as_server (0),
     socket_id (0),
-    conflate (false)
+    conflate (false),
+    inbound_poll_rate (zmq::inbound_poll_rate),
+    max_command_delay (zmq::max_command_delay),
+    adaptive_throttle (false),
+    read_budget (zmq::in_batch_size),
+    read_budget_msgs (0),
+    gather_threshold (zmq::out_iov_threshold),
+    zerocopy_threshold (0),
+    in_batch_size (zmq::in_batch_size),
+    out_batch_size (zmq::out_batch_size),
+    adaptive_batch (false),
+    coalesce_delay (0),
+    coalesce_bytes (0),
+    listener_shards (1),
+    busy_poll (0)
 {
 }
 
@@ -402,6 +417,97 @@ int zmq::options_t::setsockopt (int option_, const void *optval_,
             }
             break;
 
+        case ZMQ_INBOUND_POLL_RATE:
+            if (is_int && value >= 1) {
+                inbound_poll_rate = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_MAX_COMMAND_DELAY:
+            if (is_int && value >= 0) {
+                max_command_delay = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_THROTTLE:
+            if (is_int && (value == 0 || value == 1)) {
+                adaptive_throttle = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_READ_BUDGET:
+            if (is_int && value >= 1) {
+                read_budget = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_READ_BUDGET_MSGS:
+            if (is_int && value >= 0) {
+                read_budget_msgs = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_GATHER_THRESHOLD:
+            if (is_int && value >= 0) {
+                gather_threshold = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ZEROCOPY_THRESHOLD:
+            if (is_int && value >= 0) {
+                zerocopy_threshold = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                in_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int && value > 0 && value <= max_batch_size) {
+                out_batch_size = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_BATCH:
+            if (is_int && (value == 0 || value == 1)) {
+                adaptive_batch = (value != 0);
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_DELAY:
+            if (is_int && value >= 0) {
+                coalesce_delay = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_BYTES:
+            if (is_int && value >= 0) {
+                coalesce_bytes = value;
+                return 0;
+            }
+            break;
+
+        case ZMQ_LISTENER_SHARDS:
+            if (is_int && value >= 0) {
+                listener_shards = value;
+                return 0;
+            }
+            break;
+
         default:
             break;
     }
@@ -682,6 +788,97 @@ int zmq::options_t::getsockopt (int option_, void *optval_, size_t *optvallen_)
             }
             break;
 
+        case ZMQ_INBOUND_POLL_RATE:
+            if (is_int) {
+                *value = inbound_poll_rate;
+                return 0;
+            }
+            break;
+
+        case ZMQ_MAX_COMMAND_DELAY:
+            if (is_int) {
+                *value = max_command_delay;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_THROTTLE:
+            if (is_int) {
+                *value = adaptive_throttle;
+                return 0;
+            }
+            break;
+
+        case ZMQ_READ_BUDGET:
+            if (is_int) {
+                *value = read_budget;
+                return 0;
+            }
+            break;
+
+        case ZMQ_READ_BUDGET_MSGS:
+            if (is_int) {
+                *value = read_budget_msgs;
+                return 0;
+            }
+            break;
+
+        case ZMQ_GATHER_THRESHOLD:
+            if (is_int) {
+                *value = gather_threshold;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ZEROCOPY_THRESHOLD:
+            if (is_int) {
+                *value = zerocopy_threshold;
+                return 0;
+            }
+            break;
+
+        case ZMQ_IN_BATCH_SIZE:
+            if (is_int) {
+                *value = in_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_OUT_BATCH_SIZE:
+            if (is_int) {
+                *value = out_batch_size;
+                return 0;
+            }
+            break;
+
+        case ZMQ_ADAPTIVE_BATCH:
+            if (is_int) {
+                *value = adaptive_batch;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_DELAY:
+            if (is_int) {
+                *value = coalesce_delay;
+                return 0;
+            }
+            break;
+
+        case ZMQ_COALESCE_BYTES:
+            if (is_int) {
+                *value = coalesce_bytes;
+                return 0;
+            }
+            break;
+
+        case ZMQ_LISTENER_SHARDS:
+            if (is_int) {
+                *value = listener_shards;
+                return 0;
+            }
+            break;
+
     }
     errno = EINVAL;
     return -1;
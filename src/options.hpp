@@ -27,6 +27,7 @@
 #include "stddef.h"
 #include "stdint.hpp"
 #include "tcp_address.hpp"
+#include "allocator.hpp"
 #include "../include/zmq.h"
 
 #if defined ZMQ_HAVE_SO_PEERCRED || defined ZMQ_HAVE_LOCAL_PEERCRED
@@ -164,6 +165,67 @@ namespace zmq
         //  Cannot receive multi-part messages.
         //  Ignores hwm
         bool conflate;
+
+        //  Allocator for the bodies of the messages created on behalf of
+        //  this socket. Copied from the context when the socket is created.
+        allocator_t allocator;
+
+        //  Allocator for the message queues of the pipes of this socket.
+        //  Copied from the context when the socket is created.
+        allocator_t pipe_allocator;
+
+        //  Number of messages received between two checks for commands.
+        int inbound_poll_rate;
+
+        //  Minimal time, in CPU ticks, between two checks for commands
+        //  when sending.
+        int max_command_delay;
+
+        //  If true, the two limits above are the upper bounds of ones that
+        //  shrink when commands are found and grow back when they aren't.
+        bool adaptive_throttle;
+
+        //  Maximal number of bytes an engine reads from its connection,
+        //  and maximal number of messages it decodes (0 means no limit),
+        //  per input event before yielding to other engines.
+        int read_budget;
+        int read_budget_msgs;
+
+        //  Message parts of at least this many bytes are written from the
+        //  message in place by a vectored write rather than copied to the
+        //  output buffer. Zero means that everything is copied.
+        int gather_threshold;
+
+        //  Message parts of at least this many bytes that are written in
+        //  place are sent with MSG_ZEROCOPY where supported. Zero means
+        //  that zero-copy sends are not used.
+        int zerocopy_threshold;
+
+        //  Sizes of the buffers engines decode input from and encode
+        //  output to, i.e. the most data a single read or write of
+        //  copied data handles.
+        int in_batch_size;
+        int out_batch_size;
+
+        //  If true, engines start with the buffer sizes above and then
+        //  adjust them to the sizes of the reads and writes they do.
+        bool adaptive_batch;
+
+        //  Longest time, in microseconds, engines hold back output that
+        //  is smaller than coalesce_bytes so that more messages can go out
+        //  with the same write. Zero means that output is never held back.
+        //  If coalesce_bytes is zero, the output batch size is used.
+        int coalesce_delay;
+        int coalesce_bytes;
+
+        //  Number of listeners a TCP endpoint is bound with, each in an
+        //  I/O thread of its own and all sharing the port. Zero means one
+        //  in each of the I/O threads the affinity allows.
+        int listener_shards;
+
+        //  Time the I/O threads busy poll for events before blocking, in
+        //  microseconds. Copied from the context when the socket is created.
+        int busy_poll;
     };
 }
 
@@ -107,6 +107,17 @@ void zmq::pgm_receiver_t::restart_output ()
     drop_subscriptions ();
 }
 
+bool zmq::pgm_receiver_t::unplug_poller ()
+{
+    //  Multicast engines stay in the I/O thread they were started in.
+    return false;
+}
+
+void zmq::pgm_receiver_t::plug_poller (io_thread_t *)
+{
+    zmq_assert (false);
+}
+
 void zmq::pgm_receiver_t::restart_input ()
 {
     zmq_assert (session != NULL);
@@ -225,7 +236,7 @@ void zmq::pgm_receiver_t::in_event ()
 
             //  Create and connect decoder for the peer.
             it->second.decoder = new (std::nothrow)
-                v1_decoder_t (0, options.maxmsgsize);
+                v1_decoder_t (0, options.maxmsgsize, options.allocator);
             alloc_assert (it->second.decoder);
         }
 
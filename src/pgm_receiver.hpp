@@ -60,6 +60,8 @@ namespace zmq
         void restart_input ();
         void restart_output ();
         void zap_msg_available () {}
+        bool unplug_poller ();
+        void plug_poller (zmq::io_thread_t *io_thread_);
 
         //  i_poll_events interface implementation.
         void in_event ();
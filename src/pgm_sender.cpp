@@ -40,7 +40,7 @@ zmq::pgm_sender_t::pgm_sender_t (io_thread_t *parent_,
     has_tx_timer (false),
     has_rx_timer (false),
     session (NULL),
-    encoder (0),
+    encoder (0, options_.allocator),
     more_flag (false),
     pgm_socket (false, options_),
     options (options_),
@@ -130,6 +130,17 @@ void zmq::pgm_sender_t::restart_input ()
     zmq_assert (false);
 }
 
+bool zmq::pgm_sender_t::unplug_poller ()
+{
+    //  Multicast engines stay in the I/O thread they were started in.
+    return false;
+}
+
+void zmq::pgm_sender_t::plug_poller (io_thread_t *)
+{
+    zmq_assert (false);
+}
+
 zmq::pgm_sender_t::~pgm_sender_t ()
 {
     int rc = msg.close ();
@@ -27,33 +27,34 @@
 #include "ypipe_conflate.hpp"
 
 int zmq::pipepair (class object_t *parents_ [2], class pipe_t* pipes_ [2],
-    int hwms_ [2], bool conflate_ [2])
+    int hwms_ [2], bool conflate_ [2], const allocator_t &allocator_)
 {
     //   Creates two pipe objects. These objects are connected by two ypipes,
     //   each to pass messages in one direction.
 
-    typedef ypipe_t <msg_t, message_pipe_granularity> upipe_normal_t;
+    typedef ypipe_t <msg_t, message_pipe_granularity,
+        message_pipe_min_granularity> upipe_normal_t;
     typedef ypipe_conflate_t <msg_t> upipe_conflate_t;
 
     pipe_t::upipe_t *upipe1;
     if(conflate_ [0])
         upipe1 = new (std::nothrow) upipe_conflate_t ();
     else
-        upipe1 = new (std::nothrow) upipe_normal_t ();
+        upipe1 = new (std::nothrow) upipe_normal_t (allocator_);
     alloc_assert (upipe1);
 
     pipe_t::upipe_t *upipe2;
     if(conflate_ [1])
         upipe2 = new (std::nothrow) upipe_conflate_t ();
     else
-        upipe2 = new (std::nothrow) upipe_normal_t ();
+        upipe2 = new (std::nothrow) upipe_normal_t (allocator_);
     alloc_assert (upipe2);
 
     pipes_ [0] = new (std::nothrow) pipe_t (parents_ [0], upipe1, upipe2,
-        hwms_ [1], hwms_ [0], conflate_ [0]);
+        hwms_ [1], hwms_ [0], conflate_ [0], allocator_);
     alloc_assert (pipes_ [0]);
     pipes_ [1] = new (std::nothrow) pipe_t (parents_ [1], upipe2, upipe1,
-        hwms_ [0], hwms_ [1], conflate_ [1]);
+        hwms_ [0], hwms_ [1], conflate_ [1], allocator_);
     alloc_assert (pipes_ [1]);
 
     pipes_ [0]->set_peer (pipes_ [1]);
@@ -63,7 +64,8 @@ int zmq::pipepair (class object_t *parents_ [2], class pipe_t* pipes_ [2],
 }
 
 zmq::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
-      int inhwm_, int outhwm_, bool conflate_) :
+      int inhwm_, int outhwm_, bool conflate_,
+      const allocator_t &allocator_) :
     object_t (parent_),
     inpipe (inpipe_),
     outpipe (outpipe_),
@@ -73,12 +75,15 @@ zmq::pipe_t::pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
     lwm (compute_lwm (inhwm_)),
     msgs_read (0),
     msgs_written (0),
+    flush_held (false),
+    flush_pending (false),
     peers_msgs_read (0),
     peer (NULL),
     sink (NULL),
     state (active),
     delay (true),
-    conflate (conflate_)
+    conflate (conflate_),
+    allocator (allocator_)
 {
 }
 
@@ -178,6 +183,52 @@ read_message:
     return true;
 }
 
+int zmq::pipe_t::read (msg_t *msgs_, int count_)
+{
+    if (unlikely (!in_active))
+        return 0;
+    if (unlikely (state != active && state != waiting_for_delimiter))
+        return 0;
+
+    const uint64_t msgs_read_before = msgs_read;
+
+    int nread = 0;
+    while (nread < count_) {
+        msg_t *msg = msgs_ + nread;
+        if (!inpipe->read (msg)) {
+            in_active = false;
+            break;
+        }
+
+        //  If this is a credential, save a copy and receive next message.
+        if (unlikely (msg->is_credential ())) {
+            const unsigned char *data =
+                static_cast <const unsigned char *> (msg->data ());
+            credential = blob_t (data, msg->size ());
+            const int rc = msg->close ();
+            zmq_assert (rc == 0);
+            continue;
+        }
+
+        //  If delimiter was read, start termination process of the pipe.
+        if (msg->is_delimiter ()) {
+            process_delimiter ();
+            break;
+        }
+
+        if (!(msg->flags () & msg_t::more) && !msg->is_identity ())
+            msgs_read++;
+        nread++;
+    }
+
+    //  Notify the writer once per batch even if several multiples
+    //  of the low watermark were crossed.
+    if (lwm > 0 && msgs_read / lwm != msgs_read_before / lwm)
+        send_activate_write (peer, msgs_read);
+
+    return nread;
+}
+
 bool zmq::pipe_t::check_write ()
 {
     if (unlikely (!out_active || state != active))
@@ -226,10 +277,29 @@ void zmq::pipe_t::flush ()
     if (state == term_ack_sent)
         return;
 
+    if (unlikely (flush_held)) {
+        flush_pending = true;
+        return;
+    }
+
     if (outpipe && !outpipe->flush ())
         send_activate_read (peer);
 }
 
+void zmq::pipe_t::hold_flush ()
+{
+    flush_held = true;
+}
+
+void zmq::pipe_t::release_flush ()
+{
+    flush_held = false;
+    if (flush_pending) {
+        flush_pending = false;
+        flush ();
+    }
+}
+
 void zmq::pipe_t::process_activate_read ()
 {
     if (!in_active && (state == active || state == waiting_for_delimiter)) {
@@ -415,9 +485,11 @@ void zmq::pipe_t::terminate (bool delay_)
 
         //  Write the delimiter into the pipe. Note that watermarks are not
         //  checked; thus the delimiter can be written even when the pipe is full.
+        //  It is flushed straight away even if the flushes are held.
         msg_t msg;
         msg.init_delimiter ();
         outpipe->write (msg, false);
+        flush_held = false;
         flush ();
     }
 }
@@ -485,7 +557,8 @@ void zmq::pipe_t::hiccup ()
             ypipe_conflate_t <msg_t> ();
     else
         inpipe = new (std::nothrow)
-            ypipe_t <msg_t, message_pipe_granularity> ();
+            ypipe_t <msg_t, message_pipe_granularity,
+                message_pipe_min_granularity> (allocator);
 
     alloc_assert (inpipe);
     in_active = true;
@@ -21,6 +21,7 @@
 #define __ZMQ_PIPE_HPP_INCLUDED__
 
 #include "msg.hpp"
+#include "allocator.hpp"
 #include "ypipe_base.hpp"
 #include "config.hpp"
 #include "object.hpp"
@@ -42,8 +43,9 @@ namespace zmq
     //  terminates straight away.
     //  If conflate is true, only the most recently arrived message could be
     //  read (older messages are discarded)
+    //  Memory for the queued messages is obtained from the allocator.
     int pipepair (zmq::object_t *parents_ [2], zmq::pipe_t* pipes_ [2],
-        int hwms_ [2], bool conflate_ [2]);
+        int hwms_ [2], bool conflate_ [2], const allocator_t &allocator_);
 
     struct i_pipe_events
     {
@@ -67,7 +69,7 @@ namespace zmq
     {
         //  This allows pipepair to create pipe objects.
         friend int pipepair (zmq::object_t *parents_ [2], zmq::pipe_t* pipes_ [2],
-            int hwms_ [2], bool conflate_ [2]);
+            int hwms_ [2], bool conflate_ [2], const allocator_t &allocator_);
             
     public:
 
@@ -86,6 +88,11 @@ namespace zmq
         //  Reads a message to the underlying pipe.
         bool read (msg_t *msg_);
 
+        //  Reads up to count_ messages from the underlying pipe. Returns
+        //  the number of messages read. If it is lower than count_ the pipe
+        //  has no more messages to read at the moment.
+        int read (msg_t *msgs_, int count_);
+
         //  Checks whether messages can be written to the pipe. If writing
         //  the message would cause high watermark the function returns false.
         bool check_write ();
@@ -100,6 +107,12 @@ namespace zmq
         //  Flush the messages downsteam.
         void flush ();
 
+        //  While the flushes are held, flush only records that there are
+        //  messages to be flushed. They are flushed at once, with at most
+        //  a single wakeup of the peer, when the flushes are released.
+        void hold_flush ();
+        void release_flush ();
+
         //  Temporaraily disconnects the inbound message stream and drops
         //  all the messages on the fly. Causes 'hiccuped' event to be generated
         //  in the peer.
@@ -135,7 +148,8 @@ namespace zmq
         //  Constructor is private. Pipe can only be created using
         //  pipepair function.
         pipe_t (object_t *parent_, upipe_t *inpipe_, upipe_t *outpipe_,
-            int inhwm_, int outhwm_, bool conflate_);
+            int inhwm_, int outhwm_, bool conflate_,
+            const allocator_t &allocator_);
 
         //  Pipepair uses this function to let us know about
         //  the peer pipe object.
@@ -162,6 +176,11 @@ namespace zmq
         uint64_t msgs_read;
         uint64_t msgs_written;
 
+        //  True if the flushes are held back by hold_flush, and true if
+        //  there was a flush held back since.
+        bool flush_held;
+        bool flush_pending;
+
         //  Last received peer's msgs_read. The actual number in the peer
         //  can be higher at the moment.
         uint64_t peers_msgs_read;
@@ -211,6 +230,9 @@ namespace zmq
 
         bool conflate;
 
+        //  Allocator for the new inpipe created on hiccup.
+        const allocator_t allocator;
+
         //  Disable copying.
         pipe_t (const pipe_t&);
         const pipe_t &operator = (const pipe_t&);
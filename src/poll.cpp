@@ -106,7 +106,7 @@ void zmq::poll_t::reset_pollout (handle_t handle_)
 
 void zmq::poll_t::start ()
 {
-    worker.start (worker_routine, this);
+    start_thread (worker, worker_routine, this);
 }
 
 void zmq::poll_t::stop ()
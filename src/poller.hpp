@@ -37,6 +37,9 @@
 #elif defined ZMQ_FORCE_KQUEUE
 #define ZMQ_USE_KQUEUE
 #include "kqueue.hpp"
+#elif defined ZMQ_FORCE_IO_URING
+#define ZMQ_USE_IO_URING
+#include "io_uring.hpp"
 #elif defined ZMQ_HAVE_LINUX
 #define ZMQ_USE_EPOLL
 #include "epoll.hpp"
@@ -21,7 +21,10 @@
 #include "i_poll_events.hpp"
 #include "err.hpp"
 
-zmq::poller_base_t::poller_base_t ()
+zmq::poller_base_t::poller_base_t () :
+    thread_policy (-1),
+    thread_priority (-1),
+    busy_poll (0)
 {
 }
 
@@ -45,55 +48,63 @@ void zmq::poller_base_t::adjust_load (int amount_)
         load.sub (-amount_);
 }
 
-void zmq::poller_base_t::add_timer (int timeout_, i_poll_events *sink_, int id_)
+uint64_t zmq::poller_base_t::get_avoided_updates ()
 {
-    uint64_t expiration = clock.now_ms () + timeout_;
-    timer_info_t info = {sink_, id_};
-    timers.insert (timers_t::value_type (expiration, info));
+    return avoided_updates.get ();
 }
 
-void zmq::poller_base_t::cancel_timer (i_poll_events *sink_, int id_)
+void zmq::poller_base_t::count_avoided_updates (int amount_)
 {
-    //  Complexity of this operation is O(n). We assume it is rarely used.
-    for (timers_t::iterator it = timers.begin (); it != timers.end (); ++it)
-        if (it->second.sink == sink_ && it->second.id == id_) {
-            timers.erase (it);
-            return;
-        }
-
-    //  Timer not found.
-    zmq_assert (false);
+    if (amount_ > 0)
+        avoided_updates.add (amount_);
 }
 
-uint64_t zmq::poller_base_t::execute_timers ()
+void zmq::poller_base_t::set_thread_scheduling (int policy_, int priority_,
+    const std::set <int> &cpus_)
 {
-    //  Fast track.
-    if (timers.empty ())
-        return 0;
+    thread_policy = policy_;
+    thread_priority = priority_;
+    thread_cpus = cpus_;
+}
+
+void zmq::poller_base_t::set_busy_poll (int busy_poll_)
+{
+    busy_poll = busy_poll_;
+}
 
-    //  Get the current time.
-    uint64_t current = clock.now_ms ();
+int zmq::poller_base_t::busy_poll_time (int timeout_)
+{
+    //  Don't spin past the next timer. The timer may be far enough away for
+    //  the time in microseconds not to fit into an int.
+    if (timeout_ && (uint64_t) busy_poll > (uint64_t) timeout_ * 1000)
+        return timeout_ * 1000;
+    return busy_poll;
+}
 
-    //   Execute the timers that are already due.
-    timers_t::iterator it = timers.begin ();
-    while (it != timers.end ()) {
+void zmq::poller_base_t::start_thread (thread_t &thread_, thread_fn *tfn_,
+    void *arg_)
+{
+    thread_.set_scheduling (thread_policy, thread_priority, thread_cpus);
+    thread_.start (tfn_, arg_);
+}
 
-        //  If we have to wait to execute the item, same will be true about
-        //  all the following items (multimap is sorted). Thus we can stop
-        //  checking the subsequent timers and return the time to wait for
-        //  the next timer (at least 1ms).
-        if (it->first > current)
-            return it->first - current;
+void zmq::poller_base_t::add_timer (int timeout_, i_poll_events *sink_, int id_)
+{
+    timers.add (clock.now_ms (), timeout_, sink_, id_);
+}
 
-        //  Trigger the timer.
-        it->second.sink->timer_event (it->second.id);
+void zmq::poller_base_t::cancel_timer (i_poll_events *sink_, int id_)
+{
+    timers.cancel (sink_, id_);
+}
 
-        //  Remove it from the list of active timers.
-        timers_t::iterator o = it;
-        ++it;
-        timers.erase (o);
-    }
+uint64_t zmq::poller_base_t::execute_timers ()
+{
+    //  Fast track.
+    if (!timers.size ())
+        return 0;
 
-    //  There are no more timers.
-    return 0;
+    //  Execute the timers that are already due and return the time to
+    //  wait for the next one (at least 1ms).
+    return timers.execute (clock.now_ms ());
 }
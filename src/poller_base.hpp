@@ -20,10 +20,12 @@
 #ifndef __ZMQ_POLLER_BASE_HPP_INCLUDED__
 #define __ZMQ_POLLER_BASE_HPP_INCLUDED__
 
-#include <map>
+#include <set>
 
 #include "clock.hpp"
 #include "atomic_counter.hpp"
+#include "timer_wheel.hpp"
+#include "thread.hpp"
 
 namespace zmq
 {
@@ -41,6 +43,12 @@ namespace zmq
         //  invoked from a different thread!
         int get_load ();
 
+        //  Returns the number of system calls to change the set of polled
+        //  events that the poller managed to avoid, by coalescing changes
+        //  made to the same file descriptor. Note that this function can
+        //  be invoked from a different thread!
+        uint64_t get_avoided_updates ();
+
         //  Add a timeout to expire in timeout_ milliseconds. After the
         //  expiration timer_event on sink_ object will be called with
         //  argument set to id_.
@@ -49,33 +57,62 @@ namespace zmq
         //  Cancel the timer created by sink_ object with ID equal to id_.
         void cancel_timer (zmq::i_poll_events *sink_, int id_);
 
+        //  Sets the scheduling policy, priority and CPU set of the worker
+        //  thread. Has effect only if called before the poller is started.
+        void set_thread_scheduling (int policy_, int priority_,
+            const std::set <int> &cpus_);
+
+        //  Sets the time, in microseconds, the worker thread polls for
+        //  events without blocking before it goes to sleep. Zero disables
+        //  busy polling. To be called before the poller is started.
+        void set_busy_poll (int busy_poll_);
+
     protected:
 
+        //  Called by individual poller implementations to launch their
+        //  worker thread with the scheduling parameters set.
+        void start_thread (thread_t &thread_, thread_fn *tfn_, void *arg_);
+
         //  Called by individual poller implementations to manage the load.
         void adjust_load (int amount_);
 
+        //  Called by individual poller implementations to account for
+        //  the system calls avoided.
+        void count_avoided_updates (int amount_);
+
         //  Executes any timers that are due. Returns number of milliseconds
         //  to wait to match the next timer or 0 meaning "no timers".
         uint64_t execute_timers ();
 
+        //  Returns the time, in microseconds, to busy poll before blocking
+        //  for up to timeout_ milliseconds (0 meaning "no timeout"). Zero
+        //  if the poller is not in busy polling mode.
+        int busy_poll_time (int timeout_);
+
     private:
 
         //  Clock instance private to this I/O thread.
         clock_t clock;
 
-        //  List of active timers.
-        struct timer_info_t
-        {
-            zmq::i_poll_events *sink;
-            int id;
-        };
-        typedef std::multimap <uint64_t, timer_info_t> timers_t;
-        timers_t timers;
+        //  Active timers.
+        timer_wheel_t timers;
 
         //  Load of the poller. Currently the number of file descriptors
         //  registered.
         atomic_counter_t load;
 
+        //  Number of system calls avoided. It's counted in 64 bits so
+        //  that it doesn't wrap around in a long-running process.
+        atomic_counter64_t avoided_updates;
+
+        //  Scheduling parameters of the worker thread.
+        int thread_policy;
+        int thread_priority;
+        std::set <int> thread_cpus;
+
+        //  Time to busy poll before blocking, in microseconds.
+        int busy_poll;
+
         poller_base_t (const poller_base_t&);
         const poller_base_t &operator = (const poller_base_t&);
     };
@@ -56,6 +56,11 @@ int zmq::pull_t::xrecv (msg_t *msg_)
     return fq.recv (msg_);
 }
 
+int zmq::pull_t::xrecvmmsg (msg_t *msgs_, int count_)
+{
+    return fq.recvmmsg (msgs_, count_);
+}
+
 bool zmq::pull_t::xhas_in ()
 {
     return fq.has_in ();
@@ -45,6 +45,7 @@ namespace zmq
         //  Overrides of functions from socket_base_t.
         void xattach_pipe (zmq::pipe_t *pipe_, bool subscribe_to_all_);
         int xrecv (zmq::msg_t *msg_);
+        int xrecvmmsg (zmq::msg_t *msgs_, int count_);
         bool xhas_in ();
         blob_t get_credential () const;
         void xread_activated (zmq::pipe_t *pipe_);
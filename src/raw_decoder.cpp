@@ -28,13 +28,15 @@
 #include "raw_decoder.hpp"
 #include "err.hpp"
 
-zmq::raw_decoder_t::raw_decoder_t (size_t bufsize_) :
-    bufsize (bufsize_)
+zmq::raw_decoder_t::raw_decoder_t (size_t bufsize_,
+      const allocator_t &allocator_) :
+    bufsize (bufsize_),
+    allocator (allocator_)
 {
     int rc = in_progress.init ();
     errno_assert (rc == 0);
 
-    buffer = (unsigned char *) malloc (bufsize);
+    buffer = (unsigned char *) allocator.allocate (bufsize);
     alloc_assert (buffer);
 }
 
@@ -43,7 +45,7 @@ zmq::raw_decoder_t::~raw_decoder_t ()
     int rc = in_progress.close ();
     errno_assert (rc == 0);
 
-    free (buffer);
+    allocator.deallocate (buffer);
 }
 
 void zmq::raw_decoder_t::get_buffer (unsigned char **data_, size_t *size_)
@@ -52,10 +54,19 @@ void zmq::raw_decoder_t::get_buffer (unsigned char **data_, size_t *size_)
     *size_ = bufsize;
 }
 
+void zmq::raw_decoder_t::resize_buffer (size_t size_)
+{
+    unsigned char *new_buffer = (unsigned char *) allocator.allocate (size_);
+    alloc_assert (new_buffer);
+    allocator.deallocate (buffer);
+    buffer = new_buffer;
+    bufsize = size_;
+}
+
 int zmq::raw_decoder_t::decode (const uint8_t *data_, size_t size_,
     size_t &bytes_used_)
 {
-    int rc = in_progress.init_size (size_);
+    int rc = in_progress.init_size (size_, allocator);
     errno_assert (rc != -1);
     memcpy (in_progress.data (), data_, size_);
     bytes_used_ = size_;
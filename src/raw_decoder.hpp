@@ -34,13 +34,15 @@ namespace zmq
     {
     public:
 
-        raw_decoder_t (size_t bufsize_);
+        raw_decoder_t (size_t bufsize_, const allocator_t &allocator_);
         virtual ~raw_decoder_t ();
 
         //  i_decoder interface.
 
         virtual void get_buffer (unsigned char **data_, size_t *size_);
 
+        virtual void resize_buffer (size_t size_);
+
         virtual int decode (const unsigned char *data_, size_t size_,
                             size_t &processed);
 
@@ -52,7 +54,11 @@ namespace zmq
 
         msg_t in_progress;
 
-        const size_t bufsize;
+        size_t bufsize;
+
+        //  Allocator for the buffer and for the bodies of the decoded
+        //  messages.
+        const allocator_t allocator;
 
         unsigned char *buffer;
 
@@ -44,7 +44,7 @@ namespace zmq
     {
     public:
 
-        raw_encoder_t (size_t bufsize_);
+        raw_encoder_t (size_t bufsize_, const allocator_t &allocator_);
         ~raw_encoder_t ();
 
     private:
@@ -47,6 +47,12 @@ zmq::mailbox_t *zmq::reaper_t::get_mailbox ()
     return &mailbox;
 }
 
+zmq::poller_t *zmq::reaper_t::get_poller ()
+{
+    zmq_assert (poller);
+    return poller;
+}
+
 void zmq::reaper_t::start ()
 {
     //  Start the thread.
@@ -40,6 +40,10 @@ namespace zmq
 
         mailbox_t *get_mailbox ();
 
+        //  Used by the context to set up the reaper thread before it's
+        //  started.
+        poller_t *get_poller ();
+
         void start ();
         void stop ();
 
@@ -136,7 +136,7 @@ void zmq::select_t::reset_pollout (handle_t handle_)
 
 void zmq::select_t::start ()
 {
-    worker.start (worker_routine, this);
+    start_thread (worker, worker_routine, this);
 }
 
 void zmq::select_t::stop ()
@@ -28,6 +28,8 @@
 #include "pgm_sender.hpp"
 #include "pgm_receiver.hpp"
 #include "address.hpp"
+#include "io_thread.hpp"
+#include "config.hpp"
 
 #include "ctx.hpp"
 #include "req.hpp"
@@ -79,7 +81,8 @@ zmq::session_base_t::session_base_t (class io_thread_t *io_thread_,
     socket (socket_),
     io_thread (io_thread_),
     has_linger_timer (false),
-    addr (addr_)
+    addr (addr_),
+    traffic (0)
 {
 }
 
@@ -98,6 +101,8 @@ zmq::session_base_t::~session_base_t ()
     if (engine)
         engine->terminate ();
 
+    io_thread->rm_session (this);
+
     delete addr;
 }
 
@@ -118,13 +123,16 @@ int zmq::session_base_t::pull_msg (msg_t *msg_)
     }
 
     incomplete_in = msg_->flags () & msg_t::more ? true : false;
+    traffic += msg_->size () + rebalance_message_weight;
 
     return 0;
 }
 
 int zmq::session_base_t::push_msg (msg_t *msg_)
 {
+    size_t size = msg_->size ();
     if (pipe && pipe->write (msg_)) {
+        traffic += size + rebalance_message_weight;
         int rc = msg_->init ();
         errno_assert (rc == 0);
         return 0;
@@ -273,8 +281,58 @@ zmq::socket_base_t *zmq::session_base_t::get_socket ()
     return socket;
 }
 
+uint64_t zmq::session_base_t::fetch_traffic ()
+{
+    uint64_t result = traffic;
+    traffic = 0;
+    return result;
+}
+
+uint64_t zmq::session_base_t::get_affinity ()
+{
+    return options.affinity;
+}
+
+bool zmq::session_base_t::migrate (io_thread_t *io_thread_)
+{
+    //  Commands keep going to the thread the session was created in, which
+    //  forwards them. Moving the session once more would allow forwarded
+    //  commands to overtake each other.
+    if (get_current_tid () != get_tid ())
+        return false;
+
+    //  Don't move sessions that are being set up or torn down.
+    if (is_terminating () || !engine || !pipe || zap_pipe || pending ||
+          has_linger_timer || !terminating_pipes.empty ())
+        return false;
+
+    if (!engine->unplug_poller ())
+        return false;
+    io_object_t::unplug ();
+    io_thread->rm_session (this);
+
+    //  From now on, the commands for the session and its pipe are passed
+    //  on to the new thread.
+    io_thread = io_thread_;
+    set_current_tid (io_thread->get_tid ());
+    pipe->set_current_tid (io_thread->get_tid ());
+    send_migrate (this, io_thread);
+    return true;
+}
+
+void zmq::session_base_t::process_migrate (io_thread_t *io_thread_)
+{
+    zmq_assert (io_thread_ == io_thread);
+
+    io_object_t::plug (io_thread);
+    io_thread->add_session (this);
+    engine->plug_poller (io_thread);
+}
+
 void zmq::session_base_t::process_plug ()
 {
+    io_thread->add_session (this);
+
     if (active)
         start_connecting (false);
 }
@@ -300,7 +358,8 @@ int zmq::session_base_t::zap_connect ()
     pipe_t *new_pipes [2] = {NULL, NULL};
     int hwms [2] = {0, 0};
     bool conflates [2] = {false, false};
-    int rc = pipepair (parents, new_pipes, hwms, conflates);
+    int rc = pipepair (parents, new_pipes, hwms, conflates,
+        options.pipe_allocator);
     errno_assert (rc == 0);
 
     //  Attach local end of the pipe to this socket object.
@@ -344,7 +403,8 @@ void zmq::session_base_t::process_attach (i_engine *engine_)
         int hwms [2] = {conflate? -1 : options.rcvhwm,
             conflate? -1 : options.sndhwm};
         bool conflates [2] = {conflate, conflate};
-        int rc = pipepair (parents, pipes, hwms, conflates);
+        int rc = pipepair (parents, pipes, hwms, conflates,
+            options.pipe_allocator);
         errno_assert (rc == 0);
 
         //  Plug the local end of the pipe.
@@ -86,6 +86,21 @@ namespace zmq
 
         socket_base_t *get_socket ();
 
+        //  Returns the amount of data, in bytes, the session has passed
+        //  between its engine and its socket since the last call. Each
+        //  message counts rebalance_message_weight bytes on top of its
+        //  size.
+        uint64_t fetch_traffic ();
+
+        //  Returns the I/O threads the session may run in.
+        uint64_t get_affinity ();
+
+        //  Moves the session and its engine to another I/O thread. Only
+        //  sessions with a running engine and no pending work can be moved,
+        //  and only away from the thread they were created in. Returns
+        //  false if the session can't be moved.
+        bool migrate (zmq::io_thread_t *io_thread_);
+
     protected:
 
         session_base_t (zmq::io_thread_t *io_thread_, bool active_,
@@ -103,6 +118,7 @@ namespace zmq
         void process_plug ();
         void process_attach (zmq::i_engine *engine_);
         void process_term (int linger_);
+        void process_migrate (zmq::io_thread_t *io_thread_);
 
         //  i_poll_events handlers.
         void timer_event (int id_);
@@ -154,6 +170,9 @@ namespace zmq
         //  Protocol and address to use when connecting.
         const address_t *addr;
 
+        //  Amount of data passed since the I/O thread last asked.
+        uint64_t traffic;
+
         session_base_t (const session_base_t&);
         const session_base_t &operator = (const session_base_t&);
     };
@@ -50,6 +50,7 @@
 #include "platform.hpp"
 #include "likely.hpp"
 #include "msg.hpp"
+#include "socket_poller.hpp"
 #include "address.hpp"
 #include "ipc_address.hpp"
 #include "tcp_address.hpp"
@@ -136,6 +137,10 @@ zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_) :
     destroyed (false),
     last_tsc (0),
     ticks (0),
+    poll_rate (inbound_poll_rate),
+    command_delay (max_command_delay),
+    command_checks (0),
+    commands_processed (0),
     rcvmore (false),
     file_desc(-1),
     monitor_socket (NULL),
@@ -143,6 +148,10 @@ zmq::socket_base_t::socket_base_t (ctx_t *parent_, uint32_t tid_, int sid_) :
 {
     options.socket_id = sid_;
     options.ipv6 = (parent_->get (ZMQ_IPV6) != 0);
+    options.allocator = parent_->get_allocator ();
+    options.pipe_allocator = parent_->get_pipe_allocator ();
+    mailbox.set_spin_time (parent_->get (ZMQ_SPIN_TIME));
+    options.busy_poll = parent_->get (ZMQ_IO_BUSY_POLL);
 }
 
 zmq::socket_base_t::~socket_base_t ()
@@ -156,6 +165,11 @@ zmq::mailbox_t *zmq::socket_base_t::get_mailbox ()
     return &mailbox;
 }
 
+const zmq::allocator_t &zmq::socket_base_t::get_allocator ()
+{
+    return options.allocator;
+}
+
 void zmq::socket_base_t::stop ()
 {
     //  Called by ctx when it is terminated (zmq_term).
@@ -267,7 +281,14 @@ int zmq::socket_base_t::setsockopt (int option_, const void *optval_,
 
     //  If the socket type doesn't support the option, pass it to
     //  the generic option parser.
-    return options.setsockopt (option_, optval_, optvallen_);
+    rc = options.setsockopt (option_, optval_, optvallen_);
+
+    //  Command throttling starts over from the limits set.
+    if (rc == 0) {
+        poll_rate = options.inbound_poll_rate;
+        command_delay = options.max_command_delay;
+    }
+    return rc;
 }
 
 int zmq::socket_base_t::getsockopt (int option_, void *optval_,
@@ -316,6 +337,41 @@ int zmq::socket_base_t::getsockopt (int option_, void *optval_,
         return 0;
     }
 
+    if (option_ == ZMQ_COMMAND_CHECKS || option_ == ZMQ_COMMANDS_PROCESSED) {
+        if (*optvallen_ != sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((uint64_t*) optval_) = option_ == ZMQ_COMMAND_CHECKS ?
+            command_checks : commands_processed;
+        return 0;
+    }
+
+    if (option_ == ZMQ_WRITE_CALLS || option_ == ZMQ_WRITE_MSGS ||
+          option_ == ZMQ_WRITE_COPIED) {
+        if (*optvallen_ != sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (option_ == ZMQ_WRITE_CALLS)
+            *((uint64_t*) optval_) = write_calls.get ();
+        else
+        if (option_ == ZMQ_WRITE_MSGS)
+            *((uint64_t*) optval_) = write_msgs.get ();
+        else
+            *((uint64_t*) optval_) = write_copied.get ();
+        return 0;
+    }
+
+    if (option_ == ZMQ_READ_YIELDS) {
+        if (*optvallen_ != sizeof (uint64_t)) {
+            errno = EINVAL;
+            return -1;
+        }
+        *((uint64_t*) optval_) = read_yields.get ();
+        return 0;
+    }
+
     if (option_ == ZMQ_LAST_ENDPOINT) {
         if (*optvallen_ < last_endpoint.size () + 1) {
             errno = EINVAL;
@@ -377,20 +433,62 @@ int zmq::socket_base_t::bind (const char *addr_)
     }
 
     if (protocol == "tcp") {
-        tcp_listener_t *listener = new (std::nothrow) tcp_listener_t (
-            io_thread, this, options);
-        alloc_assert (listener);
-        int rc = listener->set_address (address.c_str ());
-        if (rc != 0) {
-            delete listener;
-            event_bind_failed (address, zmq_errno());
-            return -1;
-        }
+        //  A sharded endpoint gets a listener in each of several I/O
+        //  threads, all bound to the same port, so that the system spreads
+        //  the incoming connections, and accepting them, across threads.
+        std::vector <io_thread_t*> io_threads;
+        if (options.listener_shards != 1 && tcp_listener_t::can_shard ())
+            choose_io_threads (options.affinity, options.listener_shards,
+                io_threads);
+        else
+            io_threads.push_back (io_thread);
+
+        std::vector <tcp_listener_t*> listeners;
+        std::string shard_address = address;
+        for (size_t i = 0; i != io_threads.size (); i++) {
+            tcp_listener_t *listener = new (std::nothrow) tcp_listener_t (
+                io_threads [i], this, options);
+            alloc_assert (listener);
+            int rc = listener->set_address (shard_address.c_str (),
+                io_threads.size () > 1);
+
+            //  The system may refuse to share the port after all, in which
+            //  case a single listener gets all the connections.
+            if (rc != 0 && errno == ENOPROTOOPT && i == 0 &&
+                  io_threads.size () > 1) {
+                io_threads.resize (1);
+                rc = listener->set_address (shard_address.c_str (), false);
+            }
 
-        // Save last endpoint URI
-        listener->get_address (last_endpoint);
+            //  The system lets any listener sharing the port bind to it,
+            //  so the endpoints of this context at least are kept apart.
+            if (rc == 0 && io_threads.size () > 1)
+                rc = listener->share_port (i == 0);
+            if (rc != 0) {
+                int err = errno;
+                delete listener;
+                for (size_t j = 0; j != listeners.size (); j++)
+                    delete listeners [j];
+                errno = err;
+                event_bind_failed (address, zmq_errno());
+                return -1;
+            }
+            listeners.push_back (listener);
 
-        add_endpoint (addr_, (own_t *) listener, NULL);
+            if (i == 0) {
+                // Save last endpoint URI
+                listener->get_address (last_endpoint);
+
+                //  The other shards bind to the port the first one got,
+                //  which may have been chosen by the system.
+                if (io_threads.size () > 1)
+                    shard_address = last_endpoint.substr (
+                        protocol.size () + 3);
+            }
+        }
+
+        for (size_t i = 0; i != listeners.size (); i++)
+            add_endpoint (addr_, (own_t *) listeners [i], NULL);
         return 0;
     }
 
@@ -495,7 +593,8 @@ int zmq::socket_base_t::connect (const char *addr_)
 
         int hwms [2] = {conflate? -1 : sndhwm, conflate? -1 : rcvhwm};
         bool conflates [2] = {conflate, conflate};
-        int rc = pipepair (parents, new_pipes, hwms, conflates);
+        int rc = pipepair (parents, new_pipes, hwms, conflates,
+            options.pipe_allocator);
         errno_assert (rc == 0);
 
         //  Attach local end of the pipe to this socket object.
@@ -655,7 +754,8 @@ int zmq::socket_base_t::connect (const char *addr_)
         int hwms [2] = {conflate? -1 : options.sndhwm,
             conflate? -1 : options.rcvhwm};
         bool conflates [2] = {conflate, conflate};
-        rc = pipepair (parents, new_pipes, hwms, conflates);
+        rc = pipepair (parents, new_pipes, hwms, conflates,
+            options.pipe_allocator);
         errno_assert (rc == 0);
 
         //  Attach local end of the pipe to the socket object.
@@ -756,6 +856,10 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
         return -1;
     }
 
+    //  The socket may be writable or readable by the time send returns.
+    if (unlikely (!socket_pollers.empty ()))
+        notify_pollers ();
+
     //  Process pending commands, if any.
     int rc = process_commands (0, true);
     if (unlikely (rc != 0))
@@ -807,6 +911,68 @@ int zmq::socket_base_t::send (msg_t *msg_, int flags_)
     return 0;
 }
 
+int zmq::socket_base_t::sendmmsg (msg_t *msgs_, int count_, int flags_)
+{
+    if (unlikely (count_ <= 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  Check whether messages passed to the function are valid.
+    for (int i = 0; i != count_; i++)
+        if (unlikely (!msgs_ [i].check ())) {
+            errno = EFAULT;
+            return -1;
+        }
+
+    //  The messages are written to the pipes as usual, but the pipes are
+    //  flushed only once the whole batch is written.
+    hold_flushes ();
+
+    int nsent = 0;
+    while (nsent != count_) {
+
+        //  With ZMQ_SNDMORE the batch forms a single multi-part message.
+        int flags = flags_ & ZMQ_DONTWAIT;
+        if (flags_ & ZMQ_SNDMORE && nsent != count_ - 1)
+            flags |= ZMQ_SNDMORE;
+
+        int rc = send (&msgs_ [nsent], flags | ZMQ_DONTWAIT);
+        if (rc != 0) {
+            if (errno != EAGAIN || flags_ & ZMQ_DONTWAIT ||
+                  options.sndtimeo == 0)
+                break;
+
+            //  The pipes are full. Let the peers have what was written so
+            //  far, otherwise they would never make room for the rest.
+            release_flushes ();
+            rc = send (&msgs_ [nsent], flags);
+            hold_flushes ();
+            if (rc != 0)
+                break;
+        }
+        nsent++;
+    }
+
+    const int err = errno;
+    release_flushes ();
+    errno = err;
+
+    return nsent ? nsent : -1;
+}
+
+void zmq::socket_base_t::hold_flushes ()
+{
+    for (pipes_t::size_type i = 0; i != pipes.size (); i++)
+        pipes [i]->hold_flush ();
+}
+
+void zmq::socket_base_t::release_flushes ()
+{
+    for (pipes_t::size_type i = 0; i != pipes.size (); i++)
+        pipes [i]->release_flush ();
+}
+
 int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
 {
     //  Check whether the library haven't been shut down yet.
@@ -821,6 +987,10 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
         return -1;
     }
 
+    //  The socket may be writable or readable by the time recv returns.
+    if (unlikely (!socket_pollers.empty ()))
+        notify_pollers ();
+
     //  Once every inbound_poll_rate messages check for signals and process
     //  incoming commands. This happens only if we are not polling altogether
     //  because there are messages available all the time. If poll occurs,
@@ -829,7 +999,7 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
     //  Note that 'recv' uses different command throttling algorithm (the one
     //  described above) from the one used by 'send'. This is because counting
     //  ticks is more efficient than doing RDTSC all the time.
-    if (++ticks == inbound_poll_rate) {
+    if (++ticks >= poll_rate) {
         if (unlikely (process_commands (0, false) != 0))
             return -1;
         ticks = 0;
@@ -900,8 +1070,49 @@ int zmq::socket_base_t::recv (msg_t *msg_, int flags_)
     return 0;
 }
 
+int zmq::socket_base_t::recvmmsg (msg_t *msgs_, int count_, int flags_)
+{
+    if (unlikely (count_ <= 0)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    //  Check whether messages passed to the function are valid. The first
+    //  one is checked by recv.
+    for (int i = 1; i != count_; i++)
+        if (unlikely (!msgs_ [i].check ())) {
+            errno = EFAULT;
+            return -1;
+        }
+
+    //  The first message is received the usual way, waiting for it
+    //  if needed.
+    int rc = recv (msgs_, flags_);
+    if (unlikely (rc != 0))
+        return -1;
+
+    //  Whatever else is already available in the pipes is received without
+    //  blocking. The messages count towards the inbound_poll_rate as if
+    //  they were received one by one.
+    int nread = 1;
+    if (count_ > 1) {
+        nread += xrecvmmsg (msgs_ + 1, count_ - 1);
+        ticks += nread - 1;
+        if (file_desc >= 0)
+            for (int i = 1; i != nread; i++)
+                msgs_ [i].set_fd (file_desc);
+        extract_flags (&msgs_ [nread - 1]);
+    }
+
+    return nread;
+}
+
 int zmq::socket_base_t::close ()
 {
+    //  Unregister from the pollers, the socket can't be polled any more.
+    while (!socket_pollers.empty ())
+        socket_pollers.back ()->socket_closed (this);
+
     //  Mark the socket as dead
     tag = 0xdeadbeef;
     
@@ -964,18 +1175,25 @@ int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
             //  Check whether TSC haven't jumped backwards (in case of migration
             //  between CPU cores) and whether certain time have elapsed since
             //  last command processing. If it didn't do nothing.
-            if (tsc >= last_tsc && tsc - last_tsc <= max_command_delay)
+            if (tsc >= last_tsc && tsc - last_tsc <= command_delay)
                 return 0;
             last_tsc = tsc;
         }
 
         //  Check whether there are any commands pending for this thread.
         rc = mailbox.recv (&cmd, 0);
+        if (options.adaptive_throttle)
+            adapt_throttle (rc == 0);
     }
+    command_checks++;
 
-    //  Process all available commands.
+    //  Process all available commands. They may make the socket ready
+    //  with no further signal to the pollers watching its mailbox.
+    if (rc == 0 && unlikely (!socket_pollers.empty ()))
+        notify_pollers ();
     while (rc == 0) {
         cmd.destination->process_command (cmd);
+        commands_processed++;
         rc = mailbox.recv (&cmd, 0);
     }
 
@@ -992,6 +1210,44 @@ int zmq::socket_base_t::process_commands (int timeout_, bool throttle_)
     return 0;
 }
 
+void zmq::socket_base_t::add_poller (socket_poller_t *poller_)
+{
+    socket_pollers.push_back (poller_);
+}
+
+void zmq::socket_base_t::rm_poller (socket_poller_t *poller_)
+{
+    socket_pollers_t::iterator it = std::find (socket_pollers.begin (),
+        socket_pollers.end (), poller_);
+    zmq_assert (it != socket_pollers.end ());
+    socket_pollers.erase (it);
+}
+
+void zmq::socket_base_t::notify_pollers ()
+{
+    for (socket_pollers_t::iterator it = socket_pollers.begin ();
+          it != socket_pollers.end (); ++it)
+        (*it)->socket_changed (this);
+}
+
+void zmq::socket_base_t::adapt_throttle (bool found_)
+{
+    //  While commands keep coming, e.g. the peers signalling that there's
+    //  room in the pipes again, check twice as often. When they stop,
+    //  back off to the limits set.
+    if (found_) {
+        poll_rate = poll_rate > 1 ? poll_rate / 2 : 1;
+        command_delay = command_delay > 1 ? command_delay / 2 : 1;
+    }
+    else {
+        const uint64_t max_delay = options.max_command_delay;
+        poll_rate = poll_rate < options.inbound_poll_rate / 2 ?
+            poll_rate * 2 : options.inbound_poll_rate;
+        command_delay = command_delay < max_delay / 2 ?
+            command_delay * 2 : max_delay;
+    }
+}
+
 void zmq::socket_base_t::process_stop ()
 {
     //  Here, someone have called zmq_term while the socket was still alive.
@@ -1056,6 +1312,22 @@ int zmq::socket_base_t::xrecv (msg_t *)
     return -1;
 }
 
+int zmq::socket_base_t::xrecvmmsg (msg_t *msgs_, int count_)
+{
+    int nread = 0;
+    while (nread != count_ && xrecv (msgs_ + nread) == 0)
+        nread++;
+
+    //  Empty the messages that were not filled in.
+    for (int i = nread; i != count_; i++) {
+        int rc = msgs_ [i].close ();
+        errno_assert (rc == 0);
+        rc = msgs_ [i].init ();
+        errno_assert (rc == 0);
+    }
+    return nread;
+}
+
 zmq::blob_t zmq::socket_base_t::get_credential () const
 {
     return blob_t ();
@@ -1323,6 +1595,21 @@ void zmq::socket_base_t::event_disconnected (std::string &addr_, int fd_)
     }
 }
 
+void zmq::socket_base_t::account_writes (uint64_t calls_, uint64_t msgs_,
+    uint64_t copied_)
+{
+    write_calls.add (calls_);
+    if (msgs_)
+        write_msgs.add (msgs_);
+    if (copied_)
+        write_copied.add (copied_);
+}
+
+void zmq::socket_base_t::account_read_yield ()
+{
+    read_yields.add (1);
+}
+
 void zmq::socket_base_t::monitor_event (zmq_event_t event_, const std::string& addr_)
 {
     if (monitor_socket) {
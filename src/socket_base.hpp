@@ -22,6 +22,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 #include <stdarg.h>
 
 #include "own.hpp"
@@ -32,6 +33,7 @@
 #include "atomic_counter.hpp"
 #include "i_poll_events.hpp"
 #include "mailbox.hpp"
+#include "mutex.hpp"
 #include "stdint.hpp"
 #include "clock.hpp"
 #include "pipe.hpp"
@@ -47,6 +49,7 @@ namespace zmq
     class ctx_t;
     class msg_t;
     class pipe_t;
+    class socket_poller_t;
 
     class socket_base_t :
         public own_t,
@@ -68,6 +71,10 @@ namespace zmq
         //  Returns the mailbox associated with this socket.
         mailbox_t *get_mailbox ();
 
+        //  Returns the allocator for the bodies of the messages created
+        //  on behalf of this socket.
+        const allocator_t &get_allocator ();
+
         //  Interrupt blocking call if the socket is stuck in one.
         //  This function can be called from a different thread!
         void stop ();
@@ -79,7 +86,9 @@ namespace zmq
         int connect (const char *addr_);
         int term_endpoint (const char *addr_);
         int send (zmq::msg_t *msg_, int flags_);
+        int sendmmsg (zmq::msg_t *msgs_, int count_, int flags_);
         int recv (zmq::msg_t *msg_, int flags_);
+        int recvmmsg (zmq::msg_t *msgs_, int count_, int flags_);
         int close ();
 
         //  These functions are used by the polling mechanism to determine
@@ -107,6 +116,10 @@ namespace zmq
 
         int monitor (const char *endpoint_, int events_);
 
+        //  Registration with the persistent pollers the socket is added to.
+        void add_poller (socket_poller_t *poller_);
+        void rm_poller (socket_poller_t *poller_);
+
         void set_fd(fd_t fd_);
         fd_t fd();
 
@@ -121,6 +134,16 @@ namespace zmq
         void event_close_failed (std::string &addr_, int fd_);  
         void event_disconnected (std::string &addr_, int fd_); 
 
+        //  Called by the engines, from the I/O threads, to account for
+        //  calls_ writes to the network carrying msgs_ message parts, for
+        //  which copied_ bytes were copied to the engines' buffers.
+        void account_writes (uint64_t calls_, uint64_t msgs_,
+            uint64_t copied_);
+
+        //  Called by the engines, from the I/O threads, when they stop
+        //  reading with data left because the read budget is used up.
+        void account_read_yield ();
+
     protected:
 
         socket_base_t (zmq::ctx_t *parent_, uint32_t tid_, int sid_);
@@ -145,6 +168,11 @@ namespace zmq
         virtual bool xhas_in ();
         virtual int xrecv (zmq::msg_t *msg_);
 
+        //  Receives up to count_ messages without blocking and returns
+        //  the number of messages received. The default implementation
+        //  invokes xrecv repeatedly.
+        virtual int xrecvmmsg (zmq::msg_t *msgs_, int count_);
+
         //  Returns the credential for the peer from which we have received
         //  the last message. If no message has been received yet,
         //  the function returns empty credential.
@@ -217,6 +245,10 @@ namespace zmq
         //  in a predefined time period.
         int process_commands (int timeout_, bool throttle_);
 
+        //  Hold back and release the flushes of all the attached pipes.
+        void hold_flushes ();
+        void release_flushes ();
+
         //  Handlers for incoming commands.
         void process_stop ();
         void process_bind (zmq::pipe_t *pipe_);
@@ -239,6 +271,30 @@ namespace zmq
         //  Number of messages received since last command processing.
         int ticks;
 
+        //  Current number of messages received, and of CPU ticks spent
+        //  sending, between two checks for commands. Fixed to the limits
+        //  set in the options unless the throttling is adaptive.
+        int poll_rate;
+        uint64_t command_delay;
+
+        //  Adapts the intervals above after a check for commands that
+        //  found some or not.
+        void adapt_throttle (bool found_);
+
+        //  Number of checks for commands and of commands processed.
+        uint64_t command_checks;
+        uint64_t commands_processed;
+
+        //  Number of writes the engines did, of message parts they wrote
+        //  and of bytes they copied to do so. The engines run in other
+        //  threads, hence the atomics.
+        atomic_counter64_t write_calls;
+        atomic_counter64_t write_msgs;
+        atomic_counter64_t write_copied;
+
+        //  Number of times the engines yielded to other connections.
+        atomic_counter64_t read_yields;
+
         //  True if the last message received had MORE flag set.
         bool rcvmore;
 
@@ -257,6 +313,12 @@ namespace zmq
         // Last socket endpoint resolved URI
         std::string last_endpoint;
 
+        //  Persistent pollers the socket is registered with. They are told
+        //  whenever the socket may have become ready.
+        typedef std::vector <socket_poller_t*> socket_pollers_t;
+        socket_pollers_t socket_pollers;
+        void notify_pollers ();
+
         socket_base_t (const socket_base_t&);
         const socket_base_t &operator = (const socket_base_t&);
         mutex_t sync;
@@ -0,0 +1,481 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "socket_poller.hpp"
+
+#include <algorithm>
+#include <new>
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+#include <unistd.h>
+#endif
+
+#include "socket_base.hpp"
+#include "clock.hpp"
+#include "err.hpp"
+
+zmq::socket_poller_t::socket_poller_t () :
+    tag (0xCAFEF00D),
+    close_events (NULL)
+{
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    iteration = 0;
+    epoll_fd = epoll_create (1);
+    errno_assert (epoll_fd != -1);
+#endif
+}
+
+zmq::socket_poller_t::~socket_poller_t ()
+{
+    //  Mark the poller as dead.
+    tag = 0xdeadbeef;
+
+    for (sockets_t::iterator it = sockets.begin (); it != sockets.end ();
+          ++it) {
+        it->first->rm_poller (this);
+        delete it->second;
+    }
+    for (fds_t::iterator it = fds.begin (); it != fds.end (); ++it)
+        delete it->second;
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    close (epoll_fd);
+#endif
+}
+
+bool zmq::socket_poller_t::check_tag ()
+{
+    return tag == 0xCAFEF00D;
+}
+
+int zmq::socket_poller_t::add (socket_base_t *socket_, void *user_data_,
+    short events_)
+{
+    if (sockets.find (socket_) != sockets.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    fd_t fd;
+    size_t fd_size = sizeof fd;
+    int rc = socket_->getsockopt (ZMQ_FD, &fd, &fd_size);
+    if (rc == -1)
+        return -1;
+
+    item_t *item = new (std::nothrow) item_t;
+    alloc_assert (item);
+    item->socket = socket_;
+    item->fd = fd;
+    item->user_data = user_data_;
+    item->events = events_;
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    //  The mailbox signals whenever commands arrive, which is the only way
+    //  for a socket to become ready on its own. The events are then
+    //  found out by checking the socket.
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = item;
+    rc = epoll_ctl (epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    if (rc == -1) {
+        delete item;
+        return -1;
+    }
+    item->hot = false;
+    item->reported = 0;
+
+    //  The socket may already be ready.
+    set_hot (item);
+#else
+    zmq_pollitem_t pollitem = {socket_, 0, events_, 0};
+    pollitems.push_back (pollitem);
+    pollitem_owners.push_back (item);
+#endif
+
+    sockets.insert (sockets_t::value_type (socket_, item));
+    socket_->add_poller (this);
+    return 0;
+}
+
+int zmq::socket_poller_t::modify (socket_base_t *socket_, short events_)
+{
+    sockets_t::iterator it = sockets.find (socket_);
+    if (it == sockets.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    item_t *item = it->second;
+    item->events = events_;
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    set_hot (item);
+#else
+    for (size_t i = 0; i != pollitem_owners.size (); i++)
+        if (pollitem_owners [i] == item)
+            pollitems [i].events = events_;
+#endif
+    return 0;
+}
+
+int zmq::socket_poller_t::remove (socket_base_t *socket_)
+{
+    sockets_t::iterator it = sockets.find (socket_);
+    if (it == sockets.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    item_t *item = it->second;
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_DEL, item->fd, NULL);
+    errno_assert (rc == 0);
+    if (item->hot)
+        hot.erase (std::find (hot.begin (), hot.end (), item));
+#else
+    remove_pollitem (item);
+#endif
+
+    sockets.erase (it);
+    socket_->rm_poller (this);
+    delete item;
+    return 0;
+}
+
+int zmq::socket_poller_t::add_fd (fd_t fd_, void *user_data_, short events_)
+{
+    if (fds.find (fd_) != fds.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    item_t *item = new (std::nothrow) item_t;
+    alloc_assert (item);
+    item->socket = NULL;
+    item->fd = fd_;
+    item->user_data = user_data_;
+    item->events = events_;
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    epoll_event ev;
+    ev.events = epoll_events (events_);
+    ev.data.ptr = item;
+    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_ADD, fd_, &ev);
+    if (rc == -1) {
+        delete item;
+        return -1;
+    }
+    item->hot = false;
+    item->reported = 0;
+#else
+    zmq_pollitem_t pollitem = {NULL, fd_, events_, 0};
+    pollitems.push_back (pollitem);
+    pollitem_owners.push_back (item);
+#endif
+
+    fds.insert (fds_t::value_type (fd_, item));
+    return 0;
+}
+
+int zmq::socket_poller_t::modify_fd (fd_t fd_, short events_)
+{
+    fds_t::iterator it = fds.find (fd_);
+    if (it == fds.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    item_t *item = it->second;
+    item->events = events_;
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    epoll_event ev;
+    ev.events = epoll_events (events_);
+    ev.data.ptr = item;
+    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_MOD, fd_, &ev);
+    errno_assert (rc == 0);
+#else
+    for (size_t i = 0; i != pollitem_owners.size (); i++)
+        if (pollitem_owners [i] == item)
+            pollitems [i].events = events_;
+#endif
+    return 0;
+}
+
+int zmq::socket_poller_t::remove_fd (fd_t fd_)
+{
+    fds_t::iterator it = fds.find (fd_);
+    if (it == fds.end ()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    item_t *item = it->second;
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+    //  The file descriptor may have been closed already, in which case
+    //  the kernel dropped it from the set by itself.
+    int rc = epoll_ctl (epoll_fd, EPOLL_CTL_DEL, fd_, NULL);
+    errno_assert (rc == 0 || errno == EBADF);
+#else
+    remove_pollitem (item);
+#endif
+
+    fds.erase (it);
+    delete item;
+    return 0;
+}
+
+void zmq::socket_poller_t::socket_closed (socket_base_t *socket_)
+{
+    int rc = remove (socket_);
+    errno_assert (rc == 0);
+    if (close_events)
+        close_events->socket_closed (socket_);
+}
+
+void zmq::socket_poller_t::set_close_events (i_socket_close_events *sink_)
+{
+    close_events = sink_;
+}
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+
+void zmq::socket_poller_t::socket_changed (socket_base_t *socket_)
+{
+    sockets_t::iterator it = sockets.find (socket_);
+    zmq_assert (it != sockets.end ());
+    set_hot (it->second);
+}
+
+void zmq::socket_poller_t::set_hot (item_t *item_)
+{
+    if (!item_->hot) {
+        item_->hot = true;
+        hot.push_back (item_);
+    }
+}
+
+int zmq::socket_poller_t::check_socket (item_t *item_,
+    zmq_poller_event_t *events_, int n_events_, int &found_)
+{
+    if (item_->reported == iteration)
+        return 0;
+
+    int events;
+    size_t events_size = sizeof events;
+    int rc = item_->socket->getsockopt (ZMQ_EVENTS, &events, &events_size);
+    if (rc == -1)
+        return -1;
+    events &= item_->events;
+    if (!events)
+        return 0;
+
+    //  A ready socket stays hot until it's found not to be ready, as it
+    //  may not signal again.
+    set_hot (item_);
+    if (found_ == n_events_)
+        return 0;
+
+    zmq_poller_event_t &event = events_ [found_++];
+    event.socket = item_->socket;
+    event.fd = item_->fd;
+    event.user_data = item_->user_data;
+    event.events = (short) events;
+    item_->reported = iteration;
+    return 0;
+}
+
+uint32_t zmq::socket_poller_t::epoll_events (short events_)
+{
+    uint32_t events = 0;
+    if (events_ & ZMQ_POLLIN)
+        events |= EPOLLIN;
+    if (events_ & ZMQ_POLLOUT)
+        events |= EPOLLOUT;
+    return events;
+}
+
+short zmq::socket_poller_t::poll_events (uint32_t events_)
+{
+    short events = 0;
+    if (events_ & EPOLLIN)
+        events |= ZMQ_POLLIN;
+    if (events_ & EPOLLOUT)
+        events |= ZMQ_POLLOUT;
+    if (events_ & ~(EPOLLIN | EPOLLOUT))
+        events |= ZMQ_POLLERR;
+    return events;
+}
+
+int zmq::socket_poller_t::wait (zmq_poller_event_t *events_, int n_events_,
+    long timeout_)
+{
+    if (n_events_ < 1 || !events_) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    zmq::clock_t clock;
+    uint64_t now = 0;
+    uint64_t end = 0;
+    bool first_pass = true;
+
+    while (true) {
+
+        iteration++;
+        int found = 0;
+
+        //  Check the sockets that may be ready without having signalled.
+        //  Checking a socket processes its commands, which puts it back
+        //  into the list, so work on a copy.
+        checked.swap (hot);
+        for (items_t::iterator it = checked.begin (); it != checked.end ();
+              ++it)
+            (*it)->hot = false;
+        for (items_t::size_type i = 0; i != checked.size (); i++) {
+            if (check_socket (checked [i], events_, n_events_, found) != 0) {
+                for (; i != checked.size (); i++)
+                    set_hot (checked [i]);
+                checked.clear ();
+                return -1;
+            }
+        }
+        checked.clear ();
+
+        //  Compute the timeout for the wait. If there are events to return
+        //  already, just collect the others that are there.
+        int timeout;
+        if (found || timeout_ == 0)
+            timeout = 0;
+        else
+        if (timeout_ < 0)
+            timeout = -1;
+        else
+        if (first_pass)
+            timeout = (int) timeout_;
+        else
+            timeout = (int) (end - now);
+
+        int n = epoll_wait (epoll_fd, &ev_buf [0], max_io_events, timeout);
+        if (n == -1 && errno == EINTR)
+            return -1;
+        errno_assert (n >= 0);
+
+        for (int i = 0; i != n; i++) {
+            item_t *item = (item_t*) ev_buf [i].data.ptr;
+            if (item->socket) {
+                //  Sockets that can't be reported in this call are left to
+                //  the next one.
+                if (found == n_events_)
+                    set_hot (item);
+                else
+                if (check_socket (item, events_, n_events_, found) != 0)
+                    return -1;
+                continue;
+            }
+            short events = poll_events (ev_buf [i].events);
+            if (events && found != n_events_) {
+                zmq_poller_event_t &event = events_ [found++];
+                event.socket = NULL;
+                event.fd = item->fd;
+                event.user_data = item->user_data;
+                event.events = events;
+            }
+        }
+
+        if (found)
+            return found;
+
+        //  If timeout is zero, exit immediately whether there are events
+        //  or not.
+        if (timeout_ == 0)
+            break;
+
+        //  Wake-up without any events means a spurious signal or that
+        //  the commands processed didn't make any socket ready.
+        if (timeout_ < 0)
+            continue;
+
+        //  At this point we are meant to wait for events but there are
+        //  none. If timeout is infinite we can just loop until we get some
+        //  events, otherwise we have to keep track of time.
+        if (first_pass) {
+            now = clock.now_ms ();
+            end = now + timeout_;
+            if (now == end)
+                break;
+            first_pass = false;
+            continue;
+        }
+        now = clock.now_ms ();
+        if (now >= end)
+            break;
+    }
+
+    errno = EAGAIN;
+    return -1;
+}
+
+#else
+
+void zmq::socket_poller_t::socket_changed (socket_base_t *)
+{
+    //  zmq_poll checks all the sockets anyway.
+}
+
+void zmq::socket_poller_t::remove_pollitem (item_t *item_)
+{
+    for (size_t i = 0; i != pollitem_owners.size (); i++)
+        if (pollitem_owners [i] == item_) {
+            pollitems.erase (pollitems.begin () + i);
+            pollitem_owners.erase (pollitem_owners.begin () + i);
+            return;
+        }
+    zmq_assert (false);
+}
+
+int zmq::socket_poller_t::wait (zmq_poller_event_t *events_, int n_events_,
+    long timeout_)
+{
+    if (n_events_ < 1 || !events_) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int rc = zmq_poll (pollitems.empty () ? NULL : &pollitems [0],
+        (int) pollitems.size (), timeout_);
+    if (rc == -1)
+        return -1;
+    if (rc == 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    int found = 0;
+    for (size_t i = 0; i != pollitems.size () && found != n_events_; i++) {
+        if (!pollitems [i].revents)
+            continue;
+        zmq_poller_event_t &event = events_ [found++];
+        event.socket = pollitems [i].socket;
+        event.fd = pollitem_owners [i]->fd;
+        event.user_data = pollitem_owners [i]->user_data;
+        event.events = pollitems [i].revents;
+    }
+    return found;
+}
+
+#endif
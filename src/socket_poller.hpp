@@ -0,0 +1,180 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_SOCKET_POLLER_HPP_INCLUDED__
+#define __ZMQ_SOCKET_POLLER_HPP_INCLUDED__
+
+#include "platform.hpp"
+
+//  On Linux the poller keeps its file descriptors registered with an epoll
+//  instance, so that waiting costs in proportion to the number of items
+//  that are ready. Elsewhere it falls back to zmq_poll over a persistent
+//  array of poll items.
+#if defined ZMQ_HAVE_LINUX
+#define ZMQ_SOCKET_POLLER_USE_EPOLL
+#endif
+
+#include <map>
+#include <vector>
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include "../include/zmq.h"
+
+#include "fd.hpp"
+#include "stdint.hpp"
+#include "config.hpp"
+
+namespace zmq
+{
+
+    class socket_base_t;
+
+    //  Interface to be implemented by the owners of socket pollers that
+    //  need to know when a socket they poll is closed.
+
+    struct i_socket_close_events
+    {
+        virtual ~i_socket_close_events () {}
+
+        //  Called once the socket was removed from the poller.
+        virtual void socket_closed (socket_base_t *socket_) = 0;
+    };
+
+    //  Set of sockets and file descriptors that stays registered across
+    //  waits. Sockets are not thread safe, and neither is this: it must be
+    //  used by the thread using the sockets registered with it.
+
+    class socket_poller_t
+    {
+    public:
+
+        socket_poller_t ();
+        ~socket_poller_t ();
+
+        //  Returns false if object is not a poller.
+        bool check_tag ();
+
+        //  Interface for the API layer. Registering an item twice and
+        //  modifying or removing an item that's not registered fail
+        //  with EINVAL.
+        int add (socket_base_t *socket_, void *user_data_, short events_);
+        int modify (socket_base_t *socket_, short events_);
+        int remove (socket_base_t *socket_);
+        int add_fd (fd_t fd_, void *user_data_, short events_);
+        int modify_fd (fd_t fd_, short events_);
+        int remove_fd (fd_t fd_);
+
+        //  Waits for up to timeout_ milliseconds (-1 meaning forever) until
+        //  some of the items are ready, and fills in up to n_events_ events
+        //  for them. Returns the number of events, or -1 with errno set to
+        //  EAGAIN if the timeout expired.
+        int wait (zmq_poller_event_t *events_, int n_events_, long timeout_);
+
+        //  Called by the socket when its state may have changed without its
+        //  file descriptor signalling: it processed commands, or it's used
+        //  to send or receive messages.
+        void socket_changed (socket_base_t *socket_);
+
+        //  Called by the socket when it's closed. The socket is removed
+        //  and the sink set by set_close_events, if any, is notified.
+        void socket_closed (socket_base_t *socket_);
+        void set_close_events (i_socket_close_events *sink_);
+
+    private:
+
+        struct item_t
+        {
+            //  The socket, or NULL for a plain file descriptor.
+            socket_base_t *socket;
+            fd_t fd;
+            void *user_data;
+            short events;
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+            //  True if the item is in the list of sockets to check.
+            bool hot;
+            //  Number of the last wait iteration that reported the item.
+            uint64_t reported;
+#endif
+        };
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+        //  Adds the item to the list of sockets to be checked by the next
+        //  wait.
+        void set_hot (item_t *item_);
+
+        //  Checks the events of the socket item_ and appends an event to
+        //  events_ if it's ready and there's room. Returns -1 if the
+        //  socket can't be checked.
+        int check_socket (item_t *item_, zmq_poller_event_t *events_,
+            int n_events_, int &found_);
+
+        //  Converts ZMQ_POLL* flags to epoll events and vice versa.
+        static uint32_t epoll_events (short events_);
+        static short poll_events (uint32_t events_);
+#endif
+
+        //  Used to check whether the object is a poller.
+        uint32_t tag;
+
+        //  Notified of the sockets closed, or NULL.
+        i_socket_close_events *close_events;
+
+        //  Registered items.
+        typedef std::map <socket_base_t*, item_t*> sockets_t;
+        sockets_t sockets;
+        typedef std::map <fd_t, item_t*> fds_t;
+        fds_t fds;
+
+#if defined ZMQ_SOCKET_POLLER_USE_EPOLL
+        //  The epoll instance all the file descriptors are registered with.
+        //  For sockets, it's the file descriptor of their mailbox.
+        fd_t epoll_fd;
+
+        //  Sockets that may be ready although their file descriptor didn't
+        //  signal: those found ready by the last wait, just registered or
+        //  that processed commands since.
+        typedef std::vector <item_t*> items_t;
+        items_t hot;
+
+        //  Hot sockets being checked by the current wait.
+        items_t checked;
+
+        //  Number of the current wait iteration.
+        uint64_t iteration;
+
+        epoll_event ev_buf [max_io_events];
+#else
+        //  Poll items passed to zmq_poll, and the items they stand for.
+        std::vector <zmq_pollitem_t> pollitems;
+        std::vector <item_t*> pollitem_owners;
+
+        //  Removes the poll item of item_.
+        void remove_pollitem (item_t *item_);
+#endif
+
+        socket_poller_t (const socket_poller_t&);
+        const socket_poller_t &operator = (const socket_poller_t&);
+    };
+
+}
+
+#endif
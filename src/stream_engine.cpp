@@ -33,6 +33,7 @@
 #include <string.h>
 #include <new>
 #include <sstream>
+#include <algorithm>
 
 #include "stream_engine.hpp"
 #include "io_thread.hpp"
@@ -62,6 +63,35 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
     outpos (NULL),
     outsize (0),
     encoder (NULL),
+    in_batch (initial_batch (options_.in_batch_size,
+        options_.adaptive_batch)),
+    in_batch_next (in_batch),
+    out_batch (initial_batch (options_.out_batch_size,
+        options_.adaptive_batch)),
+    out_batch_next (out_batch),
+    in_full (0),
+    in_small (0),
+    out_full (0),
+    out_small (0),
+    out_bufptr (NULL),
+    out_buffered (0),
+    out_batch_full (false),
+    out_batch_msgs (0),
+    out_held (false),
+    has_coalesce_timer (false),
+    coalesce_expired (false),
+#if defined ZMQ_HAVE_UIO
+    outiov_count (0),
+    outiov_pos (0),
+    out_msgs_count (0),
+    out_msgs_released (0),
+#endif
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    zerocopy (false),
+    zc_pinned_iov (-1),
+    zc_seq (0),
+    io_thread (NULL),
+#endif
     handshaking (true),
     greeting_size (v2_greeting_size),
     greeting_bytes_read (0),
@@ -80,10 +110,26 @@ zmq::stream_engine_t::stream_engine_t (fd_t fd_, const options_t &options_,
 {
     int rc = tx_msg.init ();
     errno_assert (rc == 0);
+#if defined ZMQ_HAVE_UIO
+    for (int i = 0; i != out_iov_max; i++) {
+        rc = out_msgs [i].init ();
+        errno_assert (rc == 0);
+    }
+#endif
     
     //  Put the socket into non-blocking mode.
     unblock_socket (s);
 
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Zero-copy sends have to be enabled on the socket first. Sockets
+    //  that don't support them, such as UNIX domain ones, copy as usual.
+    if (options.zerocopy_threshold) {
+        int on = 1;
+        zerocopy = setsockopt (s, SOL_SOCKET, SO_ZEROCOPY, &on,
+            sizeof on) == 0;
+    }
+#endif
+
     int family = get_peer_ip_address (s, peer_address);
     if (family == 0)
         peer_address = "";
@@ -141,6 +187,16 @@ zmq::stream_engine_t::~stream_engine_t ()
 
     int rc = tx_msg.close ();
     errno_assert (rc == 0);
+#if defined ZMQ_HAVE_UIO
+    for (int i = 0; i != out_iov_max; i++) {
+        rc = out_msgs [i].close ();
+        errno_assert (rc == 0);
+    }
+#endif
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  See destroy.
+    zmq_assert (zc_pins.empty ());
+#endif
 
     delete encoder;
     delete decoder;
@@ -158,6 +214,9 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
     zmq_assert (session_);
     session = session_;
     socket = session-> get_socket ();
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    io_thread = io_thread_;
+#endif
 
     //  Connect to I/O threads poller object.
     io_object_t::plug (io_thread_);
@@ -166,10 +225,12 @@ void zmq::stream_engine_t::plug (io_thread_t *io_thread_,
 
     if (options.raw_sock) {
         // no handshaking for raw sock, instantiate raw encoder and decoders
-        encoder = new (std::nothrow) raw_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) raw_encoder_t (
+            out_batch, options.allocator);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) raw_decoder_t (in_batch_size);
+        decoder = new (std::nothrow) raw_decoder_t (
+            in_batch, options.allocator);
         alloc_assert (decoder);
 
         // disable handshaking for raw socket
@@ -211,22 +272,125 @@ void zmq::stream_engine_t::unplug ()
     if (!io_error)
         rm_fd (handle);
 
-    //  Disconnect from I/O threads poller object.
-    io_object_t::unplug ();
+    if (has_coalesce_timer) {
+        cancel_timer (coalesce_timer_id);
+        has_coalesce_timer = false;
+    }
 
     session = NULL;
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Stay with the I/O thread's poller while messages are pinned, see
+    //  destroy.
+    if (!zc_pins.empty ())
+        return;
+#endif
+
+    //  Disconnect from I/O threads poller object.
+    io_object_t::unplug ();
 }
 
-void zmq::stream_engine_t::terminate ()
+void zmq::stream_engine_t::destroy ()
 {
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    if (!zc_pins.empty ())
+        reap_zerocopy ();
+#endif
     unplug ();
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  The kernel goes on transmitting from the pinned messages after the
+    //  socket is closed, so neither can go yet. Instead, the connection is
+    //  shut down and the error queue is polled until every zero-copy send
+    //  has been completed. Timers don't hold up the termination of the
+    //  I/O thread, so the engine is abandoned if the thread stops first.
+    if (!zc_pins.empty ()) {
+        shutdown (s, SHUT_WR);
+        add_timer (zerocopy_drain_interval, zc_drain_timer_id);
+        io_thread->add_lingering (this);
+        return;
+    }
+#endif
+
+    delete this;
+}
+
+bool zmq::stream_engine_t::unplug_poller ()
+{
+    //  Connections still handshaking or being torn down stay where they
+    //  are, and so do those waiting for the coalescing timer.
+    if (!plugged || handshaking || io_error || has_coalesce_timer)
+        return false;
+
+    rm_fd (handle);
+    io_object_t::unplug ();
+    return true;
+}
+
+void zmq::stream_engine_t::plug_poller (io_thread_t *io_thread_)
+{
+    io_object_t::plug (io_thread_);
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    io_thread = io_thread_;
+#endif
+    handle = add_fd (s);
+
+    //  Poll for whatever we were polling for in the old thread. Spurious
+    //  events are harmless.
+    if (!input_stopped)
+        set_pollin (handle);
+    if (!output_stopped)
+        set_pollout (handle);
+}
+
+void zmq::stream_engine_t::abandon ()
+{
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    cancel_timer (zc_drain_timer_id);
+    io_thread->rm_lingering (this);
+
+    //  The kernel holds references to the pages it may still transmit
+    //  from, so the messages can be released once the socket is closed.
+    int rc = close (s);
+    errno_assert (rc == 0);
+    s = retired_fd;
+    while (!zc_pins.empty ()) {
+        rc = zc_pins.front ().msg.close ();
+        errno_assert (rc == 0);
+        zc_pins.pop_front ();
+    }
+    io_object_t::unplug ();
+#endif
     delete this;
 }
 
+void zmq::stream_engine_t::terminate ()
+{
+    //  The session is done with the engine once it has read all the
+    //  messages, so a batch held back for coalescing has to be written
+    //  now, or else it would be lost. The socket may be gone already, so
+    //  the write is not accounted for.
+    socket = NULL;
+    if (out_held && !io_error) {
+        coalesce_expired = true;
+        out_event ();
+    }
+
+    destroy ();
+}
+
 void zmq::stream_engine_t::in_event ()
 {
     zmq_assert (!io_error);
 
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Completions of zero-copy sends are reported as socket errors. When
+    //  that's what woke us up while input is stopped, there's nothing
+    //  else to do; a genuine error will be reported again.
+    if (!zc_pins.empty () && reap_zerocopy () && input_stopped)
+        return;
+#endif
+
     //  If still handshaking, receive and process the greeting message.
     if (unlikely (handshaking))
         if (!handshake ())
@@ -241,46 +405,90 @@ void zmq::stream_engine_t::in_event ()
         return;
     }
 
-    //  If there's no data to process in the buffer...
-    if (!insize) {
+    //  Keep reading and decoding until the read budget is used up, the
+    //  connection has no more data or the session pushes back. Pollers
+    //  are level-triggered, so whatever is left is picked up on the next
+    //  iteration, after the other engines have had their turn.
+    size_t bytes_read = 0;
+    int msgs_read = 0;
+    bool yielded = false;
+    int rc = 0;
 
-        //  Retrieve the buffer and read as much data as possible.
-        //  Note that buffer can be arbitrarily large. However, we assume
-        //  the underlying TCP layer has fixed buffer size and thus the
-        //  number of bytes read will be always limited.
-        size_t bufsize = 0;
-        decoder->get_buffer (&inpos, &bufsize);
+    while (true) {
+        bool short_read = false;
 
-        int const rc = read (inpos, bufsize);
-        if (rc == 0) {
-            error ();
-            return;
-        }
-        if (rc == -1) {
-            if (errno != EAGAIN)
+        //  If there's no data to process in the buffer...
+        if (!insize) {
+
+            //  The buffer is empty, so this is the time to resize it.
+            if (unlikely (in_batch_next != in_batch)) {
+                decoder->resize_buffer (in_batch_next);
+                in_batch = in_batch_next;
+            }
+
+            //  Retrieve the buffer and read as much data as possible.
+            //  Note that buffer can be arbitrarily large. However, we assume
+            //  the underlying TCP layer has fixed buffer size and thus the
+            //  number of bytes read will be always limited.
+            size_t bufsize = 0;
+            decoder->get_buffer (&inpos, &bufsize);
+
+            rc = read (inpos, bufsize);
+            if (rc == 0) {
                 error ();
-            return;
+                return;
+            }
+            if (rc == -1) {
+                if (errno != EAGAIN) {
+                    error ();
+                    return;
+                }
+                rc = 0;
+                break;
+            }
+
+            //  Adjust input size
+            insize = static_cast <size_t> (rc);
+            bytes_read += insize;
+            short_read = insize < bufsize;
+
+            //  Reads straight into large messages don't tell anything
+            //  about the buffer.
+            if (options.adaptive_batch && bufsize == in_batch)
+                in_batch_next = adapt_batch (in_batch, insize,
+                    in_full, in_small);
         }
 
-        //  Adjust input size
-        insize = static_cast <size_t> (rc);
-    }
+        size_t processed = 0;
 
-    int rc = 0;
-    size_t processed = 0;
+        while (insize > 0) {
+            rc = decoder->decode (inpos, insize, processed);
+            zmq_assert (processed <= insize);
+            inpos += processed;
+            insize -= processed;
+            if (rc == 0 || rc == -1)
+                break;
+            rc = (this->*write_msg) (decoder->msg ());
+            if (rc == -1)
+                break;
+            msgs_read++;
+        }
 
-    while (insize > 0) {
-        rc = decoder->decode (inpos, insize, processed);
-        zmq_assert (processed <= insize);
-        inpos += processed;
-        insize -= processed;
-        if (rc == 0 || rc == -1)
+        //  Whatever is left in the buffer is processed on restart; a short
+        //  read means the connection has been drained for now.
+        if (rc == -1 || short_read)
             break;
-        rc = (this->*write_msg) (decoder->msg ());
-        if (rc == -1)
+        if (bytes_read >= (size_t) options.read_budget ||
+              (options.read_budget_msgs &&
+              msgs_read >= options.read_budget_msgs)) {
+            yielded = true;
             break;
+        }
     }
 
+    if (yielded && likely (socket != NULL))
+        socket->account_read_yield ();
+
     //  Tear down the connection if we have failed to decode input data
     //  or the session has rejected the message.
     if (rc == -1) {
@@ -300,7 +508,8 @@ void zmq::stream_engine_t::out_event ()
     zmq_assert (!io_error);
 
     //  If write buffer is empty, try to read new data from the encoder.
-    if (!outsize) {
+    //  A batch held back for coalescing is extended the same way.
+    if (!outsize || out_held) {
 
         //  Even when we stop polling as soon as there is no
         //  data to send, the poller may invoke out_event one
@@ -310,20 +519,37 @@ void zmq::stream_engine_t::out_event ()
             return;
         }
 
-        outpos = NULL;
-        outsize = encoder->encode (&outpos, 0);
+        //  Everything has been written, so this is the time to resize the
+        //  buffer.
+        if (unlikely (out_batch_next != out_batch) && !out_held) {
+            encoder->resize_buffer (out_batch_next);
+            out_batch = out_batch_next;
+        }
+
+#if defined ZMQ_HAVE_UIO
+        outsize = gather ();
+#else
+        if (!out_held) {
+            outpos = NULL;
+            outsize = encoder->encode (&outpos, 0);
+        }
 
-        while (outsize < out_batch_size) {
-            if ((this->*read_msg) (&tx_msg) == -1)
+        out_batch_full = true;
+        while (outsize < out_batch) {
+            if ((this->*read_msg) (&tx_msg) == -1) {
+                out_batch_full = false;
                 break;
+            }
             encoder->load_msg (&tx_msg);
             unsigned char *bufptr = outpos + outsize;
-            size_t n = encoder->encode (&bufptr, out_batch_size - outsize);
+            size_t n = encoder->encode (&bufptr, out_batch - outsize);
             zmq_assert (n > 0);
             if (outpos == NULL)
                 outpos = bufptr;
             outsize += n;
         }
+        out_buffered = outsize;
+#endif
 
         //  If there is no data to send, stop polling for output.
         if (outsize == 0) {
@@ -331,6 +557,37 @@ void zmq::stream_engine_t::out_event ()
             reset_pollout (handle);
             return;
         }
+
+        //  A small batch of messages waits for more of them to be added to
+        //  it, until it grows big enough or the coalescing delay expires.
+        //  The timer has the resolution of the I/O thread's timers, i.e.
+        //  milliseconds. Handshake data are never held back.
+        const size_t coalesce_bytes = options.coalesce_bytes ?
+            (size_t) options.coalesce_bytes : out_batch;
+        if (options.coalesce_delay && out_batch_msgs && !out_batch_full &&
+              !coalesce_expired && outsize < coalesce_bytes) {
+            if (!has_coalesce_timer) {
+                add_timer (options.coalesce_delay / 1000 +
+                    (options.coalesce_delay % 1000 != 0), coalesce_timer_id);
+                has_coalesce_timer = true;
+            }
+            out_held = true;
+            if (!output_stopped) {
+                output_stopped = true;
+                reset_pollout (handle);
+            }
+            return;
+        }
+        if (has_coalesce_timer) {
+            cancel_timer (coalesce_timer_id);
+            has_coalesce_timer = false;
+        }
+        coalesce_expired = false;
+        out_held = false;
+
+        if (options.adaptive_batch && out_buffered)
+            out_batch_next = adapt_batch (out_batch, out_buffered,
+                out_full, out_small);
     }
 
     //  If there are any data to write in write buffer, write as much as
@@ -338,7 +595,15 @@ void zmq::stream_engine_t::out_event ()
     //  arbitrarily large. However, we assume that underlying TCP layer has
     //  limited transmission buffer and thus the actual number of bytes
     //  written should be reasonably modest.
+#if defined ZMQ_HAVE_UIO
+    int nbytes = outiov_count ? write_out_iov () : write (outpos, outsize);
+#else
     int nbytes = write (outpos, outsize);
+#endif
+    if (likely (socket != NULL))
+        socket->account_writes (1, out_batch_msgs,
+            encoder ? encoder->take_copied () : 0);
+    out_batch_msgs = 0;
 
     //  IO error has occurred. We stop waiting for output events.
     //  The engine is not terminated until we detect input error;
@@ -348,14 +613,53 @@ void zmq::stream_engine_t::out_event ()
         return;
     }
 
-    outpos += nbytes;
     outsize -= nbytes;
+#if defined ZMQ_HAVE_UIO
+    if (outiov_count)
+        skip_out_iov (nbytes);
+    else
+        outpos += nbytes;
+#else
+    outpos += nbytes;
+#endif
 
     //  If we are still handshaking and there are no data
     //  to send, stop polling for output.
     if (unlikely (handshaking))
         if (outsize == 0)
             reset_pollout (handle);
+
+    //  Output is not polled for while a batch is held back, so a batch
+    //  that was released but not written completely has to start it.
+    if (unlikely (output_stopped) && outsize) {
+        set_pollout (handle);
+        output_stopped = false;
+    }
+}
+
+void zmq::stream_engine_t::timer_event (int id_)
+{
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    if (id_ == zc_drain_timer_id) {
+        reap_zerocopy ();
+        if (!zc_pins.empty ()) {
+            add_timer (zerocopy_drain_interval, zc_drain_timer_id);
+            return;
+        }
+        io_thread->rm_lingering (this);
+        io_object_t::unplug ();
+        delete this;
+        return;
+    }
+#endif
+
+    zmq_assert (id_ == coalesce_timer_id);
+    has_coalesce_timer = false;
+    coalesce_expired = true;
+
+    //  Write whatever has been coalesced so far.
+    if (out_held && !io_error)
+        out_event ();
 }
 
 void zmq::stream_engine_t::restart_output ()
@@ -363,7 +667,9 @@ void zmq::stream_engine_t::restart_output ()
     if (unlikely (io_error))
         return;
 
-    if (likely (output_stopped)) {
+    //  A batch held back for coalescing is not polled for; new messages
+    //  are just added to it.
+    if (likely (output_stopped) && !out_held) {
         set_pollout (handle);
         output_stopped = false;
     }
@@ -501,10 +807,12 @@ bool zmq::stream_engine_t::handshake ()
     //  Is the peer using ZMTP/1.0 with no revision number?
     //  If so, we send and receive rest of identity message
     if (greeting_recv [0] != 0xff || !(greeting_recv [9] & 0x01)) {
-        encoder = new (std::nothrow) v1_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v1_encoder_t (
+            out_batch, options.allocator);
         alloc_assert (encoder);
 
-        decoder = new (std::nothrow) v1_decoder_t (in_batch_size, options.maxmsgsize);
+        decoder = new (std::nothrow) v1_decoder_t (
+            in_batch, options.maxmsgsize, options.allocator);
         alloc_assert (decoder);
 
         //  We have already sent the message header.
@@ -543,28 +851,30 @@ bool zmq::stream_engine_t::handshake ()
     else
     if (greeting_recv [revision_pos] == ZMTP_1_0) {
         encoder = new (std::nothrow) v1_encoder_t (
-            out_batch_size);
+            out_batch, options.allocator);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v1_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_batch, options.maxmsgsize, options.allocator);
         alloc_assert (decoder);
     }
     else
     if (greeting_recv [revision_pos] == ZMTP_2_0) {
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (
+            out_batch, options.allocator);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_batch, options.maxmsgsize, options.allocator);
         alloc_assert (decoder);
     }
     else {
-        encoder = new (std::nothrow) v2_encoder_t (out_batch_size);
+        encoder = new (std::nothrow) v2_encoder_t (
+            out_batch, options.allocator);
         alloc_assert (encoder);
 
         decoder = new (std::nothrow) v2_decoder_t (
-            in_batch_size, options.maxmsgsize);
+            in_batch, options.maxmsgsize, options.allocator);
         alloc_assert (decoder);
 
         if (memcmp (greeting_recv + 12, "NULL\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0", 20) == 0) {
@@ -705,7 +1015,10 @@ void zmq::stream_engine_t::mechanism_ready ()
 
 int zmq::stream_engine_t::pull_msg_from_session (msg_t *msg_)
 {
-    return session->pull_msg (msg_);
+    const int rc = session->pull_msg (msg_);
+    if (rc == 0)
+        out_batch_msgs++;
+    return rc;
 }
 
 int zmq::stream_engine_t::push_msg_to_session (msg_t *msg_)
@@ -742,6 +1055,7 @@ int zmq::stream_engine_t::pull_and_encode (msg_t *msg_)
 
     if (session->pull_msg (msg_) == -1)
         return -1;
+    out_batch_msgs++;
     if (mechanism->encode (msg_) == -1)
         return -1;
     return 0;
@@ -800,8 +1114,7 @@ void zmq::stream_engine_t::error ()
     socket->event_disconnected (endpoint, s);
     session->flush ();
     session->engine_error ();
-    unplug ();
-    delete this;
+    destroy ();
 }
 
 int zmq::stream_engine_t::write (const void *data_, size_t size_)
@@ -859,6 +1172,296 @@ int zmq::stream_engine_t::write (const void *data_, size_t size_)
 #endif
 }
 
+#if defined ZMQ_HAVE_UIO
+
+int zmq::stream_engine_t::writev (const iovec *iov_, int count_)
+{
+    ssize_t nbytes = ::writev (s, iov_, count_);
+
+    //  Several errors are OK. When speculative write is being done we may not
+    //  be able to write a single byte to the socket. Also, SIGSTOP issued
+    //  by a debugging tool can result in EINTR error.
+    if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+          errno == EINTR))
+        return 0;
+
+    //  Signalise peer failure.
+    if (nbytes == -1) {
+        errno_assert (errno != EBADF
+                   && errno != EDESTADDRREQ
+                   && errno != EFAULT
+                   && errno != EINVAL
+                   && errno != ENOMEM);
+        return -1;
+    }
+
+    return static_cast <int> (nbytes);
+}
+
+size_t zmq::stream_engine_t::gather ()
+{
+    //  A batch held back for coalescing is extended rather than started
+    //  anew; nothing of it has been written yet.
+    if (!out_held) {
+        outpos = NULL;
+        outiov_count = 0;
+        outiov_pos = 0;
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+        zc_pinned_iov = -1;
+#endif
+        out_bufptr = NULL;
+        out_buffered = 0;
+    }
+
+    //  Small chunks are copied one after another to the encoder's buffer,
+    //  large ones are referenced in place, so that many medium sized
+    //  messages can go out in a single call without being copied. The
+    //  batch is complete once there's enough data to write, once the
+    //  buffer or the iovec array is full, or once there are no more
+    //  messages to send. A chunk the encoder hands out in place because
+    //  it fills the whole buffer is not retained, so it ends the batch
+    //  as a full buffer would.
+    unsigned char *bufptr = out_bufptr;
+    size_t buffered = out_buffered;
+    size_t total = outsize;
+    out_batch_full = true;
+    while (total < out_gather_max && outiov_count < out_iov_max) {
+        if (bufptr && buffered >= out_batch)
+            break;
+        unsigned char *data = bufptr;
+        bool in_place;
+        const size_t n = encoder->encode (&data,
+            bufptr ? out_batch - buffered : 0,
+            options.gather_threshold, in_place);
+        if (n == 0) {
+            if ((this->*read_msg) (&tx_msg) == -1) {
+                out_batch_full = false;
+                break;
+            }
+            encoder->load_msg (&tx_msg);
+            continue;
+        }
+        total += n;
+
+        //  Keep the message alive until its data are written.
+        if (in_place) {
+            out_msgs_iov [out_msgs_count] = outiov_count;
+            const int rc = out_msgs [out_msgs_count++].copy (tx_msg);
+            errno_assert (rc == 0);
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+            outiov_zc [outiov_count] = zerocopy &&
+                n >= (size_t) options.zerocopy_threshold;
+#endif
+            outiov [outiov_count].iov_base = data;
+            outiov [outiov_count].iov_len = n;
+            outiov_count++;
+            continue;
+        }
+
+        //  Data copied right behind the previous chunk extend it.
+        bufptr = data + n;
+        buffered += n;
+        if (outiov_count &&
+              (unsigned char*) outiov [outiov_count - 1].iov_base +
+              outiov [outiov_count - 1].iov_len == data)
+            outiov [outiov_count - 1].iov_len += n;
+        else {
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+            outiov_zc [outiov_count] = false;
+#endif
+            outiov [outiov_count].iov_base = data;
+            outiov [outiov_count].iov_len = n;
+            outiov_count++;
+        }
+    }
+
+    out_bufptr = bufptr;
+    out_buffered = buffered;
+    return total;
+}
+
+void zmq::stream_engine_t::skip_out_iov (size_t size_)
+{
+    //  Skip the chunks that were written completely and adjust
+    //  the one that was written partially.
+    while (size_) {
+        iovec &iov = outiov [outiov_pos];
+        if (size_ < iov.iov_len) {
+            iov.iov_base = (unsigned char*) iov.iov_base + size_;
+            iov.iov_len -= size_;
+            break;
+        }
+        size_ -= iov.iov_len;
+        outiov_pos++;
+    }
+
+    //  Release the messages whose chunks were written completely rather
+    //  than holding on to all of them until the whole batch is out.
+    while (out_msgs_released != out_msgs_count &&
+          out_msgs_iov [out_msgs_released] < outiov_pos) {
+        const int rc = out_msgs [out_msgs_released].close ();
+        errno_assert (rc == 0);
+        const int rc2 = out_msgs [out_msgs_released].init ();
+        errno_assert (rc2 == 0);
+        out_msgs_released++;
+    }
+
+    if (outiov_pos == outiov_count) {
+        outiov_count = 0;
+        outiov_pos = 0;
+        out_msgs_count = 0;
+        out_msgs_released = 0;
+    }
+}
+
+int zmq::stream_engine_t::write_out_iov ()
+{
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+    //  Everything passed to a zero-copy send stays pinned until the kernel
+    //  is done with it, so such chunks go out on their own and the chunks
+    //  around them, which may be in the reused output buffer, are written
+    //  as usual.
+    if (zerocopy) {
+        if (outiov_zc [outiov_pos])
+            return send_zerocopy ();
+        int end = outiov_pos + 1;
+        while (end != outiov_count && !outiov_zc [end])
+            end++;
+        return writev (outiov + outiov_pos, end - outiov_pos);
+    }
+#endif
+    return writev (outiov + outiov_pos, outiov_count - outiov_pos);
+}
+
+#endif
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+
+int zmq::stream_engine_t::send_zerocopy ()
+{
+    msghdr hdr;
+    memset (&hdr, 0, sizeof hdr);
+    hdr.msg_iov = outiov + outiov_pos;
+    hdr.msg_iovlen = 1;
+    ssize_t nbytes = sendmsg (s, &hdr, MSG_ZEROCOPY);
+
+    //  If the kernel is short of memory to track the pinned pages, the
+    //  chunk is copied as usual.
+    if (nbytes == -1 && errno == ENOBUFS)
+        return writev (outiov + outiov_pos, 1);
+
+    //  Same errors are OK as for the other writes.
+    if (nbytes == -1 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+          errno == EINTR))
+        return 0;
+
+    if (nbytes == -1) {
+        errno_assert (errno != EBADF
+                   && errno != EDESTADDRREQ
+                   && errno != EFAULT
+                   && errno != EINVAL
+                   && errno != ENOMEM);
+        return -1;
+    }
+
+    //  Each send that queued some data gets the next sequence number.
+    //  The message stays pinned until the completion of the last send
+    //  referring to it arrives.
+    if (nbytes > 0) {
+        if (zc_pinned_iov != outiov_pos) {
+            int i = out_msgs_released;
+            while (out_msgs_iov [i] != outiov_pos)
+                i++;
+            zc_pins.push_back (zc_pin_t ());
+            int rc = zc_pins.back ().msg.init ();
+            errno_assert (rc == 0);
+            rc = zc_pins.back ().msg.copy (out_msgs [i]);
+            errno_assert (rc == 0);
+            zc_pinned_iov = outiov_pos;
+        }
+        zc_pins.back ().seq = zc_seq++;
+    }
+
+    return static_cast <int> (nbytes);
+}
+
+bool zmq::stream_engine_t::reap_zerocopy ()
+{
+    bool reaped = false;
+    while (true) {
+        unsigned char control [256];
+        msghdr hdr;
+        memset (&hdr, 0, sizeof hdr);
+        hdr.msg_control = control;
+        hdr.msg_controllen = sizeof control;
+        if (recvmsg (s, &hdr, MSG_ERRQUEUE) == -1)
+            break;
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR (&hdr); cmsg;
+              cmsg = CMSG_NXTHDR (&hdr, cmsg)) {
+            if (!((cmsg->cmsg_level == SOL_IP &&
+                  cmsg->cmsg_type == IP_RECVERR) ||
+                  (cmsg->cmsg_level == SOL_IPV6 &&
+                  cmsg->cmsg_type == IPV6_RECVERR)))
+                continue;
+            const sock_extended_err *err =
+                (const sock_extended_err*) CMSG_DATA (cmsg);
+            if (err->ee_errno != 0 ||
+                  err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            //  The notification covers the sends from ee_info to ee_data.
+            //  TCP completes them in order, so every message up to the
+            //  last one of the range can be released.
+            while (!zc_pins.empty () &&
+                  (int32_t) (zc_pins.front ().seq - err->ee_data) <= 0) {
+                const int rc = zc_pins.front ().msg.close ();
+                errno_assert (rc == 0);
+                zc_pins.pop_front ();
+            }
+            reaped = true;
+        }
+    }
+    return reaped;
+}
+
+#endif
+
+size_t zmq::stream_engine_t::initial_batch (int size_, bool adaptive_)
+{
+    if (adaptive_)
+        return std::min (std::max ((size_t) size_, (size_t) min_batch_size),
+            (size_t) max_batch_size);
+    return size_;
+}
+
+size_t zmq::stream_engine_t::adapt_batch (size_t batch_, size_t used_,
+    int &full_, int &small_)
+{
+    if (used_ >= batch_) {
+        small_ = 0;
+        if (++full_ == batch_grow_count) {
+            full_ = 0;
+            if (batch_ < max_batch_size)
+                return std::min (batch_ * 2, (size_t) max_batch_size);
+        }
+    }
+    else
+    if (used_ <= batch_ / 4) {
+        full_ = 0;
+        if (++small_ == batch_shrink_count) {
+            small_ = 0;
+            if (batch_ > min_batch_size)
+                return std::max (batch_ / 2, (size_t) min_batch_size);
+        }
+    }
+    else {
+        full_ = 0;
+        small_ = 0;
+    }
+    return batch_;
+}
+
 int zmq::stream_engine_t::read (void *data_, size_t size_)
 {
 #ifdef ZMQ_HAVE_WINDOWS
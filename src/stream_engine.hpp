@@ -22,6 +22,23 @@
 
 #include <stddef.h>
 
+#include "platform.hpp"
+#if defined ZMQ_HAVE_UIO
+#include <sys/uio.h>
+#endif
+
+//  On Linux, large message bodies can be sent with MSG_ZEROCOPY, provided
+//  the headers are recent enough to know about it.
+#if defined ZMQ_HAVE_LINUX && defined ZMQ_HAVE_UIO
+#include <sys/socket.h>
+#include <linux/errqueue.h>
+#if defined SO_ZEROCOPY && defined MSG_ZEROCOPY && defined SO_EE_ORIGIN_ZEROCOPY
+#define ZMQ_HAVE_MSG_ZEROCOPY
+#include <deque>
+#include "stdint.hpp"
+#endif
+#endif
+
 #include "fd.hpp"
 #include "i_engine.hpp"
 #include "io_object.hpp"
@@ -29,6 +46,7 @@
 #include "i_decoder.hpp"
 #include "options.hpp"
 #include "socket_base.hpp"
+#include "config.hpp"
 #include "../include/zmq.h"
 
 namespace zmq
@@ -63,16 +81,28 @@ namespace zmq
         void restart_input ();
         void restart_output ();
         void zap_msg_available ();
+        bool unplug_poller ();
+        void plug_poller (zmq::io_thread_t *io_thread_);
+
+        //  Deletes an engine lingering in the I/O thread right away. Used
+        //  when the I/O thread stops.
+        void abandon ();
 
         //  i_poll_events interface implementation.
         void in_event ();
         void out_event ();
+        void timer_event (int id_);
 
     private:
 
         //  Unplug the engine from the session.
         void unplug ();
 
+        //  Unplugs the engine and deletes it, unless the kernel may still
+        //  read the data of messages it sent, in which case it lingers in
+        //  the I/O thread until the kernel is done with them.
+        void destroy ();
+
         //  Function to handle network disconnections.
         void error ();
 
@@ -87,6 +117,46 @@ namespace zmq
         //  of error or orderly shutdown by the other peer -1 is returned.
         int write (const void *data_, size_t size_);
 
+#if defined ZMQ_HAVE_UIO
+        //  Same as write, except that the data are gathered from the
+        //  chunks described by the iovec array.
+        int writev (const iovec *iov_, int count_);
+
+        //  Fills the output iovec array with data from the encoder.
+        //  Returns the total number of bytes to write.
+        size_t gather ();
+
+        //  Skips size_ bytes of the output chunks. Once all of them are
+        //  written, the messages referenced by the chunks are released.
+        void skip_out_iov (size_t size_);
+
+        //  Writes as many of the output chunks as can go out in a single
+        //  call. Returns the same as write.
+        int write_out_iov ();
+#endif
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+        //  Sends the current output chunk with MSG_ZEROCOPY and pins the
+        //  message it belongs to. Returns the same as write.
+        int send_zerocopy ();
+
+        //  Processes the completion notifications of zero-copy sends and
+        //  releases the messages the kernel is done with. Returns true if
+        //  there were any.
+        bool reap_zerocopy ();
+#endif
+
+        //  In adaptive batching mode, accounts for a read or write that used
+        //  used_ bytes of a buffer of batch_ bytes and returns the size the
+        //  buffer should have from now on.
+        size_t adapt_batch (size_t batch_, size_t used_, int &full_,
+            int &small_);
+
+        //  Returns the size of a buffer set to size_ bytes to start with. In
+        //  adaptive batching mode, it's kept within the sizes adaptation
+        //  keeps buffers between.
+        static size_t initial_batch (int size_, bool adaptive_);
+
         //  Reads data from the socket (up to 'size' bytes).
         //  Returns the number of bytes actually read or -1 on error.
         //  Zero indicates the peer has closed the connection.
@@ -131,6 +201,89 @@ namespace zmq
         size_t outsize;
         i_encoder *encoder;
 
+        //  Sizes of the decoder's and the encoder's buffers, and the sizes
+        //  they are to be given before the next read or batch of writes.
+        size_t in_batch;
+        size_t in_batch_next;
+        size_t out_batch;
+        size_t out_batch_next;
+
+        //  Numbers of reads and writes in a row that filled the buffer and
+        //  that used a small part of it only.
+        int in_full;
+        int in_small;
+        int out_full;
+        int out_small;
+
+        //  Data copied to the encoder's buffer for the current batch, and
+        //  where the next copy goes. Only the copied data tell how well
+        //  the buffer fits.
+        unsigned char *out_bufptr;
+        size_t out_buffered;
+
+        //  True if the current batch can't take any more data.
+        bool out_batch_full;
+
+        //  Number of message parts pulled from the session for the current
+        //  batch.
+        uint64_t out_batch_msgs;
+
+        //  True while the current batch is held back waiting for more
+        //  messages to coalesce with. The wait is bounded by the coalescing
+        //  timer; once it expires, the batch is written however small.
+        bool out_held;
+        bool has_coalesce_timer;
+        bool coalesce_expired;
+        enum {coalesce_timer_id = 0x40};
+
+#if defined ZMQ_HAVE_UIO
+        //  Chunks of output data to be written by a single 'writev' call,
+        //  and index of the first chunk that was not completely written yet.
+        //  Unless outiov_count is zero, the chunks rather than outpos
+        //  describe the data to be written.
+        iovec outiov [out_iov_max];
+        int outiov_count;
+        int outiov_pos;
+
+        //  Copies of the messages whose data are referenced by outiov,
+        //  and the index of the chunk referencing each of them. Each one
+        //  is released as soon as its chunk has been written; the first
+        //  out_msgs_released of them have been released already.
+        msg_t out_msgs [out_iov_max];
+        int out_msgs_iov [out_iov_max];
+        int out_msgs_count;
+        int out_msgs_released;
+#endif
+
+#if defined ZMQ_HAVE_MSG_ZEROCOPY
+        //  True if large message bodies are sent with MSG_ZEROCOPY.
+        bool zerocopy;
+
+        //  Tells which of the output chunks are to be sent with
+        //  MSG_ZEROCOPY, and which of them, if any, is pinned already.
+        bool outiov_zc [out_iov_max];
+        int zc_pinned_iov;
+
+        //  Messages whose data may still be read by the kernel, in the
+        //  order they were sent, each with the sequence number of the last
+        //  zero-copy send that referred to it.
+        struct zc_pin_t
+        {
+            uint32_t seq;
+            msg_t msg;
+        };
+        typedef std::deque <zc_pin_t> zc_pins_t;
+        zc_pins_t zc_pins;
+
+        //  Sequence number the kernel assigns to the next zero-copy send.
+        uint32_t zc_seq;
+
+        //  I/O thread the engine runs in.
+        zmq::io_thread_t *io_thread;
+
+        enum {zc_drain_timer_id = 0x41};
+#endif
+
         //  When true, we are still trying to determine whether
         //  the peer is using versioned protocol, and if so, which
         //  version.  When false, normal message flow has started.
@@ -139,3 +139,20 @@ void zmq::tune_tcp_keepalives (fd_t s_, int keepalive_, int keepalive_cnt_, int
 #endif // ZMQ_HAVE_SO_KEEPALIVE
 #endif // ZMQ_HAVE_WINDOWS
 }
+
+void zmq::tune_tcp_busy_poll (fd_t s_, int busy_poll_)
+{
+    // If SO_BUSY_POLL is not available, the arguments are unused.
+    (void)s_;
+    (void)busy_poll_;
+
+#ifdef SO_BUSY_POLL
+    //  Raising the value above the system default requires CAP_NET_ADMIN.
+    //  Without it the socket is simply not busy polled by the kernel.
+    if (busy_poll_ > 0) {
+        int rc = setsockopt (s_, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_,
+            sizeof (int));
+        errno_assert (rc == 0 || errno == EPERM);
+    }
+#endif
+}
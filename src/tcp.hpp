@@ -37,6 +37,11 @@ namespace zmq
     //  Tunes TCP keep-alives
     void tune_tcp_keepalives (fd_t s_, int keepalive_, int keepalive_cnt_, int keepalive_idle_, int keepalive_intvl_);
 
+    //  Asks the kernel to busy poll the device queue for up to busy_poll_
+    //  microseconds when the socket has no data. Zero leaves the socket
+    //  as is.
+    void tune_tcp_busy_poll (fd_t s_, int busy_poll_);
+
 }
 
 #endif 
@@ -123,6 +123,7 @@ void zmq::tcp_connecter_t::out_event ()
 
     tune_tcp_socket (fd);
     tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt, options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
+    tune_tcp_busy_poll (fd, options.busy_poll);
 
     // remember our fd for ZMQ_SRCFD in messages
     socket->set_fd(fd);
@@ -32,6 +32,7 @@
 #include "ip.hpp"
 #include "tcp.hpp"
 #include "socket_base.hpp"
+#include "ctx.hpp"
 
 #ifdef ZMQ_HAVE_WINDOWS
 #include "windows.hpp"
@@ -54,13 +55,17 @@ zmq::tcp_listener_t::tcp_listener_t (io_thread_t *io_thread_,
     own_t (io_thread_, options_),
     io_object_t (io_thread_),
     s (retired_fd),
+    shared_port (0),
     socket (socket_)
 {
 }
 
 zmq::tcp_listener_t::~tcp_listener_t ()
 {
-    zmq_assert (s == retired_fd);
+    //  A listener that was bound but never launched, because binding
+    //  another shard of the endpoint failed, still owns its socket.
+    if (s != retired_fd)
+        close ();
 }
 
 void zmq::tcp_listener_t::process_plug ()
@@ -90,6 +95,7 @@ void zmq::tcp_listener_t::in_event ()
 
     tune_tcp_socket (fd);
     tune_tcp_keepalives (fd, options.tcp_keepalive, options.tcp_keepalive_cnt, options.tcp_keepalive_idle, options.tcp_keepalive_intvl);
+    tune_tcp_busy_poll (fd, options.busy_poll);
 
     // remember our fd for ZMQ_SRCFD in messages
     socket->set_fd(fd);
@@ -126,6 +132,11 @@ void zmq::tcp_listener_t::close ()
 #endif
     socket->event_closed (endpoint, s);
     s = retired_fd;
+
+    if (shared_port) {
+        get_ctx ()->unregister_shared_port (shared_port);
+        shared_port = 0;
+    }
 }
 
 int zmq::tcp_listener_t::get_address (std::string &addr_)
@@ -148,7 +159,48 @@ int zmq::tcp_listener_t::get_address (std::string &addr_)
     return addr.to_string (addr_);
 }
 
-int zmq::tcp_listener_t::set_address (const char *addr_)
+int zmq::tcp_listener_t::share_port (bool first_)
+{
+    zmq_assert (s != retired_fd && !shared_port);
+
+    struct sockaddr_storage ss;
+#ifdef ZMQ_HAVE_HPUX
+    int sl = sizeof (ss);
+#else
+    socklen_t sl = sizeof (ss);
+#endif
+    int rc = getsockname (s, (struct sockaddr *) &ss, &sl);
+    errno_assert (rc == 0);
+    int port = ntohs (ss.ss_family == AF_INET6 ?
+        ((struct sockaddr_in6 *) &ss)->sin6_port :
+        ((struct sockaddr_in *) &ss)->sin_port);
+
+    rc = get_ctx ()->register_shared_port (port, first_);
+    if (rc != 0)
+        return -1;
+    shared_port = port;
+    return 0;
+}
+
+bool zmq::tcp_listener_t::can_shard ()
+{
+#if defined SO_REUSEPORT
+    //  The headers may know about the option while the running kernel
+    //  doesn't (Linux got it in 3.9).
+    fd_t fd = open_socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (fd == retired_fd)
+        return false;
+    int flag = 1;
+    int rc = setsockopt (fd, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof (int));
+    int rc2 = ::close (fd);
+    errno_assert (rc2 == 0);
+    return rc == 0;
+#else
+    return false;
+#endif
+}
+
+int zmq::tcp_listener_t::set_address (const char *addr_, bool shared_)
 {
     //  Convert the textual address into address structure.
     int rc = address.resolve (addr_, true, options.ipv6);
@@ -215,6 +267,17 @@ int zmq::tcp_listener_t::set_address (const char *addr_)
 
     address.to_string (endpoint);
 
+#if defined SO_REUSEPORT
+    //  Shards of an endpoint all bind to the same port.
+    if (shared_) {
+        rc = setsockopt (s, SOL_SOCKET, SO_REUSEPORT, &flag, sizeof (int));
+        if (rc != 0)
+            goto error;
+    }
+#else
+    zmq_assert (!shared_);
+#endif
+
     //  Bind the socket to the network interface and port.
     rc = bind (s, address.addr (), address.addrlen ());
 #ifdef ZMQ_HAVE_WINDOWS
@@ -41,12 +41,22 @@ namespace zmq
             zmq::socket_base_t *socket_, const options_t &options_);
         ~tcp_listener_t ();
 
-        //  Set address to listen on.
-        int set_address (const char *addr_);
+        //  Set address to listen on. If shared_ is true, other listeners
+        //  may bind to the same port.
+        int set_address (const char *addr_, bool shared_);
 
         // Get the bound address for use with wildcard
         int get_address (std::string &addr_);
 
+        //  Registers the port the listener is bound to with the context as
+        //  shared by the shards of an endpoint. Fails with EADDRINUSE if
+        //  first_ is set and another endpoint of the context shares it.
+        int share_port (bool first_);
+
+        //  Returns true if several listeners can share a port, each being
+        //  handed a part of the incoming connections by the system.
+        static bool can_shard ();
+
     private:
 
         //  Handlers for incoming commands.
@@ -71,6 +81,9 @@ namespace zmq
         //  Underlying socket.
         fd_t s;
 
+        //  Port registered with the context as shared, zero if none.
+        int shared_port;
+
         //  Handle corresponding to the listening socket.
         handle_t handle;
 
@@ -21,6 +21,14 @@
 #include "err.hpp"
 #include "platform.hpp"
 
+void zmq::thread_t::set_scheduling (int policy_, int priority_,
+    const std::set <int> &cpus_)
+{
+    policy = policy_;
+    priority = priority_;
+    cpus = cpus_;
+}
+
 #ifdef ZMQ_HAVE_WINDOWS
 
 extern "C"
@@ -32,6 +40,7 @@ extern "C"
 #endif
     {
         zmq::thread_t *self = (zmq::thread_t*) arg_;
+        self->apply_scheduling ();
         self->tfn (self->arg);
         return 0;
     }
@@ -51,6 +60,19 @@ void zmq::thread_t::start (thread_fn *tfn_, void *arg_)
     win_assert (descriptor != NULL);    
 }
 
+void zmq::thread_t::apply_scheduling ()
+{
+    //  Only the CPU affinity is supported on Windows. The placement is best
+    //  effort: CPUs that don't exist are ignored.
+    DWORD_PTR mask = 0;
+    for (std::set <int>::const_iterator it = cpus.begin ();
+          it != cpus.end (); ++it)
+        if (*it < (int) (sizeof (DWORD_PTR) * 8))
+            mask |= (DWORD_PTR) 1 << *it;
+    if (mask)
+        SetThreadAffinityMask (GetCurrentThread (), mask);
+}
+
 void zmq::thread_t::stop ()
 {
     DWORD rc = WaitForSingleObject (descriptor, INFINITE);
@@ -62,6 +84,7 @@ void zmq::thread_t::stop ()
 #else
 
 #include <signal.h>
+#include <sched.h>
 
 extern "C"
 {
@@ -78,6 +101,7 @@ extern "C"
 #endif
 
         zmq::thread_t *self = (zmq::thread_t*) arg_;   
+        self->apply_scheduling ();
         self->tfn (self->arg);
         return NULL;
     }
@@ -97,6 +121,57 @@ void zmq::thread_t::stop ()
     posix_assert (rc);
 }
 
+void zmq::thread_t::apply_scheduling ()
+{
+    //  The settings are best effort. Raising the priority may take
+    //  privileges the process doesn't have and the CPUs may be offline or
+    //  out of the process' CPU set, in which case the thread just runs
+    //  with the defaults.
+#if defined ZMQ_HAVE_LINUX
+    if (!cpus.empty ()) {
+        cpu_set_t set;
+        CPU_ZERO (&set);
+        for (std::set <int>::const_iterator it = cpus.begin ();
+              it != cpus.end (); ++it)
+            if (*it < CPU_SETSIZE)
+                CPU_SET (*it, &set);
+        sched_setaffinity (0, sizeof set, &set);
+    }
+#endif
+
+#if !defined ZMQ_HAVE_OPENVMS
+    if (policy != -1 || priority != -1) {
+        int current_policy;
+        struct sched_param param;
+        int rc = pthread_getschedparam (pthread_self (), &current_policy,
+            &param);
+        posix_assert (rc);
+        if (policy != -1)
+            current_policy = policy;
+        if (priority != -1)
+            param.sched_priority = priority;
+
+        //  Real-time policies take priorities of 1 and up, the others
+        //  take 0 only. Without a priority, the lowest of the policy
+        //  is used.
+        int min = sched_get_priority_min (current_policy);
+        int max = sched_get_priority_max (current_policy);
+        if (priority == -1 &&
+              (param.sched_priority < min || param.sched_priority > max))
+            param.sched_priority = min;
+
+        //  A priority set for a policy inherited from the thread starting
+        //  the context may not suit it.
+        if (param.sched_priority >= min && param.sched_priority <= max) {
+            rc = pthread_setschedparam (pthread_self (), current_policy,
+                &param);
+            if (rc != EPERM)
+                posix_assert (rc);
+        }
+    }
+#endif
+}
+
 #endif
 
 
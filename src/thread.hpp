@@ -20,6 +20,8 @@
 #ifndef __ZMQ_THREAD_HPP_INCLUDED__
 #define __ZMQ_THREAD_HPP_INCLUDED__
 
+#include <set>
+
 #include "platform.hpp"
 
 #ifdef ZMQ_HAVE_WINDOWS
@@ -44,10 +46,18 @@ namespace zmq
     {
     public:
 
-        inline thread_t ()
+        inline thread_t () :
+            policy (-1),
+            priority (-1)
         {
         }
 
+        //  Sets the scheduling policy and priority of the thread, and the
+        //  CPUs it may run on. To be called before the thread is started.
+        //  -1 and an empty set leave the defaults of the OS in place.
+        void set_scheduling (int policy_, int priority_,
+            const std::set <int> &cpus_);
+
         //  Creates OS thread. 'tfn' is main thread function. It'll be passed
         //  'arg' as an argument.
         void start (thread_fn *tfn_, void *arg_);
@@ -59,6 +69,11 @@ namespace zmq
         //  they would not be accessible from the main C routine of the thread.
         thread_fn *tfn;
         void *arg;
+
+        //  Applies the scheduling parameters to the calling thread. Called
+        //  by the thread itself before it does anything else, so that the
+        //  memory it allocates is local to the CPUs it runs on.
+        void apply_scheduling ();
         
     private:
 
@@ -68,6 +83,11 @@ namespace zmq
         pthread_t descriptor;
 #endif
 
+        //  Scheduling parameters, as passed to set_scheduling.
+        int policy;
+        int priority;
+        std::set <int> cpus;
+
         thread_t (const thread_t&);
         const thread_t &operator = (const thread_t&);
     };
@@ -0,0 +1,259 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <new>
+
+#include "timer_wheel.hpp"
+#include "i_poll_events.hpp"
+#include "err.hpp"
+
+zmq::timer_wheel_t::timer_wheel_t () :
+    current (0),
+    count (0),
+    buckets (64),
+    spare (NULL)
+{
+    for (int level = 0; level != levels; level++) {
+        for (int slot = 0; slot != slots; slot++)
+            wheel [level][slot] = NULL;
+        counts [level] = 0;
+    }
+}
+
+zmq::timer_wheel_t::~timer_wheel_t ()
+{
+    for (buckets_t::size_type i = 0; i != buckets.size (); i++)
+        while (buckets [i]) {
+            timer_info_t *timer = buckets [i];
+            buckets [i] = timer->next_in_bucket;
+            delete timer;
+        }
+    while (spare) {
+        timer_info_t *timer = spare;
+        spare = timer->next;
+        delete timer;
+    }
+}
+
+void zmq::timer_wheel_t::add (uint64_t now_, int timeout_,
+    i_poll_events *sink_, int id_)
+{
+    //  An empty wheel can be moved to any point in time.
+    if (!count)
+        current = now_;
+
+    timer_info_t *timer = spare;
+    if (timer)
+        spare = timer->next;
+    else {
+        timer = new (std::nothrow) timer_info_t;
+        alloc_assert (timer);
+    }
+    timer->sink = sink_;
+    timer->id = id_;
+    timer->expiration = now_ + timeout_;
+    insert (timer);
+
+    if (count >= buckets.size ())
+        rehash ();
+    timer_info_t **b = bucket (sink_, id_);
+    timer->next_in_bucket = *b;
+    *b = timer;
+    count++;
+}
+
+void zmq::timer_wheel_t::cancel (i_poll_events *sink_, int id_)
+{
+    for (timer_info_t **link = bucket (sink_, id_); *link;
+          link = &(*link)->next_in_bucket) {
+        timer_info_t *timer = *link;
+        if (timer->sink == sink_ && timer->id == id_) {
+            *link = timer->next_in_bucket;
+            unlink (timer);
+            timer->next = spare;
+            spare = timer;
+            count--;
+            return;
+        }
+    }
+
+    //  Timer not found.
+    zmq_assert (false);
+}
+
+uint64_t zmq::timer_wheel_t::execute (uint64_t now_)
+{
+    while (current <= now_) {
+
+        if (!count) {
+            current = now_ + 1;
+            break;
+        }
+
+        //  Nothing happens until the lowest level holding any timers
+        //  goes down the wheel. Skip the ticks in between.
+        int level = 0;
+        while (!counts [level])
+            level++;
+        if (level) {
+            uint64_t span = (uint64_t) 1 << (slot_bits * level);
+            uint64_t next = (current + span - 1) & ~(span - 1);
+            if (next > now_) {
+                current = now_ + 1;
+                break;
+            }
+            current = next;
+        }
+
+        //  Each time a level has gone round, the next slot of the level
+        //  above is moved down.
+        int slot = (int) (current & (slots - 1));
+        for (level = 1; slot == 0 && level != levels; level++) {
+            slot = (int) (current >> (slot_bits * level)) & (slots - 1);
+            cascade (level, slot);
+        }
+
+        //  Trigger the timers of the tick. The timers are detached from the
+        //  wheel first so that the sinks can add and cancel timers freely.
+        timer_info_t *due = wheel [0][current & (slots - 1)];
+        wheel [0][current & (slots - 1)] = NULL;
+        if (due)
+            due->prev = &due;
+        current++;
+        while (due) {
+            timer_info_t *timer = due;
+            unlink (timer);
+
+            //  Remove it from the list of active timers.
+            timer_info_t **link = bucket (timer->sink, timer->id);
+            while (*link != timer)
+                link = &(*link)->next_in_bucket;
+            *link = timer->next_in_bucket;
+            timer->next = spare;
+            spare = timer;
+            count--;
+
+            timer->sink->timer_event (timer->id);
+        }
+    }
+
+    //  There are no more timers.
+    if (!count)
+        return 0;
+
+    //  Find the first tick that has got timers to execute or to move down
+    //  the wheel. The timers moved down may expire later than that, in
+    //  which case we'll just wait again.
+    uint64_t next = (uint64_t) -1;
+    if (counts [0])
+        for (int i = 0; i != slots; i++)
+            if (wheel [0][(current + i) & (slots - 1)]) {
+                next = current + i;
+                break;
+            }
+    for (int level = 1; level != levels; level++) {
+        if (!counts [level])
+            continue;
+        int shift = slot_bits * level;
+        uint64_t block = (current + ((uint64_t) 1 << shift) - 1) >> shift;
+        for (int i = 0; i != slots; i++)
+            if (wheel [level][(block + i) & (slots - 1)]) {
+                if (((block + i) << shift) < next)
+                    next = (block + i) << shift;
+                break;
+            }
+    }
+    return next - now_;
+}
+
+size_t zmq::timer_wheel_t::size ()
+{
+    return count;
+}
+
+void zmq::timer_wheel_t::insert (timer_info_t *timer_)
+{
+    //  Timers that are already due go to the next tick.
+    uint64_t expiration = timer_->expiration;
+    if (expiration < current)
+        expiration = current;
+
+    //  Find the lowest level that covers the expiration time. Timers
+    //  beyond the range of the wheel are parked at its far end and put
+    //  back in place when they get there.
+    uint64_t delta = expiration - current;
+    int level = 0;
+    while (level != levels - 1 &&
+          delta >= (uint64_t) 1 << (slot_bits * (level + 1)))
+        level++;
+    if (delta >= (uint64_t) 1 << (slot_bits * levels))
+        expiration = current + ((uint64_t) 1 << (slot_bits * levels)) - 1;
+
+    int slot = (int) (expiration >> (slot_bits * level)) & (slots - 1);
+    timer_info_t **head = &wheel [level][slot];
+    timer_->next = *head;
+    if (timer_->next)
+        timer_->next->prev = &timer_->next;
+    timer_->prev = head;
+    *head = timer_;
+    timer_->level = level;
+    counts [level]++;
+}
+
+void zmq::timer_wheel_t::unlink (timer_info_t *timer_)
+{
+    *timer_->prev = timer_->next;
+    if (timer_->next)
+        timer_->next->prev = timer_->prev;
+    counts [timer_->level]--;
+}
+
+void zmq::timer_wheel_t::cascade (int level_, int slot_)
+{
+    timer_info_t *timer = wheel [level_][slot_];
+    wheel [level_][slot_] = NULL;
+    while (timer) {
+        timer_info_t *next = timer->next;
+        counts [level_]--;
+        insert (timer);
+        timer = next;
+    }
+}
+
+zmq::timer_wheel_t::timer_info_t **zmq::timer_wheel_t::bucket (
+    i_poll_events *sink_, int id_)
+{
+    size_t hash = (size_t) sink_ / sizeof (void*) * 31 + (size_t) id_;
+    hash ^= hash >> 16;
+    return &buckets [hash & (buckets.size () - 1)];
+}
+
+void zmq::timer_wheel_t::rehash ()
+{
+    buckets_t old (buckets.size () * 2);
+    buckets.swap (old);
+    for (buckets_t::size_type i = 0; i != old.size (); i++)
+        while (old [i]) {
+            timer_info_t *timer = old [i];
+            old [i] = timer->next_in_bucket;
+            timer_info_t **b = bucket (timer->sink, timer->id);
+            timer->next_in_bucket = *b;
+            *b = timer;
+        }
+}
@@ -0,0 +1,133 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef __ZMQ_TIMER_WHEEL_HPP_INCLUDED__
+#define __ZMQ_TIMER_WHEEL_HPP_INCLUDED__
+
+#include <stddef.h>
+#include <vector>
+
+#include "stdint.hpp"
+
+namespace zmq
+{
+
+    struct i_poll_events;
+
+    //  Hierarchical timer wheel with millisecond resolution. Adding and
+    //  cancelling a timer takes constant time, expiring timers takes
+    //  constant time per timer plus one step per elapsed millisecond when
+    //  there are timers due within the next 256 milliseconds.
+    //
+    //  The wheel has four levels of 256 slots each. A timer goes to the
+    //  lowest level able to hold its expiration time. Whenever a level has
+    //  gone round, the timers in the next slot of the level above are
+    //  moved down. Timers are found by their owner and ID using a hash
+    //  table, so no handle has to be kept by the caller.
+
+    class timer_wheel_t
+    {
+    public:
+
+        timer_wheel_t ();
+        ~timer_wheel_t ();
+
+        //  Adds a timer to expire timeout_ milliseconds after now_. On
+        //  expiration, timer_event will be called on sink_ with id_ as
+        //  the argument.
+        void add (uint64_t now_, int timeout_, zmq::i_poll_events *sink_,
+            int id_);
+
+        //  Cancels the timer created by sink_ object with ID equal to id_.
+        void cancel (zmq::i_poll_events *sink_, int id_);
+
+        //  Executes the timers due at now_. Returns the number of
+        //  milliseconds to wait before calling it again or 0 meaning
+        //  "no timers".
+        uint64_t execute (uint64_t now_);
+
+        //  Returns the number of active timers.
+        size_t size ();
+
+    private:
+
+        enum {
+            levels = 4,
+            slot_bits = 8,
+            slots = 1 << slot_bits
+        };
+
+        struct timer_info_t
+        {
+            zmq::i_poll_events *sink;
+            int id;
+            int level;
+            uint64_t expiration;
+
+            //  Slot list the timer belongs to. The prev pointer points to
+            //  the link pointing to the timer, so that the timer can be
+            //  removed without knowing the slot.
+            timer_info_t *next;
+            timer_info_t **prev;
+
+            //  Next timer in the same hash bucket.
+            timer_info_t *next_in_bucket;
+        };
+
+        //  Puts the timer into the slot matching its expiration time.
+        void insert (timer_info_t *timer_);
+
+        //  Takes the timer out of its slot.
+        void unlink (timer_info_t *timer_);
+
+        //  Moves the timers in the slot of the level down the wheel.
+        void cascade (int level_, int slot_);
+
+        //  Returns the bucket the timer with given owner and ID goes to.
+        timer_info_t **bucket (zmq::i_poll_events *sink_, int id_);
+
+        //  Doubles the size of the hash table.
+        void rehash ();
+
+        //  Time of the next tick to process.
+        uint64_t current;
+
+        //  Timers, by level and slot.
+        timer_info_t *wheel [levels][slots];
+
+        //  Number of timers on each level.
+        size_t counts [levels];
+
+        //  Number of timers in the wheel.
+        size_t count;
+
+        //  Hash table of the timers by owner and ID.
+        typedef std::vector <timer_info_t*> buckets_t;
+        buckets_t buckets;
+
+        //  Timers that can be reused.
+        timer_info_t *spare;
+
+        timer_wheel_t (const timer_wheel_t&);
+        const timer_wheel_t &operator = (const timer_wheel_t&);
+    };
+
+}
+
+#endif
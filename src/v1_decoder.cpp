@@ -32,8 +32,9 @@
 #include "wire.hpp"
 #include "err.hpp"
 
-zmq::v1_decoder_t::v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_) :
-    decoder_base_t <v1_decoder_t> (bufsize_),
+zmq::v1_decoder_t::v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_,
+      const allocator_t &allocator_) :
+    decoder_base_t <v1_decoder_t> (bufsize_, allocator_),
     maxmsgsize (maxmsgsize_)
 {
     int rc = in_progress.init ();
@@ -72,7 +73,7 @@ int zmq::v1_decoder_t::one_byte_size_ready ()
         //  in_progress is initialised at this point so in theory we should
         //  close it before calling zmq_msg_init_size, however, it's a 0-byte
         //  message and thus we can treat it as uninitialised...
-        int rc = in_progress.init_size (*tmpbuf - 1);
+        int rc = in_progress.init_size (*tmpbuf - 1, allocator);
         if (rc != 0) {
             errno_assert (errno == ENOMEM);
             rc = in_progress.init ();
@@ -115,7 +116,7 @@ int zmq::v1_decoder_t::eight_byte_size_ready ()
     //  in_progress is initialised at this point so in theory we should
     //  close it before calling init_size, however, it's a 0-byte
     //  message and thus we can treat it as uninitialised...
-    int rc = in_progress.init_size (msg_size);
+    int rc = in_progress.init_size (msg_size, allocator);
     if (rc != 0) {
         errno_assert (errno == ENOMEM);
         rc = in_progress.init ();
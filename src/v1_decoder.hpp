@@ -30,7 +30,8 @@ namespace zmq
     {
     public:
 
-        v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_);
+        v1_decoder_t (size_t bufsize_, int64_t maxmsgsize_,
+            const allocator_t &allocator_);
         ~v1_decoder_t ();
 
         virtual msg_t *msg () { return &in_progress; }
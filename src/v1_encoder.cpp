@@ -22,8 +22,9 @@
 #include "likely.hpp"
 #include "wire.hpp"
 
-zmq::v1_encoder_t::v1_encoder_t (size_t bufsize_) :
-    encoder_base_t <v1_encoder_t> (bufsize_)
+zmq::v1_encoder_t::v1_encoder_t (size_t bufsize_,
+      const allocator_t &allocator_) :
+    encoder_base_t <v1_encoder_t> (bufsize_, allocator_)
 {
     //  Write 0 bytes to the batch and go to message_ready state.
     next_step (NULL, 0, &v1_encoder_t::message_ready, true);
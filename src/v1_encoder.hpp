@@ -30,7 +30,7 @@ namespace zmq
     {
     public:
 
-        v1_encoder_t (size_t bufsize_);
+        v1_encoder_t (size_t bufsize_, const allocator_t &allocator_);
         ~v1_encoder_t ();
 
     private:
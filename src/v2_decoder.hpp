@@ -29,7 +29,8 @@ namespace zmq
     {
     public:
 
-        v2_decoder_t (size_t bufsize_, int64_t maxmsgsize_);
+        v2_decoder_t (size_t bufsize_, int64_t maxmsgsize_,
+            const allocator_t &allocator_);
         virtual ~v2_decoder_t ();
 
         //  i_decoder interface.
@@ -30,7 +30,7 @@ namespace zmq
     {
     public:
 
-        v2_encoder_t (size_t bufsize_);
+        v2_encoder_t (size_t bufsize_, const allocator_t &allocator_);
         virtual ~v2_encoder_t ();
 
     private:
@@ -35,12 +35,15 @@ namespace zmq
     //  N is granularity of the pipe, i.e. how many items are needed to
     //  perform next memory allocation.
 
-    template <typename T, int N> class ypipe_t : public ypipe_base_t <T>
+    template <typename T, int N, int M = N> class ypipe_t :
+        public ypipe_base_t <T>
     {
     public:
 
-        //  Initialises the pipe.
-        inline ypipe_t ()
+        //  Initialises the pipe. Memory for the items is allocated using
+        //  the supplied allocator.
+        inline ypipe_t (const allocator_t &allocator_ = allocator_t ()) :
+            queue (allocator_)
         {
             //  Insert terminator element into the queue.
             queue.push ();
@@ -180,7 +183,7 @@ namespace zmq
         //  Front of the queue points to the first prefetched item, back of
         //  the pipe points to last un-flushed item. Front is used only by
         //  reader thread, while back is used only by writer thread.
-        yqueue_t <T, N> queue;
+        yqueue_t <T, N, M> queue;
 
         //  Points to the first un-flushed item. This variable is used
         //  exclusively by writer thread.
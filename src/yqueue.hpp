@@ -25,13 +25,14 @@
 
 #include "err.hpp"
 #include "atomic_ptr.hpp"
+#include "allocator.hpp"
 
 namespace zmq
 {
 
     //  yqueue is an efficient queue implementation. The main goal is
     //  to minimise number of allocations/deallocations needed. Thus yqueue
-    //  allocates/deallocates elements in batches of N.
+    //  allocates/deallocates elements in batches.
     //
     //  yqueue allows one thread to use push/back function and another one 
     //  to use pop/front functions. However, user must ensure that there's no
@@ -41,16 +42,28 @@ namespace zmq
     //  T is the type of the object in the queue.
     //  N is granularity of the queue (how many pushes have to be done till
     //  actual memory allocation is required).
-
-    template <typename T, int N> class yqueue_t
+    //  M is the granularity the queue starts with. Each time the writer
+    //  runs out of space before the reader has released a chunk, new chunks
+    //  get twice as large, up to N elements. Once the reader has released a
+    //  chunk in the meantime several times in a row, i.e. it keeps up with
+    //  the writer, new chunks get half as large, down to M elements. A
+    //  released chunk is reused only if it has the current size, so that
+    //  the memory taken by a burst is returned once the queue calms down.
+    //  Thus queues that never fill up stay small while busy queues get to
+    //  allocate N elements at once.
+
+    template <typename T, int N, int M = N> class yqueue_t
     {
     public:
 
-        //  Create the queue.
-        inline yqueue_t ()
+        //  Create the queue. Chunks are allocated using the supplied
+        //  allocator.
+        inline yqueue_t (const allocator_t &allocator_ = allocator_t ()) :
+            chunk_size (M),
+            spare_count (0),
+            allocator (allocator_)
         {
-             begin_chunk = (chunk_t*) malloc (sizeof (chunk_t));
-             alloc_assert (begin_chunk);
+             begin_chunk = allocate_chunk (M);
              begin_pos = 0;
              back_chunk = NULL;
              back_pos = 0;
@@ -63,16 +76,17 @@ namespace zmq
         {
             while (true) {
                 if (begin_chunk == end_chunk) {
-                    free (begin_chunk);
+                    allocator.deallocate (begin_chunk);
                     break;
                 } 
                 chunk_t *o = begin_chunk;
                 begin_chunk = begin_chunk->next;
-                free (o);
+                allocator.deallocate (o);
             }
 
             chunk_t *sc = spare_chunk.xchg (NULL);
-            free (sc);
+            if (sc)
+                allocator.deallocate (sc);
         }
 
         //  Returns reference to the front element of the queue.
@@ -95,18 +109,33 @@ namespace zmq
             back_chunk = end_chunk;
             back_pos = end_pos;
 
-            if (++end_pos != N)
+            if (++end_pos != end_chunk->size)
                 return;
 
+            //  If there's a spare chunk the reader keeps up with the writer,
+            //  otherwise the queue grows. It shrinks only once the reader
+            //  has kept up for a while, so that a busy queue doesn't end up
+            //  with small chunks.
             chunk_t *sc = spare_chunk.xchg (NULL);
             if (sc) {
-                end_chunk->next = sc;
-                sc->prev = end_chunk;
-            } else {
-                end_chunk->next = (chunk_t*) malloc (sizeof (chunk_t));
-                alloc_assert (end_chunk->next);
-                end_chunk->next->prev = end_chunk;
+                if (++spare_count == shrink_count) {
+                    spare_count = 0;
+                    chunk_size = chunk_size / 2 < M ? M : chunk_size / 2;
+                }
+            }
+            else {
+                spare_count = 0;
+                chunk_size = chunk_size * 2 > N ? N : chunk_size * 2;
             }
+            if (sc && sc->size != chunk_size) {
+                allocator.deallocate (sc);
+                sc = NULL;
+            }
+            if (!sc)
+                sc = allocate_chunk (chunk_size);
+
+            end_chunk->next = sc;
+            sc->prev = end_chunk;
             end_chunk = end_chunk->next;
             end_pos = 0;
         }
@@ -124,8 +153,8 @@ namespace zmq
             if (back_pos)
                 --back_pos;
             else {
-                back_pos = N - 1;
                 back_chunk = back_chunk->prev;
+                back_pos = back_chunk->size - 1;
             }
 
             //  Now, move 'end' position backwards. Note that obsolete end chunk
@@ -135,9 +164,9 @@ namespace zmq
             if (end_pos)
                 --end_pos;
             else {
-                end_pos = N - 1;
                 end_chunk = end_chunk->prev;
-                free (end_chunk->next);
+                end_pos = end_chunk->size - 1;
+                allocator.deallocate (end_chunk->next);
                 end_chunk->next = NULL;
             }
         }
@@ -145,7 +174,7 @@ namespace zmq
         //  Removes an element from the front end of the queue.
         inline void pop ()
         {
-            if (++ begin_pos == N) {
+            if (++ begin_pos == begin_chunk->size) {
                 chunk_t *o = begin_chunk;
                 begin_chunk = begin_chunk->next;
                 begin_chunk->prev = NULL;
@@ -155,20 +184,32 @@ namespace zmq
                 //  so for cache reasons we'll get rid of the spare and
                 //  use 'o' as the spare.
                 chunk_t *cs = spare_chunk.xchg (o);
-                free (cs);
+                if (cs)
+                    allocator.deallocate (cs);
             }
         }
 
     private:
 
-        //  Individual memory chunk to hold N elements.
+        //  Individual memory chunk. It is allocated with enough room
+        //  to hold 'size' elements.
         struct chunk_t
         {
-             T values [N];
              chunk_t *prev;
              chunk_t *next;
+             int size;
+             T values [1];
         };
 
+        inline chunk_t *allocate_chunk (int size_)
+        {
+            chunk_t *chunk = (chunk_t*) allocator.allocate (
+                sizeof (chunk_t) + (size_ - 1) * sizeof (T));
+            alloc_assert (chunk);
+            chunk->size = size_;
+            return chunk;
+        }
+
         //  Back position may point to invalid memory if the queue is empty,
         //  while begin & end positions are always valid. Begin position is
         //  accessed exclusively be queue reader (front/pop), while back and
@@ -180,11 +221,24 @@ namespace zmq
         chunk_t *end_chunk;
         int end_pos;
 
+        //  Number of elements new chunks are allocated for and the number
+        //  of chunk boundaries in a row the writer found a spare chunk at.
+        //  Both are accessed by the writer only.
+        int chunk_size;
+        int spare_count;
+
+        //  Number of boundaries with a spare chunk after which new chunks
+        //  get smaller.
+        enum {shrink_count = 8};
+
         //  People are likely to produce and consume at similar rates.  In
         //  this scenario holding onto the most recently freed chunk saves
         //  us from having to call malloc/free.
         atomic_ptr_t<chunk_t> spare_chunk;
 
+        //  Allocator for the chunks.
+        const allocator_t allocator;
+
         //  Disable copying of yqueue.
         yqueue_t (const yqueue_t&);
         const yqueue_t &operator = (const yqueue_t&);
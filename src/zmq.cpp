@@ -66,15 +66,19 @@ struct iovec {
 
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <new>
 
 #include "proxy.hpp"
 #include "socket_base.hpp"
+#include "socket_poller.hpp"
+#include "loop.hpp"
 #include "stdint.hpp"
 #include "config.hpp"
 #include "likely.hpp"
 #include "clock.hpp"
 #include "ctx.hpp"
+#include "io_uring.hpp"
 #include "err.hpp"
 #include "msg.hpp"
 #include "fd.hpp"
@@ -116,6 +120,16 @@ int zmq_errno (void)
 
 void *zmq_ctx_new (void)
 {
+#if defined ZMQ_USE_IO_URING
+    //  The I/O threads can't run if the kernel doesn't support io_uring
+    //  well enough. Better to fail now than when the first socket is
+    //  created.
+    if (!zmq::io_uring_t::is_supported ()) {
+        errno = ENOTSUP;
+        return NULL;
+    }
+#endif
+
 #if defined ZMQ_HAVE_OPENPGM
 
     //  Init PGM transport. Ensure threading and timer are enabled. Find PGM
@@ -218,6 +232,16 @@ int zmq_ctx_get (void *ctx_, int option_)
     return ((zmq::ctx_t*) ctx_)->get (option_);
 }
 
+int zmq_ctx_set_allocator (void *ctx_, zmq_alloc_fn *alloc_fn_,
+    zmq_dealloc_fn *free_fn_, void *hint_)
+{
+    if (!ctx_ || !((zmq::ctx_t*) ctx_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::ctx_t*) ctx_)->set_allocator (alloc_fn_, free_fn_, hint_);
+}
+
 //  Stable/legacy context API
 
 void *zmq_init (int io_threads_)
@@ -365,13 +389,13 @@ int zmq_send (void *s_, const void *buf_, size_t len_, int flags_)
         errno = ENOTSOCK;
         return -1;
     }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
     zmq_msg_t msg;
-    int rc = zmq_msg_init_size (&msg, len_);
+    int rc = ((zmq::msg_t*) &msg)->init_size (len_, s->get_allocator ());
     if (rc != 0)
         return -1;
     memcpy (zmq_msg_data (&msg), buf_, len_);
 
-    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
     rc = s_sendmsg (s, &msg, flags_);
     if (unlikely (rc < 0)) {
         int err = errno;
@@ -452,6 +476,76 @@ int zmq_sendiov (void *s_, iovec *a_, size_t count_, int flags_)
     return rc; 
 }
 
+// Send multiple messages without copying the data.
+//
+// Same as zmq_sendiov, except that every element of the vector is sent
+// as a message referring to the caller's buffer. The ffn callback is
+// invoked exactly once for every element: once the message was written
+// to the network or dropped, or straight away if the element could not
+// be sent at all.
+//
+int zmq_sendiov_data (void *s_, iovec *a_, size_t count_, int flags_,
+    zmq_free_fn *ffn_, void *hint_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        for (size_t i = 0; i < count_; ++i)
+            if (ffn_)
+                ffn_ (a_[i].iov_base, hint_);
+        return -1;
+    }
+    int rc = 0;
+    zmq_msg_t msg;
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+
+    size_t i = 0;
+    for (; i < count_; ++i) {
+        rc = zmq_msg_init_data (&msg, a_[i].iov_base, a_[i].iov_len,
+            ffn_, hint_);
+        if (rc != 0) {
+            rc = -1;
+            break;
+        }
+        if (i == count_ - 1)
+            flags_ = flags_ & ~ZMQ_SNDMORE;
+        rc = s_sendmsg (s, &msg, flags_);
+        if (unlikely (rc < 0)) {
+            int err = errno;
+            int rc2 = zmq_msg_close (&msg);
+            errno_assert (rc2 == 0);
+            errno = err;
+            rc = -1;
+            ++i;
+            break;
+        }
+    }
+
+    //  Elements that were not handed over to the socket are released now.
+    if (rc < 0 && ffn_)
+        for (; i < count_; ++i)
+            ffn_ (a_[i].iov_base, hint_);
+    return rc;
+}
+
+// Send multiple messages at once.
+//
+// The messages are queued the same way zmq_msg_send does, except that
+// each pipe is flushed, and its reader woken up, at most once per call.
+// If flag bit ZMQ_SNDMORE is set the messages form a single multi-part
+// message. Returns the number of messages sent.
+//
+int zmq_sendmmsg (void *s_, zmq_msg_t *msgs_, size_t count_, int flags_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    if (count_ > INT_MAX)
+        count_ = INT_MAX;
+    return s->sendmmsg ((zmq::msg_t*) msgs_, (int) count_, flags_);
+}
+
 // Receiving functions.
 
 static int
@@ -594,6 +688,24 @@ int zmq_msg_send (zmq_msg_t *msg_, void *s_, int flags_)
     return result;
 }
 
+// Receive multiple messages at once.
+//
+// Waits for the first message the same way zmq_msg_recv does, then fills
+// the rest of the array with the messages that are already available.
+// Returns the number of messages received.
+//
+int zmq_recvmmsg (void *s_, zmq_msg_t *msgs_, size_t count_, int flags_)
+{
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    zmq::socket_base_t *s = (zmq::socket_base_t *) s_;
+    if (count_ > INT_MAX)
+        count_ = INT_MAX;
+    return s->recvmmsg ((zmq::msg_t*) msgs_, (int) count_, flags_);
+}
+
 int zmq_msg_recv (zmq_msg_t *msg_, void *s_, int flags_)
 {
     if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
@@ -1016,6 +1128,192 @@ int zmq_poll (zmq_pollitem_t *items_, int nitems_, long timeout_)
 #undef ZMQ_POLL_BASED_ON_POLL
 #endif
 
+//  Persistent poller
+
+void *zmq_poller_new (void)
+{
+    zmq::socket_poller_t *poller = new (std::nothrow) zmq::socket_poller_t;
+    alloc_assert (poller);
+    return poller;
+}
+
+int zmq_poller_destroy (void **poller_p_)
+{
+    if (!poller_p_ || !*poller_p_ ||
+          !((zmq::socket_poller_t*) *poller_p_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    delete (zmq::socket_poller_t*) *poller_p_;
+    *poller_p_ = NULL;
+    return 0;
+}
+
+int zmq_poller_add (void *poller_, void *s_, void *user_data_, short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->add (
+        (zmq::socket_base_t*) s_, user_data_, events_);
+}
+
+int zmq_poller_modify (void *poller_, void *s_, short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->modify (
+        (zmq::socket_base_t*) s_, events_);
+}
+
+int zmq_poller_remove (void *poller_, void *s_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->remove (
+        (zmq::socket_base_t*) s_);
+}
+
+int zmq_poller_add_fd (void *poller_, zmq_fd_t fd_, void *user_data_,
+    short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->add_fd (fd_, user_data_,
+        events_);
+}
+
+int zmq_poller_modify_fd (void *poller_, zmq_fd_t fd_, short events_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->modify_fd (fd_, events_);
+}
+
+int zmq_poller_remove_fd (void *poller_, zmq_fd_t fd_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->remove_fd (fd_);
+}
+
+int zmq_poller_wait (void *poller_, zmq_poller_event_t *event_,
+    long timeout_)
+{
+    int rc = zmq_poller_wait_all (poller_, event_, 1, timeout_);
+    return rc == -1 ? -1 : 0;
+}
+
+int zmq_poller_wait_all (void *poller_, zmq_poller_event_t *events_,
+    int n_events_, long timeout_)
+{
+    if (!poller_ || !((zmq::socket_poller_t*) poller_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::socket_poller_t*) poller_)->wait (events_, n_events_,
+        timeout_);
+}
+
+//  Reactor
+
+void *zmq_loop_new (void)
+{
+    zmq::loop_t *loop = new (std::nothrow) zmq::loop_t;
+    alloc_assert (loop);
+    return loop;
+}
+
+int zmq_loop_destroy (void **loop_p_)
+{
+    if (!loop_p_ || !*loop_p_ || !((zmq::loop_t*) *loop_p_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    delete (zmq::loop_t*) *loop_p_;
+    *loop_p_ = NULL;
+    return 0;
+}
+
+int zmq_loop_add (void *loop_, void *s_, zmq_loop_fn *handler_, void *arg_)
+{
+    if (!loop_ || !((zmq::loop_t*) loop_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::loop_t*) loop_)->add ((zmq::socket_base_t*) s_, handler_,
+        arg_);
+}
+
+int zmq_loop_remove (void *loop_, void *s_)
+{
+    if (!loop_ || !((zmq::loop_t*) loop_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    if (!s_ || !((zmq::socket_base_t*) s_)->check_tag ()) {
+        errno = ENOTSOCK;
+        return -1;
+    }
+    return ((zmq::loop_t*) loop_)->remove ((zmq::socket_base_t*) s_);
+}
+
+int zmq_loop_add_timer (void *loop_, int interval_, int times_,
+    zmq_timer_fn *handler_, void *arg_)
+{
+    if (!loop_ || !((zmq::loop_t*) loop_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::loop_t*) loop_)->start_timer (interval_, times_, handler_,
+        arg_);
+}
+
+int zmq_loop_cancel_timer (void *loop_, int timer_id_)
+{
+    if (!loop_ || !((zmq::loop_t*) loop_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::loop_t*) loop_)->stop_timer (timer_id_);
+}
+
+int zmq_loop_run (void *loop_)
+{
+    if (!loop_ || !((zmq::loop_t*) loop_)->check_tag ()) {
+        errno = EFAULT;
+        return -1;
+    }
+    return ((zmq::loop_t*) loop_)->run ();
+}
+
 //  The proxy functionality
 
 int zmq_proxy (void *frontend_, void *backend_, void *capture_)
@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Sizes of the messages sent, from much smaller to much larger than the
+//  buffers of the engines.
+static const size_t sizes [] = {
+    1, 100, 1000, 5000, 20000, 300000, 10, 8192, 70000, 3
+};
+static const int size_count = sizeof sizes / sizeof sizes [0];
+
+#define ROUNDS 100
+
+static void set_batching (void *socket_, int in_, int out_, int adaptive_)
+{
+    int rc = zmq_setsockopt (socket_, ZMQ_IN_BATCH_SIZE, &in_, sizeof in_);
+    assert (rc == 0);
+    rc = zmq_setsockopt (socket_, ZMQ_OUT_BATCH_SIZE, &out_, sizeof out_);
+    assert (rc == 0);
+    rc = zmq_setsockopt (socket_, ZMQ_ADAPTIVE_BATCH, &adaptive_,
+        sizeof adaptive_);
+    assert (rc == 0);
+}
+
+static void test_batching (void *ctx_, int in_, int out_, int adaptive_)
+{
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    set_batching (pull, in_, out_, adaptive_);
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    set_batching (push, in_, out_, adaptive_);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    //  Alternate bursts that back the connection up with messages sent
+    //  one at a time, so that adaptive buffers both grow and shrink.
+    unsigned char *data = (unsigned char*) malloc (300000);
+    assert (data);
+    unsigned char *buf = (unsigned char*) malloc (300000);
+    assert (buf);
+    for (int round = 0; round != ROUNDS; round++) {
+        int burst = round % 10 < 5 ? size_count : 1;
+        for (int i = 0; i != burst; i++) {
+            size_t size = round % 10 < 5 ? sizes [i] : 10;
+            fill_payload (data, size, round + i);
+            rc = zmq_send (push, data, size, 0);
+            assert (rc == (int) size);
+        }
+        for (int i = 0; i != burst; i++) {
+            size_t size = round % 10 < 5 ? sizes [i] : 10;
+            rc = zmq_recv (pull, buf, 300000, 0);
+            assert (rc == (int) size);
+            assert (check_payload (buf, size, round + i));
+        }
+    }
+    free (buf);
+    free (data);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s = zmq_socket (ctx, ZMQ_DEALER);
+    assert (s);
+    int value;
+    size_t size = sizeof value;
+    int rc = zmq_getsockopt (s, ZMQ_IN_BATCH_SIZE, &value, &size);
+    assert (rc == 0);
+    assert (value == 8192);
+    rc = zmq_getsockopt (s, ZMQ_OUT_BATCH_SIZE, &value, &size);
+    assert (rc == 0);
+    assert (value == 8192);
+    rc = zmq_getsockopt (s, ZMQ_ADAPTIVE_BATCH, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+
+    value = 0;
+    rc = zmq_setsockopt (s, ZMQ_IN_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (s, ZMQ_OUT_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 262145;
+    rc = zmq_setsockopt (s, ZMQ_IN_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (s, ZMQ_OUT_BATCH_SIZE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 2;
+    rc = zmq_setsockopt (s, ZMQ_ADAPTIVE_BATCH, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    //  Small and large fixed buffers, then adaptive ones starting from
+    //  either end.
+    test_batching (ctx, 1024, 1024, 0);
+    test_batching (ctx, 262144, 262144, 0);
+    test_batching (ctx, 100, 3000, 0);
+    test_batching (ctx, 1024, 1024, 1);
+    test_batching (ctx, 100, 3000, 1);
+    test_batching (ctx, 262144, 262144, 1);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
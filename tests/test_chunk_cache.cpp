@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Connects the peer to the address, passes enough messages through
+//  to make its queues grow, then closes it.
+static void churn_socket (void *push_, void *pull_, const char *address_)
+{
+    int rc = zmq_connect (push_, address_);
+    assert (rc == 0);
+
+    char buf [10];
+    for (int i = 0; i != 500; i++) {
+        rc = zmq_send (push_, "0123456789", 10, 0);
+        assert (rc == 10);
+    }
+    for (int i = 0; i != 500; i++) {
+        rc = zmq_recv (pull_, buf, sizeof buf, 0);
+        assert (rc == 10);
+    }
+
+    rc = zmq_close (push_);
+    assert (rc == 0);
+}
+
+//  Same as above, with a new peer.
+static void churn (void *ctx_, void *pull_, const char *address_)
+{
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    churn_socket (push, pull_, address_);
+}
+
+static void test_transport (const char *address_)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    int rc = zmq_ctx_set (ctx, ZMQ_CHUNK_CACHE, 64);
+    assert (rc == 0);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, address_);
+    assert (rc == 0);
+
+    for (int i = 0; i != 10; i++)
+        churn (ctx, pull, address_);
+
+    //  Chunks released by the earlier connections were reused.
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_HITS) > 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_MISSES) > 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_CHUNKS) > 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_CHUNKS) <=
+        zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE) * 8);
+
+    //  Shrinking the cache releases the superfluous chunks.
+    rc = zmq_ctx_set (ctx, ZMQ_CHUNK_CACHE, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_CHUNKS) <= 8);
+    churn (ctx, pull, address_);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_CHUNKS) <= 8);
+
+    //  Disabling the cache releases all the chunks. The message queues of
+    //  the sockets created before keep using it, but the chunks they release
+    //  are dropped.
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_ctx_set (ctx, ZMQ_CHUNK_CACHE, 0);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_CHUNKS) == 0);
+    int hits = zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_HITS);
+    churn_socket (push, pull, address_);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_HITS) == hits);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_CHUNKS) == 0);
+
+    //  The queues of the closed socket are released in the background.
+    for (int i = 0; i != 100 && !zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_DROPS); i++)
+        msleep (10);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_DROPS) > 0);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE) == 0);
+    int rc = zmq_ctx_set (ctx, ZMQ_CHUNK_CACHE, 16);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE) == 16);
+    rc = zmq_ctx_set (ctx, ZMQ_CHUNK_CACHE, -1);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_CHUNK_CACHE, 257);
+    assert (rc == -1 && errno == EINVAL);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_HITS) == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_MISSES) == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_DROPS) == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_CHUNK_CACHE_CHUNKS) == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_transport ("inproc://chunk_cache");
+    test_transport ("tcp://127.0.0.1:5566");
+
+    return 0;
+}
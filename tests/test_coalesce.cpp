@@ -0,0 +1,158 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#include <limits.h>
+
+//  Creates a connected PUSH/PULL pair, the PUSH socket coalescing its
+//  output as told.
+static void make_pair (void *ctx_, int delay_, int bytes_, void **push_,
+    void **pull_)
+{
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    int timeout = 2000;
+    int rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_setsockopt (push, ZMQ_COALESCE_DELAY, &delay_, sizeof delay_);
+    assert (rc == 0);
+    rc = zmq_setsockopt (push, ZMQ_COALESCE_BYTES, &bytes_, sizeof bytes_);
+    assert (rc == 0);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    //  Wait for the handshake to complete.
+    msleep (SETTLE_TIME);
+
+    *push_ = push;
+    *pull_ = pull;
+}
+
+static void close_pair (void *push_, void *pull_)
+{
+    int rc = zmq_close (push_);
+    assert (rc == 0);
+    rc = zmq_close (pull_);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    assert (s);
+    int value;
+    size_t size = sizeof value;
+    int rc = zmq_getsockopt (s, ZMQ_COALESCE_DELAY, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+    rc = zmq_getsockopt (s, ZMQ_COALESCE_BYTES, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+    value = -1;
+    rc = zmq_setsockopt (s, ZMQ_COALESCE_DELAY, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_setsockopt (s, ZMQ_COALESCE_BYTES, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    size = sizeof value;
+    rc = zmq_getsockopt (s, ZMQ_WRITE_CALLS, &value, &size);
+    assert (rc == -1 && errno == EINVAL);
+    assert (get_counter (s, ZMQ_WRITE_CALLS) == 0);
+    assert (get_counter (s, ZMQ_WRITE_MSGS) == 0);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    //  Messages sent a millisecond apart go out many per write when they
+    //  may wait up to 20 milliseconds for each other.
+    void *push;
+    void *pull;
+    make_pair (ctx, 20000, 0, &push, &pull);
+    uint64_t calls = get_counter (push, ZMQ_WRITE_CALLS);
+    uint64_t msgs = get_counter (push, ZMQ_WRITE_MSGS);
+    assert (msgs == 0);
+    const int count = 100;
+    for (int i = 0; i != count; i++) {
+        rc = zmq_send (push, "0123456789", 10, 0);
+        assert (rc == 10);
+        msleep (1);
+    }
+    char buf [10];
+    for (int i = 0; i != count; i++) {
+        rc = zmq_recv (pull, buf, sizeof buf, 0);
+        assert (rc == 10);
+    }
+    assert (get_counter (push, ZMQ_WRITE_MSGS) - msgs == count);
+    assert (get_counter (push, ZMQ_WRITE_CALLS) - calls <= count / 2);
+    close_pair (push, pull);
+
+    //  With the longest delay possible, messages are held back until there
+    //  are enough of them to reach the byte threshold. Each message takes
+    //  12 bytes on the wire, so 5 of them are not enough, while 9 of them
+    //  are.
+    make_pair (ctx, INT_MAX, 100, &push, &pull);
+    for (int i = 0; i != 5; i++) {
+        rc = zmq_send (push, "0123456789", 10, 0);
+        assert (rc == 10);
+    }
+    int timeout = 200;
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    rc = zmq_recv (pull, buf, sizeof buf, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    for (int i = 0; i != 4; i++) {
+        rc = zmq_send (push, "0123456789", 10, 0);
+        assert (rc == 10);
+    }
+    for (int i = 0; i != 9; i++) {
+        rc = zmq_recv (pull, buf, sizeof buf, 0);
+        assert (rc == 10);
+    }
+
+    //  Closing the socket writes a batch still held back.
+    rc = zmq_send (push, "0123456789", 10, 0);
+    assert (rc == 10);
+    msleep (SETTLE_TIME);
+    rc = zmq_close (push);
+    assert (rc == 0);
+    timeout = 2000;
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    rc = zmq_recv (pull, buf, sizeof buf, 0);
+    assert (rc == 10);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+
+    //  Check the defaults.
+    int value;
+    size_t size = sizeof value;
+    int rc = zmq_getsockopt (pull, ZMQ_INBOUND_POLL_RATE, &value, &size);
+    assert (rc == 0);
+    assert (value == 100);
+    rc = zmq_getsockopt (pull, ZMQ_MAX_COMMAND_DELAY, &value, &size);
+    assert (rc == 0);
+    assert (value == 3000000);
+    rc = zmq_getsockopt (pull, ZMQ_ADAPTIVE_THROTTLE, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+
+    //  Invalid values are rejected.
+    value = 0;
+    rc = zmq_setsockopt (pull, ZMQ_INBOUND_POLL_RATE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = -1;
+    rc = zmq_setsockopt (pull, ZMQ_MAX_COMMAND_DELAY, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 2;
+    rc = zmq_setsockopt (pull, ZMQ_ADAPTIVE_THROTTLE, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  The counters are read-only and 64-bit.
+    rc = zmq_setsockopt (pull, ZMQ_COMMAND_CHECKS, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    size = sizeof value;
+    rc = zmq_getsockopt (pull, ZMQ_COMMAND_CHECKS, &value, &size);
+    assert (rc == -1 && errno == EINVAL);
+
+    value = 10;
+    rc = zmq_setsockopt (pull, ZMQ_INBOUND_POLL_RATE, &value, sizeof value);
+    assert (rc == 0);
+    value = 1;
+    rc = zmq_setsockopt (pull, ZMQ_ADAPTIVE_THROTTLE, &value, sizeof value);
+    assert (rc == 0);
+    size = sizeof value;
+    rc = zmq_getsockopt (pull, ZMQ_INBOUND_POLL_RATE, &value, &size);
+    assert (rc == 0);
+    assert (value == 10);
+
+    //  Push enough messages through a small pipe that the sender keeps
+    //  hitting the high water mark and waiting for activation commands.
+    int hwm = 10;
+    rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "inproc://throttle");
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    value = 1;
+    rc = zmq_setsockopt (push, ZMQ_ADAPTIVE_THROTTLE, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_connect (push, "inproc://throttle");
+    assert (rc == 0);
+
+    uint64_t checks = get_counter (pull, ZMQ_COMMAND_CHECKS);
+    uint64_t processed = get_counter (pull, ZMQ_COMMANDS_PROCESSED);
+
+    const int count = 10000;
+    for (int i = 0; i != count; i++) {
+        rc = zmq_send (push, "x", 1, ZMQ_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            char buf [1];
+            while (zmq_recv (pull, buf, sizeof buf, ZMQ_DONTWAIT) == 1)
+                ;
+            i--;
+            continue;
+        }
+        assert (rc == 1);
+    }
+
+    //  Everything left in the pipe still arrives.
+    int timeout = 1000;
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    char buf [1];
+    while (zmq_recv (pull, buf, sizeof buf, 0) == 1)
+        ;
+    assert (errno == EAGAIN);
+
+    assert (get_counter (pull, ZMQ_COMMAND_CHECKS) > checks);
+    assert (get_counter (pull, ZMQ_COMMANDS_PROCESSED) > processed);
+    assert (get_counter (push, ZMQ_COMMANDS_PROCESSED) > 0);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+#include <pthread.h>
+
+//  Allocator that counts outstanding blocks and bytes. It is invoked from
+//  the application thread as well as from the I/O thread.
+struct arena_t
+{
+    pthread_mutex_t sync;
+    int allocs;
+    int frees;
+    size_t bytes;
+};
+
+//  Every block is preceded by its size, padded to keep the block aligned.
+union block_header_t
+{
+    size_t size;
+    double align;
+    void *ptr;
+};
+
+static void *arena_alloc (size_t size_, void *hint_)
+{
+    block_header_t *header =
+        (block_header_t*) malloc (sizeof (block_header_t) + size_);
+    if (!header)
+        return NULL;
+    header->size = size_;
+    arena_t *arena = (arena_t*) hint_;
+    pthread_mutex_lock (&arena->sync);
+    arena->allocs++;
+    arena->bytes += size_;
+    pthread_mutex_unlock (&arena->sync);
+    return header + 1;
+}
+
+static void arena_free (void *ptr_, void *hint_)
+{
+    block_header_t *header = (block_header_t*) ptr_ - 1;
+    arena_t *arena = (arena_t*) hint_;
+    pthread_mutex_lock (&arena->sync);
+    arena->frees++;
+    arena->bytes -= header->size;
+    pthread_mutex_unlock (&arena->sync);
+    free (header);
+}
+
+static void test_transport (const char *address_)
+{
+    arena_t arena;
+    pthread_mutex_init (&arena.sync, NULL);
+    arena.allocs = 0;
+    arena.frees = 0;
+    arena.bytes = 0;
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set_allocator (ctx, arena_alloc, arena_free, &arena);
+    assert (rc == 0);
+
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    rc = zmq_bind (sb, address_);
+    assert (rc == 0);
+
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, address_);
+    assert (rc == 0);
+
+    char buf [1000];
+    memset (buf, 'x', sizeof buf);
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_send (sc, buf, sizeof buf, 0);
+        assert (rc == sizeof buf);
+    }
+    for (int i = 0; i != 100; i++) {
+        rc = zmq_recv (sb, buf, sizeof buf, 0);
+        assert (rc == sizeof buf);
+    }
+    bounce (sb, sc);
+
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    //  Message bodies and pipes at least must have gone through the hooks,
+    //  and everything allocated must have been released.
+    assert (arena.allocs > 100);
+    assert (arena.allocs == arena.frees);
+    pthread_mutex_destroy (&arena.sync);
+}
+
+//  Once a burst is over and messages trickle through the pipe one by one,
+//  the pipe must give back the large chunks it allocated for the burst.
+static void test_shrink_after_burst ()
+{
+    arena_t arena;
+    pthread_mutex_init (&arena.sync, NULL);
+    arena.allocs = 0;
+    arena.frees = 0;
+    arena.bytes = 0;
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set_allocator (ctx, arena_alloc, arena_free, &arena);
+    assert (rc == 0);
+
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    rc = zmq_bind (sb, "inproc://shrink");
+    assert (rc == 0);
+
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, "inproc://shrink");
+    assert (rc == 0);
+
+    //  Small messages are stored inside the pipe chunks, so the arena
+    //  only sees the pipes.
+    char buf [8];
+    memset (buf, 'x', sizeof buf);
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_send (sc, buf, sizeof buf, 0);
+        assert (rc == sizeof buf);
+    }
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_recv (sb, buf, sizeof buf, 0);
+        assert (rc == sizeof buf);
+    }
+    pthread_mutex_lock (&arena.sync);
+    size_t after_burst = arena.bytes;
+    pthread_mutex_unlock (&arena.sync);
+
+    for (int i = 0; i != 10000; i++) {
+        rc = zmq_send (sc, buf, sizeof buf, 0);
+        assert (rc == sizeof buf);
+        rc = zmq_recv (sb, buf, sizeof buf, 0);
+        assert (rc == sizeof buf);
+    }
+    pthread_mutex_lock (&arena.sync);
+    size_t after_trickle = arena.bytes;
+    pthread_mutex_unlock (&arena.sync);
+    assert (after_trickle < after_burst / 4);
+
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    assert (arena.allocs == arena.frees);
+    assert (arena.bytes == 0);
+    pthread_mutex_destroy (&arena.sync);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    //  Both functions must be supplied, or none of them.
+    int rc = zmq_ctx_set_allocator (ctx, arena_alloc, NULL, NULL);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set_allocator (ctx, NULL, arena_free, NULL);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Custom allocator replaces the message pool.
+    rc = zmq_ctx_set (ctx, ZMQ_MSG_POOL, 1);
+    assert (rc == 0);
+    rc = zmq_ctx_set_allocator (ctx, arena_alloc, arena_free, NULL);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_MSG_POOL) == 0);
+    rc = zmq_ctx_set_allocator (ctx, NULL, NULL, NULL);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_transport ("inproc://allocator");
+    test_transport ("tcp://127.0.0.1:5561");
+    test_shrink_after_burst ();
+
+    return 0;
+}
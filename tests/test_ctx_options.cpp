@@ -18,6 +18,112 @@
 */
 
 #include "testutil.hpp"
+#include "../include/zmq_utils.h"
+
+#if defined ZMQ_HAVE_LINUX
+#include <sched.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+//  Returns the number of the process' threads using the policy.
+static int count_threads (int policy_)
+{
+    DIR *dir = opendir ("/proc/self/task");
+    assert (dir);
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir (dir)) != NULL) {
+        if (entry->d_name [0] == '.')
+            continue;
+        if (sched_getscheduler (atoi (entry->d_name)) == policy_)
+            count++;
+    }
+    int rc = closedir (dir);
+    assert (rc == 0);
+    return count;
+}
+
+//  Checks that the I/O thread and the reaper thread of a context take the
+//  policy once they start.
+static void test_thread_policy (int policy_)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_THREAD_SCHED_POLICY, policy_);
+    assert (rc == 0);
+    void *s = zmq_socket (ctx, ZMQ_PAIR);
+    assert (s);
+    for (int i = 0; count_threads (policy_) != 2; i++) {
+        assert (i != 100);
+        msleep (10);
+    }
+    rc = zmq_close (s);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+//  Returns true if the calling thread may use a real-time policy.
+static bool can_use_real_time ()
+{
+    int policy;
+    struct sched_param param;
+    int rc = pthread_getschedparam (pthread_self (), &policy, &param);
+    assert (rc == 0);
+    struct sched_param fifo_param;
+    fifo_param.sched_priority = sched_get_priority_min (SCHED_FIFO);
+    if (pthread_setschedparam (pthread_self (), SCHED_FIFO, &fifo_param) != 0)
+        return false;
+    rc = pthread_setschedparam (pthread_self (), policy, &param);
+    assert (rc == 0);
+    return true;
+}
+#endif
+
+//  A busy polling I/O thread doesn't let its timers run late: a message
+//  held back for 200 milliseconds is written on time even though the
+//  thread may spin for longer than that.
+static void test_busy_poll_timers ()
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_BUSY_POLL, 1000000);
+    assert (rc == 0);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int delay = 200000;
+    rc = zmq_setsockopt (push, ZMQ_COALESCE_DELAY, &delay, sizeof delay);
+    assert (rc == 0);
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    void *watch = zmq_stopwatch_start ();
+    rc = zmq_send (push, "0123456789", 10, 0);
+    assert (rc == 10);
+    char buf [10];
+    rc = zmq_recv (pull, buf, sizeof buf, 0);
+    assert (rc == 10);
+    unsigned long elapsed = zmq_stopwatch_stop (watch) / 1000;
+    assert (elapsed >= 190 && elapsed < 300);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
 
 int main (void)
 {
@@ -31,6 +137,7 @@ int main (void)
     assert (zmq_ctx_get (ctx, ZMQ_MAX_SOCKETS) == ZMQ_MAX_SOCKETS_DFLT);
     assert (zmq_ctx_get (ctx, ZMQ_IO_THREADS) == ZMQ_IO_THREADS_DFLT);
     assert (zmq_ctx_get (ctx, ZMQ_IPV6) == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_POLL_UPDATES_AVOIDED) == 0);
     
     rc = zmq_ctx_set (ctx, ZMQ_IPV6, true);
     assert (zmq_ctx_get (ctx, ZMQ_IPV6) == 1);
@@ -44,9 +151,170 @@ int main (void)
 
     rc = zmq_close (router);
     assert (rc == 0);
+
+    assert (zmq_ctx_get (ctx, ZMQ_SPIN_TIME) == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_SPIN_TIME, 100);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_SPIN_TIME) == 100);
+    rc = zmq_ctx_set (ctx, ZMQ_SPIN_TIME, -1);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Sockets spinning before blocking still get their messages.
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    rc = zmq_bind (sb, "inproc://spin");
+    assert (rc == 0);
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, "inproc://spin");
+    assert (rc == 0);
+    bounce (sb, sc);
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+
+    //  Traffic over TCP goes through the I/O thread pollers.
+    sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    rc = zmq_bind (sb, "tcp://127.0.0.1:5568");
+    assert (rc == 0);
+    sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, "tcp://127.0.0.1:5568");
+    assert (rc == 0);
+    bounce (sb, sc);
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+
+    //  With the high water marks this low, the connection keeps stopping
+    //  and resuming reading and writing. Changes to the polled events made
+    //  in the same iteration of the I/O thread's loop are merged.
+    int avoided = zmq_ctx_get (ctx, ZMQ_POLL_UPDATES_AVOIDED);
+    sb = zmq_socket (ctx, ZMQ_PULL);
+    assert (sb);
+    int hwm = 1;
+    rc = zmq_setsockopt (sb, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (sb, "tcp://127.0.0.1:5575");
+    assert (rc == 0);
+    sc = zmq_socket (ctx, ZMQ_PUSH);
+    assert (sc);
+    rc = zmq_setsockopt (sc, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_connect (sc, "tcp://127.0.0.1:5575");
+    assert (rc == 0);
+    int sent = 0;
+    int received = 0;
+    while (received != 10000) {
+        zmq_pollitem_t items [] = {
+            {sc, 0, (short) (sent != 10000 ? ZMQ_POLLOUT : 0), 0},
+            {sb, 0, ZMQ_POLLIN, 0}
+        };
+        rc = zmq_poll (items, 2, -1);
+        assert (rc > 0);
+        if (items [0].revents & ZMQ_POLLOUT) {
+            rc = zmq_send (sc, "x", 1, ZMQ_DONTWAIT);
+            assert (rc == 1);
+            sent++;
+        }
+        if (items [1].revents & ZMQ_POLLIN) {
+            char buf [1];
+            rc = zmq_recv (sb, buf, sizeof buf, ZMQ_DONTWAIT);
+            assert (rc == 1);
+            received++;
+        }
+    }
+    assert (zmq_ctx_get (ctx, ZMQ_POLL_UPDATES_AVOIDED) > avoided);
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
     
     rc = zmq_ctx_term (ctx);
     assert (rc == 0);
 
+    //  Thread scheduling options are validated up front.
+    ctx = zmq_ctx_new ();
+    assert (ctx);
+    assert (zmq_ctx_get (ctx, ZMQ_THREAD_SCHED_POLICY) ==
+        ZMQ_THREAD_SCHED_POLICY_DFLT);
+    assert (zmq_ctx_get (ctx, ZMQ_THREAD_PRIORITY) ==
+        ZMQ_THREAD_PRIORITY_DFLT);
+    assert (zmq_ctx_get (ctx, ZMQ_THREAD_AFFINITY_SPREAD) == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_THREAD_SCHED_POLICY, 12345);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_THREAD_PRIORITY, -2);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_THREAD_AFFINITY_CPU_REMOVE, 0);
+    assert (rc == -1 && errno == EINVAL);
+
+#if defined ZMQ_HAVE_LINUX
+    //  The priority has to suit the policy, whichever is set first.
+    void *other = zmq_ctx_new ();
+    assert (other);
+    rc = zmq_ctx_set (other, ZMQ_THREAD_SCHED_POLICY, SCHED_FIFO);
+    assert (rc == 0);
+    rc = zmq_ctx_set (other, ZMQ_THREAD_PRIORITY, 0);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (other, ZMQ_THREAD_PRIORITY, 1);
+    assert (rc == 0);
+    rc = zmq_ctx_set (other, ZMQ_THREAD_SCHED_POLICY, SCHED_OTHER);
+    assert (rc == -1 && errno == EINVAL);
+    assert (zmq_ctx_get (other, ZMQ_THREAD_SCHED_POLICY) == SCHED_FIFO);
+    rc = zmq_ctx_term (other);
+    assert (rc == 0);
+
+    //  The threads really run with the policy: SCHED_BATCH takes no
+    //  privileges, while a real-time policy, used without a priority,
+    //  does.
+#if defined SCHED_BATCH
+    test_thread_policy (SCHED_BATCH);
+#endif
+    if (can_use_real_time ())
+        test_thread_policy (SCHED_FIFO);
+
+    //  Threads pinned to the first CPU with the default policy, busy
+    //  polling, still carry the traffic.
+    rc = zmq_ctx_set (ctx, ZMQ_THREAD_SCHED_POLICY, SCHED_OTHER);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_THREAD_SCHED_POLICY) == SCHED_OTHER);
+    rc = zmq_ctx_set (ctx, ZMQ_THREAD_PRIORITY, 0);
+    assert (rc == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_THREAD_AFFINITY_CPU_ADD, 0);
+    assert (rc == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_THREAD_AFFINITY_SPREAD, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_THREAD_AFFINITY_SPREAD) == 1);
+    rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, 2);
+    assert (rc == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_IO_BUSY_POLL, -1);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_IO_BUSY_POLL, 100);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_IO_BUSY_POLL) == 100);
+
+    sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    rc = zmq_bind (sb, "tcp://127.0.0.1:5568");
+    assert (rc == 0);
+    sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, "tcp://127.0.0.1:5568");
+    assert (rc == 0);
+    bounce (sb, sc);
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+#endif
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_busy_poll_timers ();
+
     return 0;
 }
@@ -0,0 +1,129 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+//  Sizes of the messages sent, mixing parts that are copied to the output
+//  buffer with ones written in place.
+static const size_t sizes [] = {
+    10, 1000, 1024, 3000, 4096, 100, 8192, 20000, 70000, 1, 5000, 2048
+};
+static const int size_count = sizeof sizes / sizeof sizes [0];
+
+#define ROUNDS 50
+
+//  Returns the number of bytes the sending connection copied.
+static uint64_t test_threshold (void *ctx_, int threshold_)
+{
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    //  The listener of the previous round may still be closing, so each
+    //  round binds to a port of its own.
+    int rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (push);
+    if (threshold_ >= 0) {
+        rc = zmq_setsockopt (push, ZMQ_GATHER_THRESHOLD, &threshold_,
+            sizeof threshold_);
+        assert (rc == 0);
+    }
+    rc = zmq_connect (push, endpoint);
+    assert (rc == 0);
+
+    //  Queue everything before receiving so that the connection backs
+    //  up and batches are written partially.
+    unsigned char *data = (unsigned char*) malloc (70000);
+    assert (data);
+    for (int round = 0; round != ROUNDS; round++)
+        for (int i = 0; i != size_count; i++) {
+            fill_payload (data, sizes [i], round + i);
+            int flags = i % 3 == 0 ? ZMQ_SNDMORE : 0;
+            rc = zmq_send (push, data, sizes [i], flags);
+            assert (rc == (int) sizes [i]);
+        }
+
+    unsigned char *buf = (unsigned char*) malloc (70000);
+    assert (buf);
+    for (int round = 0; round != ROUNDS; round++)
+        for (int i = 0; i != size_count; i++) {
+            rc = zmq_recv (pull, buf, 70000, 0);
+            assert (rc == (int) sizes [i]);
+            assert (check_payload (buf, sizes [i], round + i));
+            int more;
+            size_t more_size = sizeof more;
+            rc = zmq_getsockopt (pull, ZMQ_RCVMORE, &more, &more_size);
+            assert (rc == 0);
+            assert (more == (i % 3 == 0));
+        }
+    free (buf);
+    free (data);
+
+    uint64_t copied = get_counter (push, ZMQ_WRITE_COPIED);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    return copied;
+}
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *s = zmq_socket (ctx, ZMQ_PUSH);
+    assert (s);
+    int value;
+    size_t size = sizeof value;
+    int rc = zmq_getsockopt (s, ZMQ_GATHER_THRESHOLD, &value, &size);
+    assert (rc == 0);
+    assert (value == 2048);
+    value = -1;
+    rc = zmq_setsockopt (s, ZMQ_GATHER_THRESHOLD, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_close (s);
+    assert (rc == 0);
+
+    //  Default, everything copied, small parts gathered too and nothing
+    //  but the largest parts gathered.
+    test_threshold (ctx, -1);
+    uint64_t copied = test_threshold (ctx, 0);
+    uint64_t gathered = test_threshold (ctx, 1);
+    test_threshold (ctx, 65536);
+
+    //  With everything gathered, only the frame headers of at most 9 bytes
+    //  and the two parts small enough to be stored within the message are
+    //  copied.
+    assert (gathered <= ROUNDS * (size_count * 9 + 10 + 1));
+    assert (copied > gathered);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,239 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+#if defined ZMQ_HAVE_LINUX
+#include <sys/socket.h>
+#include <linux/filter.h>
+#endif
+
+#define CLIENTS 50
+
+//  Without SO_REUSEPORT the endpoints aren't sharded.
+#if defined SO_REUSEPORT
+#define SHARDS 4
+#else
+#define SHARDS 1
+#endif
+
+//  Connects CLIENTS dealers to the endpoint and checks that the router
+//  hears from each of them.
+static void test_clients (void *ctx_, void *router_, const char *endpoint_)
+{
+    void *clients [CLIENTS];
+    for (int i = 0; i != CLIENTS; i++) {
+        clients [i] = zmq_socket (ctx_, ZMQ_DEALER);
+        assert (clients [i]);
+        int rc = zmq_connect (clients [i], endpoint_);
+        assert (rc == 0);
+        rc = zmq_send (clients [i], "hello", 5, 0);
+        assert (rc == 5);
+    }
+
+    for (int i = 0; i != CLIENTS; i++) {
+        char identity [256];
+        int rc = zmq_recv (router_, identity, sizeof identity, 0);
+        assert (rc > 0);
+        char buf [5];
+        rc = zmq_recv (router_, buf, sizeof buf, 0);
+        assert (rc == 5);
+        assert (memcmp (buf, "hello", 5) == 0);
+    }
+
+    for (int i = 0; i != CLIENTS; i++) {
+        int rc = zmq_close (clients [i]);
+        assert (rc == 0);
+    }
+}
+
+//  Returns the listening socket reported by the next event of the monitor.
+static int get_listening_fd (void *monitor_)
+{
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_msg_recv (&msg, monitor_, 0);
+    assert (rc == 6);
+    assert (zmq_msg_more (&msg));
+    uint16_t event;
+    memcpy (&event, zmq_msg_data (&msg), sizeof event);
+    assert (event == ZMQ_EVENT_LISTENING);
+    uint32_t fd;
+    memcpy (&fd, (char*) zmq_msg_data (&msg) + sizeof event, sizeof fd);
+    rc = zmq_msg_recv (&msg, monitor_, 0);
+    assert (rc > 0);
+    assert (!zmq_msg_more (&msg));
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    return (int) fd;
+}
+
+#if defined SO_ATTACH_REUSEPORT_CBPF
+//  Steers all the connections to the port of the listening socket to the
+//  shard_th socket bound to it. Returns false if the system can't do it.
+static bool steer_to_shard (int fd_, int shard_)
+{
+    struct sock_filter code [] = {
+        BPF_STMT (BPF_RET | BPF_K, (uint32_t) shard_)
+    };
+    struct sock_fprog prog;
+    prog.len = 1;
+    prog.filter = code;
+    return setsockopt (fd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog,
+        sizeof prog) == 0;
+}
+#endif
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, 4);
+    assert (rc == 0);
+
+    void *router = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (router);
+    int value;
+    size_t size = sizeof value;
+    rc = zmq_getsockopt (router, ZMQ_LISTENER_SHARDS, &value, &size);
+    assert (rc == 0);
+    assert (value == 1);
+    value = -1;
+    rc = zmq_setsockopt (router, ZMQ_LISTENER_SHARDS, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    int linger = 0;
+    rc = zmq_setsockopt (router, ZMQ_LINGER, &linger, sizeof linger);
+    assert (rc == 0);
+    int timeout = 5000;
+    rc = zmq_setsockopt (router, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+
+    //  A listener in each I/O thread, the port chosen by the system. Each
+    //  of them reports its socket to the monitor.
+    rc = zmq_socket_monitor (router, "inproc://monitor", ZMQ_EVENT_LISTENING);
+    assert (rc == 0);
+    void *monitor = zmq_socket (ctx, ZMQ_PAIR);
+    assert (monitor);
+    rc = zmq_connect (monitor, "inproc://monitor");
+    assert (rc == 0);
+    value = 0;
+    rc = zmq_setsockopt (router, ZMQ_LISTENER_SHARDS, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_bind (router, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (router, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+    int listeners [SHARDS];
+    for (int i = 0; i != SHARDS; i++)
+        listeners [i] = get_listening_fd (monitor);
+    rc = zmq_socket_monitor (router, NULL, 0);
+    assert (rc == 0);
+    rc = zmq_close (monitor);
+    assert (rc == 0);
+    for (int i = 0; i != SHARDS; i++)
+        for (int j = 0; j != i; j++)
+            assert (listeners [i] != listeners [j]);
+    test_clients (ctx, router, endpoint);
+
+#if defined SO_ATTACH_REUSEPORT_CBPF
+    //  Steering the connections to one shard after another shows that each
+    //  of them accepts.
+    for (int shard = 0; shard != SHARDS; shard++) {
+        if (!steer_to_shard (listeners [0], shard))
+            break;
+        test_clients (ctx, router, endpoint);
+    }
+#endif
+
+    //  Binding the shards fails as a whole if the port is taken.
+    void *other = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (other);
+    rc = zmq_setsockopt (other, ZMQ_LINGER, &linger, sizeof linger);
+    assert (rc == 0);
+
+    //  Shards of another endpoint don't get to share the port either.
+    value = 0;
+    rc = zmq_setsockopt (other, ZMQ_LISTENER_SHARDS, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_bind (other, endpoint);
+    assert (rc == -1 && errno == EADDRINUSE);
+    value = 1;
+    rc = zmq_setsockopt (other, ZMQ_LISTENER_SHARDS, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_bind (other, "tcp://127.0.0.1:5574");
+    assert (rc == 0);
+    rc = zmq_bind (router, "tcp://127.0.0.1:5574");
+    assert (rc == -1 && errno == EADDRINUSE);
+
+    //  Two listeners in the threads the affinity allows. Once unbound,
+    //  none of them holds on to the port.
+    rc = zmq_close (other);
+    assert (rc == 0);
+    value = 2;
+    rc = zmq_setsockopt (router, ZMQ_LISTENER_SHARDS, &value, sizeof value);
+    assert (rc == 0);
+    uint64_t affinity = 6;
+    rc = zmq_setsockopt (router, ZMQ_AFFINITY, &affinity, sizeof affinity);
+    assert (rc == 0);
+    for (int i = 0; ; i++) {
+        rc = zmq_bind (router, "tcp://127.0.0.1:5574");
+        if (rc == 0)
+            break;
+        assert (errno == EADDRINUSE && i != 100);
+        msleep (SETTLE_TIME);
+    }
+    test_clients (ctx, router, "tcp://127.0.0.1:5574");
+    rc = zmq_unbind (router, "tcp://127.0.0.1:5574");
+    assert (rc == 0);
+
+    other = zmq_socket (ctx, ZMQ_ROUTER);
+    assert (other);
+    for (int i = 0; ; i++) {
+        rc = zmq_bind (other, "tcp://127.0.0.1:5574");
+        if (rc == 0)
+            break;
+        assert (errno == EADDRINUSE && i != 100);
+        msleep (SETTLE_TIME);
+    }
+
+    //  With a single thread allowed, the one listener doesn't share its
+    //  port with shards of other sockets.
+    affinity = 2;
+    rc = zmq_setsockopt (router, ZMQ_AFFINITY, &affinity, sizeof affinity);
+    assert (rc == 0);
+    rc = zmq_bind (router, "tcp://127.0.0.1:5576");
+    assert (rc == 0);
+    rc = zmq_setsockopt (other, ZMQ_LISTENER_SHARDS, &value, sizeof value);
+    assert (rc == 0);
+    rc = zmq_bind (other, "tcp://127.0.0.1:5576");
+    assert (rc == -1 && errno == EADDRINUSE);
+    rc = zmq_close (other);
+    assert (rc == 0);
+
+    rc = zmq_close (router);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
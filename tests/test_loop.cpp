@@ -0,0 +1,198 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+struct counter_t
+{
+    int messages;
+    int limit;
+    void *last_socket;
+};
+
+//  Counts the messages and stops the loop once the limit is reached.
+static int count_messages (void *loop_, void *socket_, zmq_msg_t *msg_,
+    void *arg_)
+{
+    (void) loop_;
+    assert (zmq_msg_size (msg_) == 1);
+    counter_t *counter = (counter_t*) arg_;
+    counter->last_socket = socket_;
+    return ++counter->messages == counter->limit ? -1 : 0;
+}
+
+//  Removes the socket from the loop on the first message.
+static int remove_self (void *loop_, void *socket_, zmq_msg_t *msg_,
+    void *arg_)
+{
+    (void) msg_;
+    int rc = zmq_loop_remove (loop_, socket_);
+    assert (rc == 0);
+    (*(int*) arg_)++;
+    return 0;
+}
+
+//  Closes the socket on the first message.
+static int close_self (void *loop_, void *socket_, zmq_msg_t *msg_,
+    void *arg_)
+{
+    (void) loop_;
+    (void) msg_;
+    int rc = zmq_close (socket_);
+    assert (rc == 0);
+    (*(int*) arg_)++;
+    return 0;
+}
+
+//  Counts the expirations and stops the loop on the third.
+static int count_expirations (void *loop_, int timer_id_, void *arg_)
+{
+    (void) loop_;
+    (void) timer_id_;
+    return ++*(int*) arg_ == 3 ? -1 : 0;
+}
+
+//  Cancels the timer passed in.
+static int cancel_other (void *loop_, int timer_id_, void *arg_)
+{
+    (void) timer_id_;
+    int rc = zmq_loop_cancel_timer (loop_, *(int*) arg_);
+    assert (rc == 0);
+    return -1;
+}
+
+static int fail (void *loop_, int timer_id_, void *arg_)
+{
+    (void) loop_;
+    (void) timer_id_;
+    (void) arg_;
+    assert (false);
+    return -1;
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc;
+
+    void *loop = zmq_loop_new ();
+    assert (loop);
+
+    //  Invalid arguments.
+    rc = zmq_loop_run (ctx);
+    assert (rc == -1 && errno == EFAULT);
+    rc = zmq_loop_add (loop, loop, count_messages, NULL);
+    assert (rc == -1 && errno == ENOTSOCK);
+    rc = zmq_loop_add_timer (loop, 0, 1, count_expirations, NULL);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_loop_cancel_timer (loop, 1234);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  With nothing registered, the loop returns at once.
+    rc = zmq_loop_run (loop);
+    assert (rc == 0);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "inproc://loop");
+    assert (rc == 0);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_connect (push, "inproc://loop");
+    assert (rc == 0);
+
+    counter_t counter = {0, 1000, NULL};
+    rc = zmq_loop_add (loop, pull, count_messages, &counter);
+    assert (rc == 0);
+    rc = zmq_loop_add (loop, pull, count_messages, &counter);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  All the messages are handed over, more than a drain's worth.
+    for (int i = 0; i != 1000; i++) {
+        rc = zmq_send (push, "A", 1, 0);
+        assert (rc == 1);
+    }
+    rc = zmq_loop_run (loop);
+    assert (rc == 0);
+    assert (counter.messages == 1000);
+    assert (counter.last_socket == pull);
+
+    //  Timers fire the requested number of times.
+    int expirations = 0;
+    int timer = zmq_loop_add_timer (loop, 1, 0, count_expirations,
+        &expirations);
+    assert (timer > 0);
+    rc = zmq_loop_run (loop);
+    assert (rc == 0);
+    assert (expirations == 3);
+    rc = zmq_loop_cancel_timer (loop, timer);
+    assert (rc == 0);
+
+    //  A cancelled timer doesn't fire.
+    int later = zmq_loop_add_timer (loop, 50, 1, fail, NULL);
+    assert (later > 0);
+    timer = zmq_loop_add_timer (loop, 10, 1, cancel_other, &later);
+    assert (timer > 0);
+    rc = zmq_loop_run (loop);
+    assert (rc == 0);
+    rc = zmq_loop_cancel_timer (loop, timer);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  A handler can remove its socket; the loop then has nothing left to
+    //  wait for.
+    rc = zmq_loop_remove (loop, pull);
+    assert (rc == 0);
+    rc = zmq_loop_remove (loop, pull);
+    assert (rc == -1 && errno == EINVAL);
+    int removed = 0;
+    rc = zmq_loop_add (loop, pull, remove_self, &removed);
+    assert (rc == 0);
+    for (int i = 0; i != 2; i++) {
+        rc = zmq_send (push, "A", 1, 0);
+        assert (rc == 1);
+    }
+    rc = zmq_loop_run (loop);
+    assert (rc == 0);
+    assert (removed == 1);
+
+    //  Closing a socket removes it as well, even from within its handler.
+    int closed = 0;
+    rc = zmq_loop_add (loop, pull, close_self, &closed);
+    assert (rc == 0);
+    for (int i = 0; i != 2; i++) {
+        rc = zmq_send (push, "A", 1, 0);
+        assert (rc == 1);
+    }
+    rc = zmq_loop_run (loop);
+    assert (rc == 0);
+    assert (closed == 1);
+
+    rc = zmq_loop_destroy (&loop);
+    assert (rc == 0);
+    assert (loop == NULL);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
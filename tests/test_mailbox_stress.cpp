@@ -0,0 +1,110 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Many threads send to a single socket through pipes with a small high
+//  watermark, so that all of them keep posting commands to the mailbox of
+//  the receiving socket, and to the mailbox of the I/O thread with TCP.
+//  No command may get lost or reordered.
+
+#define THREAD_COUNT 16
+#define MESSAGE_COUNT 2000
+
+struct sender_t
+{
+    void *ctx;
+    const char *address;
+    int id;
+};
+
+static void sender (void *arg_)
+{
+    sender_t *args = (sender_t*) arg_;
+
+    void *push = zmq_socket (args->ctx, ZMQ_PUSH);
+    assert (push);
+    int hwm = 5;
+    int rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_connect (push, args->address);
+    assert (rc == 0);
+
+    for (int i = 0; i != MESSAGE_COUNT; i++) {
+        int data [2] = {args->id, i};
+        rc = zmq_send (push, data, sizeof data, 0);
+        assert (rc == sizeof data);
+    }
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+}
+
+static void test_transport (const char *address_)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int hwm = 5;
+    int rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (pull, address_);
+    assert (rc == 0);
+
+    sender_t args [THREAD_COUNT];
+    void *threads [THREAD_COUNT];
+    for (int i = 0; i != THREAD_COUNT; i++) {
+        args [i].ctx = ctx;
+        args [i].address = address_;
+        args [i].id = i;
+        threads [i] = zmq_threadstart (&sender, &args [i]);
+    }
+
+    int next [THREAD_COUNT];
+    for (int i = 0; i != THREAD_COUNT; i++)
+        next [i] = 0;
+    for (int i = 0; i != THREAD_COUNT * MESSAGE_COUNT; i++) {
+        int data [2];
+        rc = zmq_recv (pull, data, sizeof data, 0);
+        assert (rc == sizeof data);
+        assert (data [0] >= 0 && data [0] < THREAD_COUNT);
+        assert (data [1] == next [data [0]]);
+        next [data [0]]++;
+    }
+
+    for (int i = 0; i != THREAD_COUNT; i++)
+        zmq_threadclose (threads [i]);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    test_transport ("inproc://mailbox_stress");
+    test_transport ("tcp://127.0.0.1:5567");
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+static void fill (char *buf_, size_t size_)
+{
+    for (size_t i = 0; i != size_; i++)
+        buf_ [i] = (char) (i * 7 + size_);
+}
+
+static void check (zmq_msg_t *msg_, size_t size_)
+{
+    assert (zmq_msg_size (msg_) == size_);
+    char *data = (char*) zmq_msg_data (msg_);
+    for (size_t i = 0; i != size_; i++)
+        assert (data [i] == (char) (i * 7 + size_));
+}
+
+static void test_transport (const char *address_)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    int rc = zmq_ctx_set (ctx, ZMQ_MSG_POOL, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_MSG_POOL) == 1);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, address_);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_connect (push, address_);
+    assert (rc == 0);
+
+    //  Cover every size class as well as messages too large for the pool.
+    char *buf = (char*) malloc (300000);
+    assert (buf);
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    for (int round = 0; round != 3; round++) {
+        for (size_t size = 1; size <= 300000; size = size * 3 + 1) {
+            fill (buf, size);
+            rc = zmq_send (push, buf, size, 0);
+            assert (rc == (int) size);
+            rc = zmq_msg_recv (&msg, pull, 0);
+            assert (rc == (int) size);
+            check (&msg, size);
+        }
+    }
+
+    //  Keep the last message alive until all the threads of the context
+    //  are gone, so that its body is released to a dead cache.
+    fill (buf, 1000);
+    rc = zmq_send (push, buf, 1000, 0);
+    assert (rc == 1000);
+    rc = zmq_msg_recv (&msg, pull, 0);
+    assert (rc == 1000);
+    free (buf);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    check (&msg, 1000);
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    assert (zmq_ctx_get (ctx, ZMQ_MSG_POOL) == 0);
+    int rc = zmq_ctx_set (ctx, ZMQ_MSG_POOL, 1);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_MSG_POOL) == 1);
+    rc = zmq_ctx_set (ctx, ZMQ_MSG_POOL, 0);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_MSG_POOL) == 0);
+    rc = zmq_ctx_set (ctx, ZMQ_MSG_POOL, -1);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_transport ("inproc://msg_pool");
+    test_transport ("tcp://127.0.0.1:5560");
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Connects a PAIR socket to another one over inproc.
+static void create_pair (void *ctx_, const char *endpoint_, void **sb_,
+    void **sc_)
+{
+    *sb_ = zmq_socket (ctx_, ZMQ_PAIR);
+    assert (*sb_);
+    int rc = zmq_bind (*sb_, endpoint_);
+    assert (rc == 0);
+    *sc_ = zmq_socket (ctx_, ZMQ_PAIR);
+    assert (*sc_);
+    rc = zmq_connect (*sc_, endpoint_);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    int rc;
+
+    void *poller = zmq_poller_new ();
+    assert (poller);
+    zmq_poller_event_t event;
+
+    //  Invalid arguments.
+    rc = zmq_poller_wait (ctx, &event, 0);
+    assert (rc == -1 && errno == EFAULT);
+    rc = zmq_poller_add (poller, poller, NULL, ZMQ_POLLIN);
+    assert (rc == -1 && errno == ENOTSOCK);
+
+    //  An empty poller just times out.
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_poller_wait (poller, &event, 10);
+    assert (rc == -1 && errno == EAGAIN);
+
+    void *sb, *sc;
+    create_pair (ctx, "inproc://a", &sb, &sc);
+    rc = zmq_poller_add (poller, sb, sb, ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_poller_add (poller, sb, sb, ZMQ_POLLIN);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_poller_modify (poller, sc, ZMQ_POLLIN);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_poller_remove (poller, sc);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Nothing to receive yet.
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  A message makes the socket readable until it's received.
+    rc = zmq_send (sc, "A", 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, 1000);
+    assert (rc == 0);
+    assert (event.socket == sb);
+    assert (event.user_data == sb);
+    assert (event.events == ZMQ_POLLIN);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == 0);
+    assert (event.socket == sb);
+    char buf [1];
+    rc = zmq_recv (sb, buf, 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  Asking for writability as well.
+    rc = zmq_poller_modify (poller, sb, ZMQ_POLLIN | ZMQ_POLLOUT);
+    assert (rc == 0);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == 0);
+    assert (event.socket == sb);
+    assert (event.events == ZMQ_POLLOUT);
+    rc = zmq_poller_remove (poller, sb);
+    assert (rc == 0);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  A REP socket becomes writable by receiving the request, with no
+    //  command involved.
+    void *rep = zmq_socket (ctx, ZMQ_REP);
+    assert (rep);
+    rc = zmq_bind (rep, "inproc://rep");
+    assert (rc == 0);
+    void *req = zmq_socket (ctx, ZMQ_REQ);
+    assert (req);
+    rc = zmq_connect (req, "inproc://rep");
+    assert (rc == 0);
+    rc = zmq_poller_add (poller, rep, NULL, ZMQ_POLLOUT);
+    assert (rc == 0);
+    rc = zmq_send (req, "A", 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_recv (rep, buf, 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == 0);
+    assert (event.socket == rep);
+    assert (event.events == ZMQ_POLLOUT);
+
+    //  Of many registered sockets, only the ready ones are reported, and
+    //  the ones that don't fit are reported by the next wait.
+    const int count = 100;
+    void *bound [count];
+    void *connected [count];
+    for (int i = 0; i != count; i++) {
+        char endpoint [32];
+        sprintf (endpoint, "inproc://many-%d", i);
+        create_pair (ctx, endpoint, &bound [i], &connected [i]);
+        rc = zmq_poller_add (poller, bound [i], &bound [i], ZMQ_POLLIN);
+        assert (rc == 0);
+    }
+    rc = zmq_poller_remove (poller, rep);
+    assert (rc == 0);
+    for (int i = 0; i < count; i += 10) {
+        rc = zmq_send (connected [i], "A", 1, 0);
+        assert (rc == 1);
+    }
+    zmq_poller_event_t events [8];
+    int seen = 0;
+    while (seen != count / 10) {
+        rc = zmq_poller_wait_all (poller, events, 8, 1000);
+        assert (rc > 0 && rc <= 8);
+        for (int j = 0; j != rc; j++) {
+            void **item = (void**) events [j].user_data;
+            assert (*item == events [j].socket);
+            assert ((item - bound) % 10 == 0);
+            rc = zmq_recv (events [j].socket, buf, 1, 0);
+            assert (rc == 1);
+            seen++;
+        }
+    }
+    rc = zmq_poller_wait_all (poller, events, 8, 0);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  Plain file descriptors. The file descriptor of a socket becomes
+    //  readable when it gets a command.
+    void *fd_poller = zmq_poller_new ();
+    assert (fd_poller);
+    void *fb, *fc;
+    create_pair (ctx, "inproc://fd", &fb, &fc);
+    zmq_fd_t fd;
+    size_t fd_size = sizeof fd;
+    rc = zmq_getsockopt (fb, ZMQ_FD, &fd, &fd_size);
+    assert (rc == 0);
+    rc = zmq_poller_add_fd (fd_poller, fd, &fd, ZMQ_POLLIN);
+    assert (rc == 0);
+    rc = zmq_poller_add_fd (fd_poller, fd, &fd, ZMQ_POLLIN);
+    assert (rc == -1 && errno == EINVAL);
+    int events_flags;
+    size_t events_size = sizeof events_flags;
+    rc = zmq_getsockopt (fb, ZMQ_EVENTS, &events_flags, &events_size);
+    assert (rc == 0);
+    rc = zmq_send (fc, "A", 1, 0);
+    assert (rc == 1);
+    rc = zmq_poller_wait (fd_poller, &event, 1000);
+    assert (rc == 0);
+    assert (event.socket == NULL);
+    assert (event.fd == fd);
+    assert (event.user_data == &fd);
+    assert (event.events & ZMQ_POLLIN);
+    rc = zmq_poller_modify_fd (fd_poller, fd, 0);
+    assert (rc == 0);
+    rc = zmq_poller_wait (fd_poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_poller_remove_fd (fd_poller, fd);
+    assert (rc == 0);
+    rc = zmq_poller_remove_fd (fd_poller, fd);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_poller_destroy (&fd_poller);
+    assert (rc == 0);
+    assert (fd_poller == NULL);
+
+    //  Closing a socket removes it from the poller, and destroying the
+    //  poller removes the remaining sockets.
+    rc = zmq_close (bound [0]);
+    assert (rc == 0);
+    rc = zmq_poller_wait (poller, &event, 0);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_poller_destroy (&poller);
+    assert (rc == 0);
+    rc = zmq_poller_destroy (&poller);
+    assert (rc == -1 && errno == EFAULT);
+
+    for (int i = 1; i != count; i++) {
+        rc = zmq_close (bound [i]);
+        assert (rc == 0);
+    }
+    for (int i = 0; i != count; i++) {
+        rc = zmq_close (connected [i]);
+        assert (rc == 0);
+    }
+    void *sockets [] = {sb, sc, rep, req, fb, fc};
+    for (int i = 0; i != 6; i++) {
+        rc = zmq_close (sockets [i]);
+        assert (rc == 0);
+    }
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
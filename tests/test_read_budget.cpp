@@ -0,0 +1,163 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+
+#include <limits.h>
+
+#define THIN_CONNECTIONS 4
+#define THIN_MESSAGES 100
+#define FAT_MESSAGES 2000
+#define FAT_MESSAGE_SIZE 4096
+
+//  Streams large messages over one connection and small ones over the
+//  others to a PULL socket with the read budget given, and returns the
+//  number of times its connections yielded to one another. The low high
+//  water mark keeps the fat connection stopping and resuming, so that it
+//  resumes with plenty of data waiting to be read.
+static uint64_t test_stream (void *ctx_, int budget_, int budget_msgs_)
+{
+    void *pull = zmq_socket (ctx_, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_setsockopt (pull, ZMQ_READ_BUDGET, &budget_, sizeof budget_);
+    assert (rc == 0);
+    rc = zmq_setsockopt (pull, ZMQ_READ_BUDGET_MSGS, &budget_msgs_,
+        sizeof budget_msgs_);
+    assert (rc == 0);
+    int hwm = 100;
+    rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:*");
+    assert (rc == 0);
+    char endpoint [256];
+    size_t endpoint_size = sizeof endpoint;
+    rc = zmq_getsockopt (pull, ZMQ_LAST_ENDPOINT, endpoint, &endpoint_size);
+    assert (rc == 0);
+
+    void *fat = zmq_socket (ctx_, ZMQ_PUSH);
+    assert (fat);
+    rc = zmq_connect (fat, endpoint);
+    assert (rc == 0);
+
+    void *thin [THIN_CONNECTIONS];
+    for (int i = 0; i != THIN_CONNECTIONS; i++) {
+        thin [i] = zmq_socket (ctx_, ZMQ_PUSH);
+        assert (thin [i]);
+        rc = zmq_connect (thin [i], endpoint);
+        assert (rc == 0);
+    }
+
+    //  Every message from every connection arrives intact.
+    unsigned char fat_msg [FAT_MESSAGE_SIZE];
+    fill_payload (fat_msg, sizeof fat_msg, 0);
+    unsigned char buf [FAT_MESSAGE_SIZE];
+    int fat_sent = 0;
+    int thin_sent = 0;
+    int fat_count = 0;
+    int thin_count = 0;
+    while (fat_count + thin_count != FAT_MESSAGES +
+          THIN_CONNECTIONS * THIN_MESSAGES) {
+        while (fat_sent != FAT_MESSAGES &&
+              zmq_send (fat, fat_msg, sizeof fat_msg, ZMQ_DONTWAIT) ==
+              FAT_MESSAGE_SIZE)
+            fat_sent++;
+        if (thin_sent != THIN_MESSAGES) {
+            for (int i = 0; i != THIN_CONNECTIONS; i++) {
+                rc = zmq_send (thin [i], "T", 1, 0);
+                assert (rc == 1);
+            }
+            thin_sent++;
+        }
+        rc = zmq_recv (pull, buf, sizeof buf, 0);
+        if (rc == FAT_MESSAGE_SIZE) {
+            assert (check_payload (buf, sizeof buf, 0));
+            fat_count++;
+        }
+        else {
+            assert (rc == 1);
+            assert (buf [0] == 'T');
+            thin_count++;
+        }
+    }
+    assert (fat_count == FAT_MESSAGES);
+    assert (thin_count == THIN_CONNECTIONS * THIN_MESSAGES);
+
+    uint64_t yields = get_counter (pull, ZMQ_READ_YIELDS);
+
+    for (int i = 0; i != THIN_CONNECTIONS; i++) {
+        rc = zmq_close (thin [i]);
+        assert (rc == 0);
+    }
+    rc = zmq_close (fat);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+
+    return yields;
+}
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+
+    //  Check the defaults and reject invalid values.
+    int value;
+    size_t size = sizeof value;
+    int rc = zmq_getsockopt (pull, ZMQ_READ_BUDGET, &value, &size);
+    assert (rc == 0);
+    assert (value == 8192);
+    rc = zmq_getsockopt (pull, ZMQ_READ_BUDGET_MSGS, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+    assert (get_counter (pull, ZMQ_READ_YIELDS) == 0);
+
+    value = 0;
+    rc = zmq_setsockopt (pull, ZMQ_READ_BUDGET, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = -1;
+    rc = zmq_setsockopt (pull, ZMQ_READ_BUDGET_MSGS, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 16;
+    rc = zmq_setsockopt (pull, ZMQ_READ_BUDGET_MSGS, &value, sizeof value);
+    assert (rc == 0);
+    size = sizeof value;
+    rc = zmq_getsockopt (pull, ZMQ_READ_BUDGET_MSGS, &value, &size);
+    assert (rc == 0);
+    assert (value == 16);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+
+    //  All the connections share the one I/O thread. Without a budget the
+    //  fat connection reads on for as long as it has data, never letting
+    //  the thin ones in; with a budget of a few messages it has to yield.
+    assert (test_stream (ctx, INT_MAX, 0) == 0);
+    assert (test_stream (ctx, INT_MAX, 16) > 0);
+    assert (test_stream (ctx, FAT_MESSAGE_SIZE * 4, 0) > 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+//  Traffic goes over half of the connections only, so that the I/O threads
+//  get to move sessions around. Messages must keep flowing, in order, while
+//  the sessions move.
+
+#define SENDER_COUNT 4
+#define MIN_ROUNDS 20000
+#define MAX_ROUNDS 100000
+
+int main (void)
+{
+    setup_test_environment ();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    assert (zmq_ctx_get (ctx, ZMQ_REBALANCE_IVL) == 0);
+    int rc = zmq_ctx_set (ctx, ZMQ_REBALANCE_IVL, -1);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_ctx_set (ctx, ZMQ_REBALANCE_IVL, 10);
+    assert (rc == 0);
+    assert (zmq_ctx_get (ctx, ZMQ_REBALANCE_IVL) == 10);
+    rc = zmq_ctx_set (ctx, ZMQ_IO_THREADS, 2);
+    assert (rc == 0);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5569");
+    assert (rc == 0);
+
+    void *push [SENDER_COUNT];
+    for (int i = 0; i != SENDER_COUNT; i++) {
+        push [i] = zmq_socket (ctx, ZMQ_PUSH);
+        assert (push [i]);
+        rc = zmq_connect (push [i], "tcp://127.0.0.1:5569");
+        assert (rc == 0);
+    }
+
+    int expected [SENDER_COUNT] = {0};
+    for (int round = 0; round != MAX_ROUNDS; round++) {
+        if (round >= MIN_ROUNDS && zmq_ctx_get (ctx, ZMQ_MIGRATIONS) > 0)
+            break;
+        for (int i = 0; i < SENDER_COUNT; i += 2) {
+            int data [2] = {i, round};
+            rc = zmq_send (push [i], data, sizeof data, 0);
+            assert (rc == sizeof data);
+        }
+        for (int i = 0; i < SENDER_COUNT; i += 2) {
+            int data [2];
+            rc = zmq_recv (pull, data, sizeof data, 0);
+            assert (rc == sizeof data);
+            assert (data [0] >= 0 && data [0] < SENDER_COUNT);
+            assert (data [1] == expected [data [0]]);
+            expected [data [0]]++;
+        }
+    }
+    assert (zmq_ctx_get (ctx, ZMQ_MIGRATIONS) > 0);
+
+    //  All the connections, moved or not, still pass messages.
+    int timeout = 5000;
+    rc = zmq_setsockopt (pull, ZMQ_RCVTIMEO, &timeout, sizeof timeout);
+    assert (rc == 0);
+    for (int round = 0; round != 100; round++) {
+        for (int i = 0; i != SENDER_COUNT; i++) {
+            int data [2] = {i, expected [i] + round};
+            rc = zmq_send (push [i], data, sizeof data, 0);
+            assert (rc == sizeof data);
+        }
+    }
+    for (int n = 0; n != 100 * SENDER_COUNT; n++) {
+        int data [2];
+        rc = zmq_recv (pull, data, sizeof data, 0);
+        assert (rc == sizeof data);
+        assert (data [0] >= 0 && data [0] < SENDER_COUNT);
+        assert (data [1] == expected [data [0]]);
+        expected [data [0]]++;
+    }
+
+    for (int i = 0; i != SENDER_COUNT; i++) {
+        rc = zmq_close (push [i]);
+        assert (rc == 0);
+    }
+    rc = zmq_close (pull);
+    assert (rc == 0);
+
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
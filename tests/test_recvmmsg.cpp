@@ -0,0 +1,219 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+const int batch_size = 16;
+
+//  Every message consists of 'parts' parts carrying the sender number,
+//  the sequence number and the part number.
+static void send_msg (void *s_, int sender_, int seq_, int parts_)
+{
+    for (int part = 0; part != parts_; part++) {
+        int data [3] = {sender_, seq_, part};
+        int rc = zmq_send (s_, data, sizeof data,
+            part == parts_ - 1 ? ZMQ_DONTWAIT : ZMQ_DONTWAIT | ZMQ_SNDMORE);
+        assert (rc == sizeof data);
+    }
+}
+
+static void test_pull (const char *address_)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, address_);
+    assert (rc == 0);
+
+    void *push [2];
+    for (int i = 0; i != 2; i++) {
+        push [i] = zmq_socket (ctx, ZMQ_PUSH);
+        assert (push [i]);
+        rc = zmq_connect (push [i], address_);
+        assert (rc == 0);
+    }
+    msleep (SETTLE_TIME);
+
+    zmq_msg_t msgs [batch_size];
+    for (int i = 0; i != batch_size; i++) {
+        rc = zmq_msg_init (&msgs [i]);
+        assert (rc == 0);
+    }
+
+    //  Nothing to receive yet.
+    rc = zmq_recvmmsg (pull, msgs, batch_size, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+    rc = zmq_recvmmsg (pull, msgs, 0, 0);
+    assert (rc == -1 && errno == EINVAL);
+
+    //  Multipart messages of 3 parts from both senders.
+    const int msg_count = 100;
+    for (int seq = 0; seq != msg_count; seq++)
+        for (int sender = 0; sender != 2; sender++)
+            send_msg (push [sender], sender, seq, 3);
+    msleep (SETTLE_TIME);
+
+    int next_seq [2] = {0, 0};
+    int next_part [2] = {0, 0};
+    int current = -1;
+    int received = 0;
+    while (received != msg_count * 2 * 3) {
+        rc = zmq_recvmmsg (pull, msgs, batch_size, 0);
+        assert (rc > 0 && rc <= batch_size);
+        for (int i = 0; i != rc; i++) {
+            assert (zmq_msg_size (&msgs [i]) == 3 * sizeof (int));
+            int data [3];
+            memcpy (data, zmq_msg_data (&msgs [i]), sizeof data);
+            const int sender = data [0];
+            assert (sender == 0 || sender == 1);
+
+            //  Parts of a message are never interleaved with other messages.
+            if (current != -1)
+                assert (sender == current);
+            assert (data [1] == next_seq [sender]);
+            assert (data [2] == next_part [sender]);
+            assert (zmq_msg_more (&msgs [i]) == (data [2] != 2));
+            if (++next_part [sender] == 3) {
+                next_part [sender] = 0;
+                next_seq [sender]++;
+                current = -1;
+            }
+            else
+                current = sender;
+        }
+
+        //  ZMQ_RCVMORE reflects the last message received.
+        int more;
+        size_t more_size = sizeof more;
+        rc = zmq_getsockopt (pull, ZMQ_RCVMORE, &more, &more_size);
+        assert (rc == 0);
+        assert (more == (current != -1));
+
+        received = (next_seq [0] + next_seq [1]) * 3 + next_part [0] +
+            next_part [1];
+    }
+    assert (next_seq [0] == msg_count && next_seq [1] == msg_count);
+
+    //  Interleave sending and receiving of more messages than the high
+    //  watermark so that the senders have to be reactivated.
+    int sent = 0;
+    received = 0;
+    const int total = 10000;
+    while (received != total) {
+        while (sent != total) {
+            int data [3] = {0, sent, 0};
+            rc = zmq_send (push [0], data, sizeof data, ZMQ_DONTWAIT);
+            if (rc == -1) {
+                assert (errno == EAGAIN);
+                break;
+            }
+            sent++;
+        }
+        //  Commands are processed by the sender only once in a while, so
+        //  don't wait for messages it may not have sent yet.
+        rc = zmq_recvmmsg (pull, msgs, batch_size, ZMQ_DONTWAIT);
+        if (rc == -1) {
+            assert (errno == EAGAIN);
+            continue;
+        }
+        for (int i = 0; i != rc; i++) {
+            int data [3];
+            memcpy (data, zmq_msg_data (&msgs [i]), sizeof data);
+            assert (data [1] == received);
+            received++;
+        }
+    }
+
+    for (int i = 0; i != batch_size; i++) {
+        rc = zmq_msg_close (&msgs [i]);
+        assert (rc == 0);
+    }
+
+    for (int i = 0; i != 2; i++) {
+        rc = zmq_close (push [i]);
+        assert (rc == 0);
+    }
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    test_pull ("inproc://recvmmsg");
+    test_pull ("tcp://127.0.0.1:5563");
+
+    //  Socket types without a batched implementation.
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    zmq_msg_t msg;
+    int rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    rc = zmq_recvmmsg (push, &msg, 1, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == ENOTSUP);
+
+    void *sb = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sb);
+    rc = zmq_bind (sb, "inproc://recvmmsg_pair");
+    assert (rc == 0);
+    void *sc = zmq_socket (ctx, ZMQ_PAIR);
+    assert (sc);
+    rc = zmq_connect (sc, "inproc://recvmmsg_pair");
+    assert (rc == 0);
+    for (int i = 0; i != 5; i++) {
+        rc = zmq_send (sc, &i, sizeof i, 0);
+        assert (rc == sizeof i);
+    }
+    //  Messages that are not filled in are emptied.
+    zmq_msg_t msgs [10];
+    for (int i = 0; i != 10; i++) {
+        rc = zmq_msg_init_size (&msgs [i], 100);
+        assert (rc == 0);
+    }
+    rc = zmq_recvmmsg (sb, msgs, 10, 0);
+    assert (rc == 5);
+    for (int i = 0; i != 10; i++) {
+        if (i < 5)
+            assert (*(int*) zmq_msg_data (&msgs [i]) == i);
+        else
+            assert (zmq_msg_size (&msgs [i]) == 0);
+        rc = zmq_msg_close (&msgs [i]);
+        assert (rc == 0);
+    }
+
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+    rc = zmq_close (sc);
+    assert (rc == 0);
+    rc = zmq_close (sb);
+    assert (rc == 0);
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    return 0;
+}
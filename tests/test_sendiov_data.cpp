@@ -0,0 +1,124 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+// XSI vector I/O
+#if defined ZMQ_HAVE_UIO
+#include <sys/uio.h>
+#else
+struct iovec {
+    void *iov_base;
+    size_t iov_len;
+};
+#endif
+
+//  Mix of parts copied to the output buffer and parts written in place.
+static const size_t sizes [] = {5, 100, 2000, 300000, 10, 70000, 1024, 1023};
+static const size_t part_count = sizeof sizes / sizeof sizes [0];
+
+//  Number of buffers released. The callback is invoked from the I/O thread,
+//  so it is only checked once the context is terminated.
+static int released;
+
+static void release (void *data_, void *hint_)
+{
+    assert (hint_ == &released);
+    free (data_);
+    released++;
+}
+
+static void fill (iovec *iov_, int round_)
+{
+    for (size_t i = 0; i != part_count; i++) {
+        iov_ [i].iov_len = sizes [i];
+        iov_ [i].iov_base = malloc (sizes [i]);
+        assert (iov_ [i].iov_base);
+        memset (iov_ [i].iov_base, 'a' + (round_ + i) % 26, sizes [i]);
+    }
+}
+
+static void test_transport (const char *address_)
+{
+    released = 0;
+
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    int rc = zmq_bind (pull, address_);
+    assert (rc == 0);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    rc = zmq_connect (push, address_);
+    assert (rc == 0);
+
+    //  Failed sends release the buffers straight away.
+    iovec iov [part_count];
+    fill (iov, 0);
+    rc = zmq_sendiov_data (pull, iov, part_count, 0, release, &released);
+    assert (rc == -1 && errno == ENOTSUP);
+    assert (released == (int) part_count);
+
+    const int rounds = 20;
+    for (int round = 0; round != rounds; round++) {
+        fill (iov, round);
+        rc = zmq_sendiov_data (push, iov, part_count, ZMQ_SNDMORE,
+            release, &released);
+        assert (rc == (int) sizes [part_count - 1]);
+    }
+
+    zmq_msg_t msg;
+    rc = zmq_msg_init (&msg);
+    assert (rc == 0);
+    for (int round = 0; round != rounds; round++) {
+        for (size_t i = 0; i != part_count; i++) {
+            rc = zmq_msg_recv (&msg, pull, 0);
+            assert (rc == (int) sizes [i]);
+            const char *data = (const char*) zmq_msg_data (&msg);
+            for (size_t j = 0; j != sizes [i]; j++)
+                assert (data [j] == 'a' + (round + (int) i) % 26);
+            assert (zmq_msg_more (&msg) == (i != part_count - 1));
+        }
+    }
+    rc = zmq_msg_close (&msg);
+    assert (rc == 0);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    assert (released == (int) part_count * (rounds + 1));
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    test_transport ("inproc://sendiov_data");
+    test_transport ("tcp://127.0.0.1:5562");
+    test_transport ("ipc:///tmp/test_sendiov_data");
+
+    return 0;
+}
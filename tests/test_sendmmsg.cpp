@@ -0,0 +1,174 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "testutil.hpp"
+
+const int batch_size = 100;
+
+static void init_batch (zmq_msg_t *msgs_, int first_, int count_)
+{
+    for (int i = 0; i != count_; i++) {
+        int rc = zmq_msg_init_size (&msgs_ [i], sizeof (int));
+        assert (rc == 0);
+        const int value = first_ + i;
+        memcpy (zmq_msg_data (&msgs_ [i]), &value, sizeof value);
+    }
+}
+
+static void close_batch (zmq_msg_t *msgs_, int count_)
+{
+    for (int i = 0; i != count_; i++) {
+        int rc = zmq_msg_close (&msgs_ [i]);
+        assert (rc == 0);
+    }
+}
+
+static void recv_value (void *s_, int value_, bool more_)
+{
+    int value;
+    int rc = zmq_recv (s_, &value, sizeof value, 0);
+    assert (rc == sizeof value);
+    assert (value == value_);
+    int more;
+    size_t more_size = sizeof more;
+    rc = zmq_getsockopt (s_, ZMQ_RCVMORE, &more, &more_size);
+    assert (rc == 0);
+    assert (more == more_);
+}
+
+static void *receiver_ctx;
+static const char *receiver_address;
+static int receiver_count;
+
+static void receiver (void *)
+{
+    void *pull = zmq_socket (receiver_ctx, ZMQ_PULL);
+    assert (pull);
+    int hwm = 10;
+    int rc = zmq_setsockopt (pull, ZMQ_RCVHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_connect (pull, receiver_address);
+    assert (rc == 0);
+    for (int i = 0; i != receiver_count; i++)
+        recv_value (pull, i, false);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+}
+
+static void test_transport (const char *address_)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int rc = zmq_bind (push, address_);
+    assert (rc == 0);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    rc = zmq_connect (pull, address_);
+    assert (rc == 0);
+
+    zmq_msg_t msgs [batch_size];
+
+    //  Invalid arguments.
+    init_batch (msgs, 0, batch_size);
+    rc = zmq_sendmmsg (push, msgs, 0, 0);
+    assert (rc == -1 && errno == EINVAL);
+    rc = zmq_sendmmsg (pull, msgs, batch_size, 0);
+    assert (rc == -1 && errno == ENOTSUP);
+
+    //  Every message is sent separately and emptied afterwards.
+    rc = zmq_sendmmsg (push, msgs, batch_size, 0);
+    assert (rc == batch_size);
+    for (int i = 0; i != batch_size; i++)
+        assert (zmq_msg_size (&msgs [i]) == 0);
+    close_batch (msgs, batch_size);
+    for (int i = 0; i != batch_size; i++)
+        recv_value (pull, i, false);
+
+    //  With ZMQ_SNDMORE the batch forms a single multi-part message.
+    init_batch (msgs, 0, 3);
+    rc = zmq_sendmmsg (push, msgs, 3, ZMQ_SNDMORE);
+    assert (rc == 3);
+    close_batch (msgs, 3);
+    recv_value (pull, 0, true);
+    recv_value (pull, 1, true);
+    recv_value (pull, 2, false);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+static void test_hwm (const char *address_)
+{
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int hwm = 10;
+    int rc = zmq_setsockopt (push, ZMQ_SNDHWM, &hwm, sizeof hwm);
+    assert (rc == 0);
+    rc = zmq_bind (push, address_);
+    assert (rc == 0);
+
+    //  Without a peer nothing can be sent.
+    zmq_msg_t msgs [batch_size];
+    init_batch (msgs, 0, batch_size);
+    rc = zmq_sendmmsg (push, msgs, batch_size, ZMQ_DONTWAIT);
+    assert (rc == -1 && errno == EAGAIN);
+
+    //  Blocking batches larger than the high watermark get through
+    //  as the peer keeps reading.
+    receiver_ctx = ctx;
+    receiver_address = address_;
+    receiver_count = batch_size * 10;
+    void *thread = zmq_threadstart (&receiver, NULL);
+    for (int i = 0; i != 10; i++) {
+        if (i)
+            init_batch (msgs, i * batch_size, batch_size);
+        rc = zmq_sendmmsg (push, msgs, batch_size, 0);
+        assert (rc == batch_size);
+        close_batch (msgs, batch_size);
+    }
+    zmq_threadclose (thread);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment ();
+
+    test_transport ("inproc://sendmmsg");
+    test_transport ("tcp://127.0.0.1:5564");
+    test_hwm ("inproc://sendmmsg_hwm");
+    test_hwm ("tcp://127.0.0.1:5565");
+
+    return 0;
+}
@@ -0,0 +1,170 @@
+/*
+    Copyright (c) 2007-2014 Contributors as noted in the AUTHORS file
+
+    This file is part of 0MQ.
+
+    0MQ is free software; you can redistribute it and/or modify it under
+    the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    0MQ is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "testutil.hpp"
+#include <pthread.h>
+
+#define MESSAGES 40
+#define LARGE_SIZE (1024 * 1024)
+
+//  Number of messages released. Messages dropped when a socket is closed
+//  are released by the application thread, the others by the I/O thread.
+static pthread_mutex_t freed_sync = PTHREAD_MUTEX_INITIALIZER;
+static int freed;
+
+static void free_data (void *data_, void *hint_)
+{
+    (void) hint_;
+    free (data_);
+    pthread_mutex_lock (&freed_sync);
+    freed++;
+    pthread_mutex_unlock (&freed_sync);
+}
+
+static int get_freed ()
+{
+    pthread_mutex_lock (&freed_sync);
+    int result = freed;
+    pthread_mutex_unlock (&freed_sync);
+    return result;
+}
+
+//  Terminating the context while the kernel may still be sending from
+//  messages doesn't leak them. The peer, in another context, doesn't read
+//  anything, so most of the data is still queued in the kernel.
+static void test_term_while_pinned ()
+{
+    freed = 0;
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+    void *peer_ctx = zmq_ctx_new ();
+    assert (peer_ctx);
+
+    void *pull = zmq_socket (peer_ctx, ZMQ_PULL);
+    assert (pull);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+    int value = 65536;
+    int rc = zmq_setsockopt (push, ZMQ_ZEROCOPY_THRESHOLD, &value,
+        sizeof value);
+    assert (rc == 0);
+    value = 0;
+    rc = zmq_setsockopt (push, ZMQ_LINGER, &value, sizeof value);
+    assert (rc == 0);
+
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5573");
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5573");
+    assert (rc == 0);
+    msleep (SETTLE_TIME);
+
+    for (int i = 0; i != MESSAGES; i++) {
+        unsigned char *data = (unsigned char*) malloc (LARGE_SIZE);
+        assert (data);
+        zmq_msg_t msg;
+        rc = zmq_msg_init_data (&msg, data, LARGE_SIZE, free_data, NULL);
+        assert (rc == 0);
+        rc = zmq_msg_send (&msg, push, 0);
+        assert (rc == LARGE_SIZE);
+    }
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+    assert (get_freed () == MESSAGES);
+
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (peer_ctx);
+    assert (rc == 0);
+}
+
+int main (void)
+{
+    setup_test_environment();
+    void *ctx = zmq_ctx_new ();
+    assert (ctx);
+
+    void *pull = zmq_socket (ctx, ZMQ_PULL);
+    assert (pull);
+    void *push = zmq_socket (ctx, ZMQ_PUSH);
+    assert (push);
+
+    int value;
+    size_t size = sizeof value;
+    int rc = zmq_getsockopt (push, ZMQ_ZEROCOPY_THRESHOLD, &value, &size);
+    assert (rc == 0);
+    assert (value == 0);
+    value = -1;
+    rc = zmq_setsockopt (push, ZMQ_ZEROCOPY_THRESHOLD, &value, sizeof value);
+    assert (rc == -1 && errno == EINVAL);
+    value = 65536;
+    rc = zmq_setsockopt (push, ZMQ_ZEROCOPY_THRESHOLD, &value, sizeof value);
+    assert (rc == 0);
+
+    rc = zmq_bind (pull, "tcp://127.0.0.1:5573");
+    assert (rc == 0);
+    rc = zmq_connect (push, "tcp://127.0.0.1:5573");
+    assert (rc == 0);
+
+    //  Large messages alternate with small ones that are copied.
+    for (int i = 0; i != MESSAGES; i++) {
+        size_t msg_size = i % 2 ? 100 : LARGE_SIZE;
+        unsigned char *data = (unsigned char*) malloc (msg_size);
+        assert (data);
+        fill_payload (data, msg_size, i);
+        zmq_msg_t msg;
+        rc = zmq_msg_init_data (&msg, data, msg_size, free_data, NULL);
+        assert (rc == 0);
+        rc = zmq_msg_send (&msg, push, 0);
+        assert (rc == (int) msg_size);
+    }
+
+    for (int i = 0; i != MESSAGES; i++) {
+        zmq_msg_t msg;
+        rc = zmq_msg_init (&msg);
+        assert (rc == 0);
+        rc = zmq_msg_recv (&msg, pull, 0);
+        size_t msg_size = i % 2 ? 100 : LARGE_SIZE;
+        assert (rc == (int) msg_size);
+        assert (check_payload ((unsigned char*) zmq_msg_data (&msg), msg_size,
+            i));
+        rc = zmq_msg_close (&msg);
+        assert (rc == 0);
+    }
+
+    //  The sender gets rid of the messages once the kernel is done with
+    //  them, without the connection going away.
+    for (int i = 0; i != 100 && get_freed () != MESSAGES; i++)
+        msleep (10);
+    assert (get_freed () == MESSAGES);
+
+    rc = zmq_close (push);
+    assert (rc == 0);
+    rc = zmq_close (pull);
+    assert (rc == 0);
+    rc = zmq_ctx_term (ctx);
+    assert (rc == 0);
+
+    test_term_while_pinned ();
+
+    return 0;
+}
@@ -254,6 +254,34 @@ void close_zero_linger (void *socket)
     assert (rc == 0);
 }
 
+//  Fills a message payload with bytes depending on their position and on
+//  seed_, so that payloads swapped, cut short or corrupted are told apart.
+void fill_payload (unsigned char *data_, size_t size_, int seed_)
+{
+    for (size_t i = 0; i != size_; i++)
+        data_ [i] = (unsigned char) (i * 7 + seed_);
+}
+
+//  Returns true if the payload is the one fill_payload makes for seed_.
+bool check_payload (const unsigned char *data_, size_t size_, int seed_)
+{
+    for (size_t i = 0; i != size_; i++)
+        if (data_ [i] != (unsigned char) (i * 7 + seed_))
+            return false;
+    return true;
+}
+
+//  Returns the value of a 64-bit counter the socket maintains.
+uint64_t get_counter (void *socket_, int option_)
+{
+    uint64_t value;
+    size_t size = sizeof value;
+    int rc = zmq_getsockopt (socket_, option_, &value, &size);
+    assert (rc == 0);
+    assert (size == sizeof value);
+    return value;
+}
+
 void setup_test_environment()
 {
 #if defined _WIN32